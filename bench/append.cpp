@@ -0,0 +1,199 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../include/reader.h"
+#include "generator.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/// How the file grows.
+struct AppendConfig
+{
+    std::size_t requests = 10000; //!< Expressions appended in all.
+    std::size_t burst = 1;        //!< Expressions per append (one write each).
+    long interval = 1000;         //!< Microseconds between two appends.
+};
+
+/*!
+ * Appends the expressions to `fd_`, `burst` lines per write, one write every `interval`
+ * microseconds, while reading the answers from `in_` (the output of "bares --follow" on
+ * that file, in the compact format), and records the latency of each expression: from the
+ * write that appended it to the moment its answer arrives.
+ *
+ * @param fd_ the file, open for appending.
+ * @param in_ where the answers come from.
+ * @param lines_ the expressions (used round robin).
+ * @param config_ how many, how many at once and how often.
+ * @param latencies_ receives the latency of each expression, in nanoseconds.
+ * @return false if the answers stopped coming.
+ */
+static bool run_appends( int fd_, int in_, const std::vector< std::string > & lines_,
+                         const AppendConfig & config_, std::vector< std::uint64_t > & latencies_ )
+{
+    std::vector< Clock::time_point > sent( config_.requests );
+    latencies_.resize( config_.requests );
+    std::size_t n_sent = 0, n_done = 0;
+    std::string out;
+    char in[ 64 << 10 ];
+    auto next_append = Clock::now();
+
+    while ( n_done < config_.requests )
+    {
+        auto now = Clock::now();
+        if ( n_sent < config_.requests and now >= next_append )
+        {
+            out.clear();
+            auto n = std::min( config_.burst, config_.requests - n_sent );
+            for ( std::size_t i{0} ; i < n ; ++i )
+                ( out += lines_[ ( n_sent + i ) % lines_.size() ] ) += '\n';
+            // Uma única escrita, para que o follower veja a rajada inteira de uma vez.
+            if ( ::write( fd_, out.data(), out.size() ) != static_cast< ssize_t >( out.size() ) ) return false;
+            now = Clock::now();
+            for ( std::size_t i{0} ; i < n ; ++i ) sent[ n_sent++ ] = now;
+            next_append += std::chrono::microseconds( config_.interval );
+        }
+
+        // Until the next append (with ppoll, to the microsecond), or the answers, if all were appended.
+        timespec timeout{}, * until = nullptr;
+        if ( n_sent < config_.requests )
+        {
+            auto ns = std::max< long >( 0, std::chrono::duration_cast< std::chrono::nanoseconds >(
+                    next_append - Clock::now() ).count() );
+            timeout.tv_sec = ns / 1000000000;
+            timeout.tv_nsec = ns % 1000000000;
+            until = &timeout;
+        }
+        pollfd p{ in_, POLLIN, 0 };
+        if ( ::ppoll( &p, 1, until, nullptr ) == -1 and errno != EINTR ) return false;
+        if ( not ( p.revents & ( POLLIN | POLLHUP | POLLERR ) ) ) continue;
+
+        ssize_t n = ::read( in_, in, sizeof( in ) );
+        if ( n == 0 or ( n == -1 and errno != EINTR ) ) break;
+        now = Clock::now();
+        for ( ssize_t i{0} ; i < n ; ++i )
+            if ( in[i] == '\n' and n_done < n_sent )
+            {
+                latencies_[ n_done ] = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                        now - sent[ n_done ] ).count();
+                ++n_done;
+            }
+    }
+
+    latencies_.resize( n_done );
+    return n_done == config_.requests;
+}
+
+/// Prints how the program should be called.
+static void usage( const char * name_ )
+{
+    std::cerr << "Usage: bares --follow FILE --format compact | " << name_ << " FILE [options]\n"
+              << "  Appends expressions to FILE (which must start empty) and reports the latency percentiles\n"
+              << "  of their answers, read from the standard input: from the append to the answer.\n"
+              << "  --requests N    expressions appended in all (default: 10000).\n"
+              << "  --burst N       expressions per append (default: 1).\n"
+              << "  --interval US   microseconds between two appends (default: 1000).\n"
+              << "  --lines N       number of distinct expressions generated (default: 10000).\n"
+              << "  --file F        use the expressions of F instead of generated ones.\n"
+              << GENERATOR_OPTIONS;
+}
+
+int main( int argc, char * argv[] )
+{
+    if ( argc < 2 or argv[1][0] == '-' )
+    {
+        usage( argv[0] );
+        return argc >= 2 and std::strcmp( argv[1], "--help" ) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    const char * path = argv[1];
+    GeneratorConfig gen_config;
+    AppendConfig config;
+    std::size_t n_lines = 10000;
+    const char * filename = nullptr;
+
+    for ( int i{2} ; i < argc ; ++i )
+    {
+        if ( get_generator_option( argc, argv, i, gen_config ) ) continue;
+        std::string arg( argv[i] );
+        if ( arg == "--requests" and i + 1 < argc ) config.requests = std::strtoul( argv[++i], nullptr, 10 );
+        else if ( arg == "--burst" and i + 1 < argc ) config.burst = std::strtoul( argv[++i], nullptr, 10 );
+        else if ( arg == "--interval" and i + 1 < argc ) config.interval = std::strtol( argv[++i], nullptr, 10 );
+        else if ( arg == "--lines" and i + 1 < argc ) n_lines = std::strtoul( argv[++i], nullptr, 10 );
+        else if ( arg == "--file" and i + 1 < argc ) filename = argv[++i];
+        else
+        {
+            usage( argv[0] );
+            return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if ( config.burst == 0 ) config.burst = 1;
+    if ( config.interval < 0 ) config.interval = 0;
+
+    // The workload.
+    std::vector< std::string > lines;
+    if ( filename != nullptr )
+    {
+        LineReader reader( filename );
+        if ( not reader.is_open() )
+        {
+            std::cerr << "Cannot open " << filename << "!\n";
+            return EXIT_FAILURE;
+        }
+        std::string_view line;
+        while ( reader.next( line ) ) lines.emplace_back( line );
+    }
+    else
+    {
+        ExpressionGenerator gen( gen_config );
+        lines.resize( n_lines == 0 ? 1 : n_lines );
+        for ( auto & e : lines ) gen.next( e );
+    }
+    if ( lines.empty() )
+    {
+        std::cerr << "Empty workload!\n";
+        return EXIT_FAILURE;
+    }
+
+    // Whatever is in the file already would be answered too, and taken for our answers.
+    int fd = ::open( path, O_WRONLY | O_APPEND );
+    struct stat info;
+    if ( fd == -1 or ::fstat( fd, &info ) == -1 or info.st_size != 0 )
+    {
+        std::cerr << "Cannot append to " << path << ", or it is not empty!\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector< std::uint64_t > all;
+    auto t0 = Clock::now();
+    bool ok = run_appends( fd, STDIN_FILENO, lines, config, all );
+    double secs = std::chrono::duration< double >( Clock::now() - t0 ).count();
+    ::close( fd );
+    if ( not ok )
+        std::cerr << "Some answers did not come (is \"bares --follow " << path << " --format compact\" piped in?)!\n";
+    if ( all.empty() ) return EXIT_FAILURE;
+    std::sort( all.begin(), all.end() );
+
+    auto percentile = [&]( double p_ ) {
+        return all[ std::min( all.size() - 1, std::size_t( p_ / 100 * all.size() ) ) ] / 1e3;
+    };
+    std::cout << ">>> " << all.size() << " expressions appended, " << config.burst << " every "
+              << config.interval << " us.\n"
+              << std::fixed << std::setprecision( 0 )
+              << "throughput: " << all.size() / secs << " expr/s\n"
+              << std::setprecision( 1 )
+              << "latency (us): p50 " << percentile( 50 ) << ", p90 " << percentile( 90 )
+              << ", p99 " << percentile( 99 ) << ", p99.9 " << percentile( 99.9 )
+              << ", max " << all.back() / 1e3 << "\n";
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
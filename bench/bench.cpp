@@ -0,0 +1,448 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/parser.h"
+#include "../include/evaluator.h"
+#include "../include/report.h"
+#include "../include/writer.h"
+#include "../include/batch.h"
+#include "../include/reader.h"
+#include "../include/scanner.h"
+#include "../include/formula.h"
+#include "../include/jit.h"
+#include "../include/repl.h"
+#include "../include/bigint.h"
+#include "../include/compiled.h"
+#include "../include/split.h"
+#include "../include/aggregate.h"
+#include "generator.h"
+
+//=== Allocation counting: every operator new of the process goes through here.
+
+static std::atomic< std::size_t > n_allocations{ 0 };
+
+void * operator new( std::size_t n_ )
+{
+    n_allocations.fetch_add( 1, std::memory_order_relaxed );
+    if ( void * p = std::malloc( n_ == 0 ? 1 : n_ ) ) return p;
+    throw std::bad_alloc();
+}
+void * operator new[]( std::size_t n_ ) { return operator new( n_ ); }
+void operator delete( void * p_ ) noexcept { std::free( p_ ); }
+void operator delete[]( void * p_ ) noexcept { std::free( p_ ); }
+void operator delete( void * p_, std::size_t ) noexcept { std::free( p_ ); }
+void operator delete[]( void * p_, std::size_t ) noexcept { std::free( p_ ); }
+
+//=== Harness.
+
+/// The workload: the expressions and their total size.
+struct Workload
+{
+    std::vector< std::string > lines; //!< The expressions.
+    std::size_t bytes = 0;            //!< Sum of their sizes.
+};
+
+/// Keeps the compiler from throwing away results we never look at.
+static volatile long sink;
+
+/*!
+ * Runs `body_` (which goes once through the whole workload) a few times and prints the best run.
+ *
+ * @param name_ what is being measured.
+ * @param w_ the workload.
+ * @param repeats_ number of timed runs (after one warm up run).
+ * @param body_ the code to measure.
+ */
+template < typename Body >
+void run_bench( const std::string & name_, const Workload & w_, std::size_t repeats_, Body && body_ )
+{
+    body_(); // Warm up: caches, branch predictors and the capacity of our own buffers.
+
+    double best = 1e100;
+    std::size_t allocs = 0;
+    for ( std::size_t r{0} ; r < repeats_ ; ++r )
+    {
+        auto a0 = n_allocations.load();
+        auto t0 = std::chrono::steady_clock::now();
+        body_();
+        auto t1 = std::chrono::steady_clock::now();
+        double secs = std::chrono::duration< double >( t1 - t0 ).count();
+        if ( secs < best )
+        {
+            best = secs;
+            allocs = n_allocations.load() - a0;
+        }
+    }
+
+    double n = double( w_.lines.size() );
+    std::cout << std::left << std::setw( 38 ) << name_ << std::right
+              << std::fixed << std::setprecision( 0 )
+              << std::setw( 14 ) << n / best
+              << std::setprecision( 1 )
+              << std::setw( 12 ) << best * 1e9 / n
+              << std::setw( 10 ) << w_.bytes / best / 1e6
+              << std::setprecision( 3 )
+              << std::setw( 14 ) << allocs / n << "\n";
+}
+
+/// Times WideEvaluator< T > on the workload `w_`.
+template < typename T >
+void run_width( const std::string & name_, grammar::width_t width_, const Workload & w_, std::size_t repeats_ )
+{
+    WideEvaluator< T > evaluator( width_ );
+    run_bench( name_, w_, repeats_, [&]{
+        long acc = 0;
+        for ( const auto & e : w_.lines ) acc += evaluator.evaluate( e ).status;
+        sink = acc;
+    });
+}
+
+/// Prints how the program should be called.
+static void usage( const char * name_ )
+{
+    std::cerr << "Usage: " << name_ << " [options]\n"
+              << "  --lines N     number of expressions in the workload (default: 200000).\n"
+              << "  --repeat N    timed runs of each benchmark; the best one is reported (default: 5).\n"
+              << "  --file F      use the expressions of F instead of generated ones.\n"
+              << "  --jobs N      threads for the batch benchmark (default: all cores).\n"
+              << GENERATOR_OPTIONS;
+}
+
+int main( int argc, char * argv[] )
+{
+    GeneratorConfig config;
+    std::size_t n_lines = 200000;
+    std::size_t repeats = 5;
+    std::size_t n_jobs = std::thread::hardware_concurrency();
+    const char * filename = nullptr;
+
+    for ( int i{1} ; i < argc ; ++i )
+    {
+        if ( get_generator_option( argc, argv, i, config ) ) continue;
+        std::string arg( argv[i] );
+        if ( arg == "--lines" and i + 1 < argc ) n_lines = std::strtoul( argv[++i], nullptr, 10 );
+        else if ( arg == "--repeat" and i + 1 < argc ) repeats = std::strtoul( argv[++i], nullptr, 10 );
+        else if ( arg == "--jobs" and i + 1 < argc ) n_jobs = std::strtoul( argv[++i], nullptr, 10 );
+        else if ( arg == "--file" and i + 1 < argc ) filename = argv[++i];
+        else
+        {
+            usage( argv[0] );
+            return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if ( repeats == 0 ) repeats = 1;
+
+    // Build the workload.
+    Workload w;
+    if ( filename != nullptr )
+    {
+        LineReader reader( filename );
+        if ( not reader.is_open() )
+        {
+            std::cerr << "Cannot open " << filename << "!\n";
+            return EXIT_FAILURE;
+        }
+        std::string_view line;
+        while ( reader.next( line ) ) w.lines.emplace_back( line );
+    }
+    else
+    {
+        ExpressionGenerator gen( config );
+        w.lines.resize( n_lines );
+        for ( auto & e : w.lines ) gen.next( e );
+    }
+    for ( const auto & e : w.lines ) w.bytes += e.size();
+    if ( w.lines.empty() )
+    {
+        std::cerr << "Empty workload!\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << ">>> " << w.lines.size() << " expressions, " << w.bytes << " bytes, scanner: "
+              << Scanner::name() << ", best of " << repeats << " runs.\n\n";
+    std::cout << std::left << std::setw( 38 ) << "benchmark" << std::right
+              << std::setw( 14 ) << "expr/s" << std::setw( 12 ) << "ns/expr"
+              << std::setw( 10 ) << "MB/s" << std::setw( 14 ) << "allocs/expr" << "\n";
+    std::cout << std::string( 88, '-' ) << "\n";
+
+    //=== Microbenchmarks.
+
+    std::vector< std::uint8_t > classes;
+    run_bench( std::string( "lexer: Scanner::classify (" ) + Scanner::name() + ")", w, repeats, [&]{
+        for ( const auto & e : w.lines )
+        {
+            if ( classes.size() < e.size() ) classes.resize( e.size() );
+            Scanner::classify( e.data(), e.data() + e.size(), classes.data() );
+        }
+        sink = classes.empty() ? 0 : classes[0];
+    });
+
+    run_bench( "lexer: one char at a time", w, repeats, [&]{
+        long acc = 0;
+        for ( const auto & e : w.lines )
+            for ( auto c : e ) acc += Scanner::classify( c );
+        sink = acc;
+    });
+
+    Parser parser;
+    parser.set_keep_tokens( false );
+    run_bench( "Parser::parse (program only)", w, repeats, [&]{
+        long acc = 0;
+        for ( const auto & e : w.lines ) acc += parser.parse( e ).type;
+        sink = acc;
+    });
+
+    Parser token_parser;
+    run_bench( "Parser::parse (program + tokens)", w, repeats, [&]{
+        long acc = 0;
+        for ( const auto & e : w.lines ) acc += token_parser.parse( e ).type;
+        sink = acc;
+    });
+
+    // The programs of the valid expressions, compiled ahead of time.
+    std::vector< Program > programs;
+    for ( const auto & e : w.lines )
+        if ( parser.parse( e ).type == Parser::ResultType::OK )
+            programs.push_back( parser.get_program() );
+    VM vm;
+    if ( not programs.empty() )
+    {
+        Workload pw; // Same number of items, so ns/expr is per program.
+        pw.lines.resize( programs.size() );
+        for ( const auto & p : programs ) pw.bytes += p.get_code().size();
+        run_bench( "VM::run (precompiled)", pw, repeats, [&]{
+            long acc = 0;
+            for ( const auto & p : programs ) acc += vm.run( p ).value;
+            sink = acc;
+        });
+    }
+
+    //=== End to end.
+
+    Evaluator evaluator;
+    run_bench( "Evaluator::evaluate", w, repeats, [&]{
+        long acc = 0;
+        for ( const auto & e : w.lines ) acc += evaluator.evaluate( e ).value;
+        sink = acc;
+    });
+
+    Evaluator cached;
+    cached.set_cache( w.lines.size() / 4 + 1 ); // Full after the warm up: every miss evicts.
+    run_bench( "Evaluator::evaluate (cache)", w, repeats, [&]{
+        long acc = 0;
+        for ( const auto & e : w.lines ) acc += cached.evaluate( e ).value;
+        sink = acc;
+    });
+
+    //=== The same expressions with the other widths (each runs its own VM loop), and a few
+    //    large powers, where BigInt spends its time multiplying (Karatsuba).
+
+    run_width< std::int32_t >( "width 32: WideEvaluator::evaluate", grammar::width_t::W32, w, repeats );
+    run_width< long >( "width 64: WideEvaluator::evaluate", grammar::width_t::W64, w, repeats );
+    run_width< __int128 >( "width 128: WideEvaluator::evaluate", grammar::width_t::W128, w, repeats );
+    run_width< BigInt >( "width big: WideEvaluator::evaluate", grammar::width_t::BIG, w, repeats );
+    Workload bw;
+    for ( int i{0} ; i < 20 ; ++i )
+        bw.lines.push_back( std::to_string( 3 + i ) + " ^ 50000 % (7 ^ 9000 + " + std::to_string( i ) + ")" );
+    for ( const auto & e : bw.lines ) bw.bytes += e.size();
+    run_width< BigInt >( "width big: n ^ 50000 % (7 ^ 9000 + i)", grammar::width_t::BIG, bw, repeats );
+
+    //=== One formula over many rows: substituting the values into the text and evaluating
+    //    each row, against compiling once and evaluating the columns.
+
+    const char * const formula_text = "(a + b * 7) % (c - 3) + a ^ 3 - b / 5";
+    Formula formula;
+    formula.compile( formula_text );
+    const std::size_t n_rows = w.lines.size();
+    std::vector< std::vector< Formula::value_type > > columns( 3, std::vector< Formula::value_type >( n_rows ) );
+    std::vector< const Formula::value_type * > column_ptrs;
+    for ( const auto & c : columns ) column_ptrs.push_back( c.data() );
+    Workload fw; // The formula with the values of each row written in place.
+    fw.lines.resize( n_rows );
+    for ( std::size_t r{0} ; r < n_rows ; ++r )
+    {
+        for ( std::size_t c{0} ; c < columns.size() ; ++c )
+            columns[c][r] = long( ( ( r * 3 + c ) * 2654435761u ) >> 7 ) % 2001 - 1000;
+        auto v = [&]( std::size_t i_ ) { return std::to_string( columns[i_][r] ); };
+        fw.lines[r] = "(" + v(0) + " + " + v(1) + " * 7) % (" + v(2) + " - 3) + " + v(0) + " ^ 3 - " + v(1) + " / 5";
+        fw.bytes += fw.lines[r].size();
+    }
+    run_bench( "formula: Evaluator::evaluate per row", fw, repeats, [&]{
+        long acc = 0;
+        for ( const auto & e : fw.lines ) acc += evaluator.evaluate( e ).value;
+        sink = acc;
+    });
+    std::vector< Outcome > outcomes( n_rows );
+    run_bench( std::string( "formula: Formula::evaluate (" ) + ColumnVM::name() + ")", fw, repeats, [&]{
+        formula.evaluate( column_ptrs.data(), n_rows, outcomes.data() );
+        sink = outcomes[0].value;
+    });
+
+    // The interpreter against native code: the scalar VM one row at a time, the JIT (which
+    // pays off once its compile time is spread over enough rows) and what compiling costs.
+    VM row_vm;
+    Parser formula_parser;
+    formula_parser.set_variables( true );
+    formula_parser.parse( formula_text );
+    const Program & formula_program = formula_parser.get_program();
+    run_bench( "formula: VM::run per row", fw, repeats, [&]{
+        long acc = 0;
+        Formula::value_type row[3];
+        for ( std::size_t r{0} ; r < n_rows ; ++r )
+        {
+            for ( std::size_t c{0} ; c < 3 ; ++c ) row[c] = columns[c][r];
+            acc += row_vm.run( formula_program, row ).value;
+        }
+        sink = acc;
+    });
+    Formula native;
+    native.set_jit( true );
+    native.compile( formula_text );
+    if ( native.is_native() )
+    {
+        run_bench( "formula: Formula::evaluate (jit)", fw, repeats, [&]{
+            native.evaluate( column_ptrs.data(), n_rows, outcomes.data() );
+            sink = outcomes[0].value;
+        });
+        Workload cw; // One item per compilation.
+        cw.lines.resize( 1000 );
+        JitProgram jit;
+        run_bench( "formula: JitProgram::compile", cw, repeats, [&]{
+            for ( std::size_t i{0} ; i < cw.lines.size() ; ++i ) jit.compile( formula_program );
+            sink = jit.is_compiled();
+        });
+    }
+
+    //=== Interactive editing of a long line: each item is a keystroke (a character typed and
+    //    then erased), checked by the prompt (which parses from the change on) or by parsing
+    //    and evaluating the whole line again.
+
+    Repl repl;
+    std::string long_line;
+    for ( std::size_t i{0} ; long_line.size() < 100000 ; ++i )
+        long_line += ( i == 0 ? "" : i % 3 == 0 ? " - " : " + " ) + std::string( "(12 * 3 ^ 2 % 7)" );
+    repl.edit( 0, 0, long_line );
+    repl.check();
+    Workload kw; // One item per keystroke.
+    kw.lines.resize( 1000 );
+    for ( std::size_t at : { long_line.size(), long_line.size() / 2 } )
+    {
+        std::string name = at == long_line.size() ? "repl: keystroke at the end (100k)" : "repl: keystroke midway (100k)";
+        run_bench( name, kw, repeats, [&]{
+            long acc = 0;
+            for ( std::size_t i{0} ; i < kw.lines.size() ; i += 2 )
+            {
+                repl.edit( at, 0, "+" );
+                acc += repl.check().status;
+                repl.edit( at, 1, "" );
+                acc += repl.check().value;
+            }
+            sink = acc;
+        });
+    }
+    run_bench( "repl: full parse per keystroke (100k)", kw, repeats, [&]{
+        long acc = 0;
+        for ( std::size_t i{0} ; i < kw.lines.size() ; ++i )
+            if ( parser.parse( long_line ).type == Parser::ResultType::OK )
+                acc += vm.run( parser.get_program() ).value;
+        sink = acc;
+    });
+
+    std::string out;
+    out.reserve( 2 << 20 );
+    for ( auto format : { report_format_t::HUMAN, report_format_t::COMPACT } )
+    {
+        std::string name = format == report_format_t::HUMAN ? "end to end, human report" : "end to end, compact report";
+        run_bench( name, w, repeats, [&]{
+            for ( const auto & e : w.lines )
+            {
+                print_outcome( out, e, evaluator.evaluate( e ), format );
+                if ( out.size() >= ( 1 << 20 ) ) out.clear();
+            }
+            sink = out.size();
+        });
+    }
+    for ( bool with_quantiles : { false, true } )
+    {
+        std::string name = with_quantiles ? "end to end, --aggregate --quantiles" : "end to end, --aggregate";
+        run_bench( name, w, repeats, [&]{
+            Aggregate< long > statistics( with_quantiles ? std::vector< double >{ 0.5, 0.99 } : std::vector< double >() );
+            for ( const auto & e : w.lines ) statistics.add( evaluator.evaluate( e ) );
+            sink = statistics.n_lines();
+        });
+    }
+
+    //=== The same, from a precompiled file (see compiled.h): no lexing nor parsing.
+
+    char text_path[] = "/tmp/bares_bench_XXXXXX";
+    int text_fd = ::mkstemp( text_path );
+    if ( text_fd >= 0 )
+    {
+        std::string text;
+        for ( const auto & e : w.lines ) ( text += e ) += '\n';
+        bool written = ::write( text_fd, text.data(), text.size() ) == static_cast< ssize_t >( text.size() );
+        ::close( text_fd );
+        std::string compiled_path = std::string( text_path ) + ".bexp";
+        LineReader text_reader( text_path );
+        if ( written and CompiledFile::compile( text_reader, compiled_path.c_str(), grammar::width_t::W16,
+                                                Parser::DEFAULT_MAX_DEPTH ) )
+        {
+            int null_fd = ::open( "/dev/null", O_WRONLY );
+            run_bench( "end to end, compact, precompiled file", w, repeats, [&]{
+                CompiledFile compiled( compiled_path.c_str() );
+                OutputWriter writer( null_fd, report_format_t::COMPACT );
+                compiled.run( writer );
+            });
+            ::close( null_fd );
+        }
+        ::unlink( compiled_path.c_str() );
+        ::unlink( text_path );
+    }
+
+    if ( n_jobs > 1 )
+    {
+        int null_fd = ::open( "/dev/null", O_WRONLY );
+        OutputWriter writer( null_fd, report_format_t::COMPACT );
+        BatchRunner runner( n_jobs, writer );
+        run_bench( "end to end, --jobs " + std::to_string( n_jobs ), w, repeats, [&]{
+            for ( const auto & e : w.lines ) runner.add_line( e );
+            runner.finish();
+        });
+        runner.finish();
+        ::close( null_fd );
+
+        // The expressions that parse, added up in a single line: as a whole, and split among the threads.
+        Workload sum;
+        std::string line;
+        Evaluator evaluator;
+        for ( const auto & e : w.lines )
+        {
+            if ( evaluator.evaluate( e ).status == Outcome::PARSE_ERROR ) continue;
+            if ( not line.empty() ) line += " + ";
+            ( ( line += '(' ) += e ) += ')';
+            sum.lines.push_back( e );
+            sum.bytes += e.size();
+        }
+        if ( not sum.lines.empty() )
+        {
+            SplitEvaluator< long > split( n_jobs, grammar::width_t::W16 );
+            run_bench( "one line (their sum), whole", sum, repeats, [&]{ sink = evaluator.evaluate( line ).status; } );
+            run_bench( "one line (their sum), --split " + std::to_string( n_jobs ), sum, repeats, [&]{
+                sink = split.evaluate( line ).status;
+            });
+        }
+        std::cout << "\n>>> Largest batch: " << runner.chunk_high_water() << " bytes.\n";
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../include/server.h"
+
+/// Writes all of `data_` to `fd_`. Returns false if the other side went away.
+static bool write_all( int fd_, const char * data_, std::size_t n_ )
+{
+    while ( n_ > 0 )
+    {
+        ssize_t n = ::send( fd_, data_, n_, MSG_NOSIGNAL );
+        if ( n == -1 and errno == ENOTSOCK ) n = ::write( fd_, data_, n_ );
+        if ( n == -1 )
+        {
+            if ( errno == EINTR ) continue;
+            return false;
+        }
+        data_ += n;
+        n_ -= n;
+    }
+    return true;
+}
+
+/*!
+ * Sends expressions to a server (bares --serve SOCKET) and prints the answers, e.g.
+ *
+ *     bares_client /tmp/bares.sock expressions.txt
+ *
+ * The input goes to the server as it is read, while the answers are printed as they come
+ * back (one thread each), so any number of expressions may be in flight.
+ */
+int main( int argc, char * argv[] )
+{
+    if ( argc < 2 or argc > 3 or std::strcmp( argv[1], "--help" ) == 0 )
+    {
+        std::cerr << "Usage: " << argv[0] << " SOCKET [<input_file>|-]\n"
+                  << "  Sends the expressions of the file (default: the standard input), one per line, to the\n"
+                  << "  server listening on SOCKET and prints its answers, in order.\n";
+        return argc == 2 and std::strcmp( argv[1], "--help" ) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int in = STDIN_FILENO;
+    if ( argc == 3 and std::strcmp( argv[2], "-" ) != 0 )
+    {
+        in = ::open( argv[2], O_RDONLY | O_CLOEXEC );
+        if ( in == -1 )
+        {
+            std::cerr << "Cannot open " << argv[2] << "!\n";
+            return EXIT_FAILURE;
+        }
+    }
+    int sock = Server::connect( argv[1] );
+    if ( sock == -1 )
+    {
+        std::cerr << "Cannot connect to \"" << argv[1] << "\": " << std::strerror( errno ) << "!\n";
+        return EXIT_FAILURE;
+    }
+
+    std::thread sender( [&]{
+        char buffer[ 64 << 10 ];
+        ssize_t n;
+        while ( ( n = ::read( in, buffer, sizeof( buffer ) ) ) > 0 or ( n == -1 and errno == EINTR ) )
+            if ( n > 0 and not write_all( sock, buffer, n ) ) break;
+        ::shutdown( sock, SHUT_WR ); // The server answers the last line and closes.
+    });
+
+    bool ok = true;
+    char buffer[ 64 << 10 ];
+    ssize_t n;
+    while ( ( n = ::read( sock, buffer, sizeof( buffer ) ) ) > 0 or ( n == -1 and errno == EINTR ) )
+        if ( n > 0 and not write_all( STDOUT_FILENO, buffer, n ) )
+        {
+            ok = false;
+            ::shutdown( sock, SHUT_RDWR ); // Unblocks the sender.
+            break;
+        }
+
+    sender.join();
+    ::close( sock );
+    return ok and n == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+
+#include "generator.h"
+
+/*!
+ * Writes random expressions to the standard output, one per line, e.g.
+ *
+ *     bares_gen --lines 1000000 --errors 0.3 > workload.txt
+ */
+int main( int argc, char * argv[] )
+{
+    GeneratorConfig config;
+    std::size_t lines = 1000;
+
+    for ( int i{1} ; i < argc ; ++i )
+    {
+        if ( get_generator_option( argc, argv, i, config ) ) continue;
+        if ( std::strcmp( argv[i], "--lines" ) == 0 and i + 1 < argc )
+        {
+            lines = std::strtoul( argv[++i], nullptr, 10 );
+            continue;
+        }
+        std::cerr << "Usage: " << argv[0] << " [--lines N] [options]\n"
+                  << "  --lines N     number of expressions (default: 1000).\n"
+                  << GENERATOR_OPTIONS;
+        return std::strcmp( argv[i], "--help" ) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    ExpressionGenerator gen( config );
+    std::string e, out;
+    for ( std::size_t n{0} ; n < lines ; ++n )
+    {
+        gen.next( e );
+        out += e;
+        out += '\n';
+        if ( out.size() >= ( 1 << 16 ) )
+        {
+            std::cout << out;
+            out.clear();
+        }
+    }
+    std::cout << out;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include "generator.h"
+#include <cstring> // std::strcmp
+#include <cstdlib> // std::strtod, std::strtoul
+
+/// @param config_ the shape of the expressions.
+ExpressionGenerator::ExpressionGenerator( const GeneratorConfig & config_ )
+    : config( config_ )
+    , rng( config_.seed )
+{
+    if ( config.operators.empty() ) config.operators = "+";
+    if ( config.terms == 0 ) config.terms = 1;
+}
+
+double ExpressionGenerator::uniform( void )
+{
+    return std::uniform_real_distribution< double >( 0.0, 1.0 )( rng );
+}
+
+std::size_t ExpressionGenerator::pick( std::size_t n_ )
+{
+    return std::uniform_int_distribution< std::size_t >( 0, n_ - 1 )( rng );
+}
+
+/// Appends an integer: small, so that products and powers rarely overflow.
+void ExpressionGenerator::operand( std::string & out_, bool exponent_ )
+{
+    if ( exponent_ )
+    {
+        out_ += char( '0' + pick( 4 ) );
+        return;
+    }
+    long v = long( pick( 200 ) ) - 99;
+    out_ += std::to_string( v );
+}
+
+/// Appends a (sub)expression with `config.terms` operands.
+void ExpressionGenerator::expression( std::string & out_, std::size_t depth_ )
+{
+    bool exponent = false;
+    for ( std::size_t i{0} ; i < config.terms ; ++i )
+    {
+        if ( i != 0 )
+        {
+            char op = config.operators[ pick( config.operators.size() ) ];
+            // No chained powers ("a^b^c"): they are right associative and mostly overflow.
+            if ( exponent and op == '^' and config.operators.find_first_not_of( '^' ) != std::string::npos )
+                while ( op == '^' ) op = config.operators[ pick( config.operators.size() ) ];
+            bool blanks = uniform() < config.space_rate;
+            if ( blanks ) out_ += ' ';
+            out_ += op;
+            if ( blanks ) out_ += ' ';
+            exponent = ( op == '^' );
+        }
+
+        if ( not exponent and depth_ < config.depth and uniform() < config.paren_rate )
+        {
+            out_ += '(';
+            expression( out_, depth_ + 1 );
+            out_ += ')';
+        }
+        else operand( out_, exponent );
+    }
+}
+
+/// Breaks a valid expression in one of several ways.
+void ExpressionGenerator::break_it( std::string & out_ )
+{
+    switch ( pick( 6 ) )
+    {
+        case 0: out_ += " +"; break;                                  // Missing term.
+        case 1: out_.insert( pick( out_.size() + 1 ), "x" ); break;   // Extraneous/ill formed.
+        case 2: out_.insert( 0, "(" ); break;                         // Missing closing.
+        case 3: out_.insert( 0, "*" ); break;                         // Ill formed integer.
+        case 4: out_ += " - 40000"; break;                            // Out of range.
+        case 5: out_.assign( pick( 3 ), ' ' ); break;                 // Unexpected end.
+    }
+}
+
+/// Clears `out_` and writes a new expression into it.
+void ExpressionGenerator::next( std::string & out_ )
+{
+    out_.clear();
+    expression( out_, 0 );
+    if ( config.error_rate > 0 and uniform() < config.error_rate )
+        break_it( out_ );
+}
+
+const char * GENERATOR_OPTIONS =
+    "  --terms N     operands per (sub)expression (default: 8).\n"
+    "  --depth N     maximum nesting of parentheses (default: 2).\n"
+    "  --parens P    chance of an operand being a subexpression (default: 0.2).\n"
+    "  --ops S       operator mix, e.g. \"++-*\" (default: \"+-*/%^\").\n"
+    "  --errors P    fraction of malformed expressions (default: 0).\n"
+    "  --spaces P    chance of blanks around an operator (default: 0.7).\n"
+    "  --seed N      random seed (default: 42).\n";
+
+/*!
+ * @param argc number of arguments.
+ * @param argv the arguments.
+ * @param i index of the current argument; moved past the value of the option.
+ * @param config_ receives the value.
+ * @return true if argv[i] is a generator option; false otherwise.
+ */
+bool get_generator_option( int argc, char * argv[], int & i, GeneratorConfig & config_ )
+{
+    if ( i + 1 >= argc ) return false;
+    const char * name = argv[i];
+    const char * value = argv[i+1];
+
+    if ( std::strcmp( name, "--terms" ) == 0 )       config_.terms = std::strtoul( value, nullptr, 10 );
+    else if ( std::strcmp( name, "--depth" ) == 0 )  config_.depth = std::strtoul( value, nullptr, 10 );
+    else if ( std::strcmp( name, "--parens" ) == 0 ) config_.paren_rate = std::strtod( value, nullptr );
+    else if ( std::strcmp( name, "--ops" ) == 0 )    config_.operators = value;
+    else if ( std::strcmp( name, "--errors" ) == 0 ) config_.error_rate = std::strtod( value, nullptr );
+    else if ( std::strcmp( name, "--spaces" ) == 0 ) config_.space_rate = std::strtod( value, nullptr );
+    else if ( std::strcmp( name, "--seed" ) == 0 )   config_.seed = std::strtoul( value, nullptr, 10 );
+    else return false;
+
+    ++i;
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef _GENERATOR_H_
+#define _GENERATOR_H_
+
+#include <string>  // std::string
+#include <random>  // std::mt19937
+#include <cstddef> // std::size_t
+
+/// Shape of the expressions created by the ExpressionGenerator.
+struct GeneratorConfig
+{
+    std::size_t terms = 8;            //!< Number of operands of each (sub)expression.
+    std::size_t depth = 2;            //!< Maximum nesting depth of parentheses.
+    double paren_rate = 0.2;          //!< Chance of an operand being a parenthesized subexpression.
+    std::string operators = "+-*/%^"; //!< Operator mix (repeat an operator to make it more likely).
+    double error_rate = 0.0;          //!< Fraction of the expressions that are malformed.
+    double space_rate = 0.7;          //!< Chance of blanks around each operator.
+    unsigned seed = 42;               //!< Seed, so that workloads can be reproduced.
+};
+
+/*!
+ * Creates random expressions for benchmarks.
+ *
+ * Valid expressions keep their operands small (and "^" exponents in 0..3) so that most
+ * of them evaluate to a value. Malformed ones have a single defect picked at random:
+ * a missing term, an extraneous symbol, a missing ")", an ill formed integer, an integer
+ * out of range or an empty line.
+ */
+class ExpressionGenerator
+{
+    public:
+        /// Creates a generator for expressions shaped by `config_`.
+        explicit ExpressionGenerator( const GeneratorConfig & config_ );
+
+        /// Writes the next expression into `out_` (the previous content is discarded).
+        void next( std::string & out_ );
+        /// Returns the next expression.
+        std::string next( void ) { std::string e; next( e ); return e; }
+
+    private:
+        GeneratorConfig config; //!< Shape of the expressions.
+        std::mt19937 rng;       //!< Random source.
+
+        double uniform( void );                                   // A number in [0,1).
+        std::size_t pick( std::size_t n_ );                       // A number in [0,n_).
+        void operand( std::string & out_, bool exponent_ );       // A random integer.
+        void expression( std::string & out_, std::size_t depth_ ); // A random (sub)expression.
+        void break_it( std::string & out_ );                      // Introduces a single defect.
+};
+
+/// Reads a generator option (--terms, --depth, --parens, --ops, --errors, --spaces, --seed) from argv[i].
+bool get_generator_option( int argc, char * argv[], int & i, GeneratorConfig & config_ );
+/// Help text for the generator options.
+extern const char * GENERATOR_OPTIONS;
+
+#endif
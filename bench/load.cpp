@@ -0,0 +1,198 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../include/server.h"
+#include "../include/reader.h"
+#include "generator.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/// What each connection does.
+struct LoadConfig
+{
+    std::size_t requests = 100000; //!< Expressions sent by each connection.
+    std::size_t depth = 64;        //!< Expressions in flight (sent, not answered) per connection.
+};
+
+/*!
+ * Keeps up to `depth` expressions in flight on one connection until `requests` have been
+ * answered, and records the latency of each one: from the moment it is queued to be sent
+ * to the moment its answer arrives.
+ *
+ * @param path_ the socket of the server.
+ * @param lines_ the expressions (used round robin).
+ * @param config_ how many requests, and how many at once.
+ * @param latencies_ receives the latency of each request, in nanoseconds.
+ * @return false if the connection failed.
+ */
+static bool run_connection( const std::string & path_, const std::vector< std::string > & lines_,
+                            const LoadConfig & config_, std::vector< std::uint64_t > & latencies_ )
+{
+    int fd = Server::connect( path_ );
+    if ( fd == -1 ) return false;
+    ::fcntl( fd, F_SETFL, ::fcntl( fd, F_GETFL ) | O_NONBLOCK );
+
+    std::vector< Clock::time_point > sent( config_.depth ); // Ring: request i is at i % depth.
+    latencies_.resize( config_.requests );
+    std::string out;
+    std::size_t out_pos = 0, n_sent = 0, n_done = 0;
+    char in[ 64 << 10 ];
+
+    while ( n_done < config_.requests )
+    {
+        // Fill the window.
+        if ( n_sent < config_.requests and n_sent - n_done < config_.depth )
+        {
+            auto now = Clock::now();
+            for ( ; n_sent < config_.requests and n_sent - n_done < config_.depth ; ++n_sent )
+            {
+                out += lines_[ n_sent % lines_.size() ];
+                out += '\n';
+                sent[ n_sent % config_.depth ] = now;
+            }
+        }
+        if ( out_pos < out.size() )
+        {
+            ssize_t n = ::send( fd, out.data() + out_pos, out.size() - out_pos, MSG_NOSIGNAL );
+            if ( n == -1 and errno != EAGAIN and errno != EINTR ) break;
+            if ( n > 0 ) out_pos += n;
+            if ( out_pos == out.size() )
+            {
+                out.clear();
+                out_pos = 0;
+            }
+        }
+
+        pollfd p{ fd, short( POLLIN | ( out_pos < out.size() ? POLLOUT : 0 ) ), 0 };
+        if ( ::poll( &p, 1, -1 ) == -1 and errno != EINTR ) break;
+        if ( not ( p.revents & ( POLLIN | POLLHUP | POLLERR ) ) ) continue;
+
+        ssize_t n = ::read( fd, in, sizeof( in ) );
+        if ( n == 0 or ( n == -1 and errno != EAGAIN and errno != EINTR ) ) break;
+        auto now = Clock::now();
+        for ( ssize_t i{0} ; i < n ; ++i )
+            if ( in[i] == '\n' )
+            {
+                latencies_[ n_done ] = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                        now - sent[ n_done % config_.depth ] ).count();
+                ++n_done;
+            }
+    }
+
+    ::close( fd );
+    latencies_.resize( n_done );
+    return n_done == config_.requests;
+}
+
+/// Prints how the program should be called.
+static void usage( const char * name_ )
+{
+    std::cerr << "Usage: " << name_ << " SOCKET [options]\n"
+              << "  Loads a server (bares --serve SOCKET) and reports its throughput and latency percentiles.\n"
+              << "  --connections N number of connections, each one in its own thread (default: 4).\n"
+              << "  --requests N    expressions sent by each connection (default: 100000).\n"
+              << "  --inflight N    expressions in flight per connection (default: 64; 1 is request/response).\n"
+              << "  --lines N       number of distinct expressions generated (default: 10000).\n"
+              << "  --file F        use the expressions of F instead of generated ones.\n"
+              << GENERATOR_OPTIONS;
+}
+
+int main( int argc, char * argv[] )
+{
+    if ( argc < 2 or argv[1][0] == '-' )
+    {
+        usage( argv[0] );
+        return argc >= 2 and std::strcmp( argv[1], "--help" ) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    std::string path( argv[1] );
+    GeneratorConfig gen_config;
+    LoadConfig config;
+    std::size_t n_connections = 4;
+    std::size_t n_lines = 10000;
+    const char * filename = nullptr;
+
+    for ( int i{2} ; i < argc ; ++i )
+    {
+        if ( get_generator_option( argc, argv, i, gen_config ) ) continue;
+        std::string arg( argv[i] );
+        if ( arg == "--connections" and i + 1 < argc ) n_connections = std::strtoul( argv[++i], nullptr, 10 );
+        else if ( arg == "--requests" and i + 1 < argc ) config.requests = std::strtoul( argv[++i], nullptr, 10 );
+        else if ( arg == "--inflight" and i + 1 < argc ) config.depth = std::strtoul( argv[++i], nullptr, 10 );
+        else if ( arg == "--lines" and i + 1 < argc ) n_lines = std::strtoul( argv[++i], nullptr, 10 );
+        else if ( arg == "--file" and i + 1 < argc ) filename = argv[++i];
+        else
+        {
+            usage( argv[0] );
+            return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if ( n_connections == 0 ) n_connections = 1;
+    if ( config.depth == 0 ) config.depth = 1;
+
+    // The workload.
+    std::vector< std::string > lines;
+    if ( filename != nullptr )
+    {
+        LineReader reader( filename );
+        if ( not reader.is_open() )
+        {
+            std::cerr << "Cannot open " << filename << "!\n";
+            return EXIT_FAILURE;
+        }
+        std::string_view line;
+        while ( reader.next( line ) ) lines.emplace_back( line );
+    }
+    else
+    {
+        ExpressionGenerator gen( gen_config );
+        lines.resize( n_lines == 0 ? 1 : n_lines );
+        for ( auto & e : lines ) gen.next( e );
+    }
+    if ( lines.empty() )
+    {
+        std::cerr << "Empty workload!\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector< std::vector< std::uint64_t > > latencies( n_connections );
+    std::vector< char > ok( n_connections );
+    std::vector< std::thread > threads;
+    auto t0 = Clock::now();
+    for ( std::size_t c{0} ; c < n_connections ; ++c )
+        threads.emplace_back( [&, c]{ ok[c] = run_connection( path, lines, config, latencies[c] ); } );
+    for ( auto & t : threads ) t.join();
+    double secs = std::chrono::duration< double >( Clock::now() - t0 ).count();
+
+    std::vector< std::uint64_t > all;
+    for ( const auto & l : latencies ) all.insert( all.end(), l.begin(), l.end() );
+    if ( std::count( ok.begin(), ok.end(), 0 ) != 0 )
+        std::cerr << "Some connections failed (is the server running?)!\n";
+    if ( all.empty() ) return EXIT_FAILURE;
+    std::sort( all.begin(), all.end() );
+
+    auto percentile = [&]( double p_ ) {
+        return all[ std::min( all.size() - 1, std::size_t( p_ / 100 * all.size() ) ) ] / 1e3;
+    };
+    std::cout << ">>> " << all.size() << " requests over " << n_connections << " connections, "
+              << config.depth << " in flight each.\n"
+              << std::fixed << std::setprecision( 0 )
+              << "throughput: " << all.size() / secs << " expr/s\n"
+              << std::setprecision( 1 )
+              << "latency (us): p50 " << percentile( 50 ) << ", p90 " << percentile( 90 )
+              << ", p99 " << percentile( 99 ) << ", p99.9 " << percentile( 99.9 )
+              << ", max " << all.back() / 1e3 << "\n";
+
+    return std::count( ok.begin(), ok.end(), 0 ) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,89 @@
+#ifndef _AGGREGATE_H_
+#define _AGGREGATE_H_
+
+#include <string>      // std::string
+#include <vector>      // std::vector
+#include <map>         // std::map
+#include <type_traits> // std::conditional
+#include <cstdint>     // std::uint64_t
+#include <cstddef>     // std::size_t
+
+#include "evaluator.h" // BasicOutcome.
+#include "bigint.h"    // class BigInt.
+
+/*!
+ * Running statistics of the outcomes of a stream of expressions (the --aggregate option),
+ * kept instead of a report per expression.
+ *
+ * Each outcome is counted (valid, or by the name of its error) and the values are added up
+ * exactly: in an `__int128` for the widths up to 64 bits, which no number of lines can make
+ * overflow, and in a BigInt for the wider ones (128-bit values are added in an `__int128`
+ * first, which goes into the BigInt only when it would overflow).  The smallest and the
+ * largest value are kept as they are.
+ *
+ * Quantiles, if asked for, are approximate: the values go into a histogram with
+ * `1 << MANTISSA_BITS` buckets per power of two (of each sign), so a quantile is reported
+ * as the bound of its bucket nearest to zero, less than 1/32 (in magnitude) away from the
+ * value of that rank.  Values below 64 in magnitude have a bucket each, and are exact.
+ *
+ * It is instantiated (in aggregate.cpp) for the types of every width (see WideEvaluator).
+ */
+template < typename T >
+class Aggregate
+{
+    public:
+        //=== Aliases
+        typedef std::uint64_t count_type; //!< Used for counting.
+        typedef std::size_t size_type;    //!< Used for indices.
+        /// Holds the exact sum of the values.
+        typedef typename std::conditional< sizeof( T ) <= sizeof( long ), __int128, BigInt >::type sum_type;
+
+        /// Bits after the leading one that choose the bucket of a value.
+        static constexpr unsigned MANTISSA_BITS = 5;
+        /// Buckets kept in an array (enough for every 64-bit value); the others are kept in a map.
+        static constexpr size_type FLAT_BUCKETS = 2048;
+
+        /// Creates empty statistics, with the quantiles `quantiles_` (each between 0 and 1), if any.
+        explicit Aggregate( const std::vector< double > & quantiles_=std::vector< double >() );
+
+        /// Counts one outcome.
+        void add( const BasicOutcome< T > & outcome_ )
+        {
+            if ( outcome_.status != OutcomeBase::OK ) count_error( outcome_ );
+            else add_value( outcome_.value );
+        }
+
+        /// Number of outcomes counted.
+        count_type n_lines( void ) const { return n_valid + n_invalid; }
+        /// Approximate value of the quantile `q_` (between 0 and 1) of the valid values; there must be some.
+        T quantile( double q_ ) const;
+
+        /// Appends the statistics to `out_`, one "name: value" per line, or as a JSON object.
+        void print( std::string & out_, bool json_ ) const;
+
+    private:
+        count_type n_valid = 0;                    //!< Outcomes with a value.
+        count_type n_invalid = 0;                  //!< Outcomes with an error.
+        sum_type sum = 0;                          //!< Sum of the values (but for `partial`).
+        __int128 partial = 0;                      //!< Values of 128 bits not yet added to `sum`.
+        T min = 0;                                 //!< Smallest value (meaningful if there is one).
+        T max = 0;                                 //!< Largest value (meaningful if there is one).
+        std::vector< count_type > status_counts;   //!< Per OutcomeBase::status_t.
+        std::vector< count_type > parse_counts;    //!< Per Parser::ResultType::code_t.
+        std::vector< double > quantiles;           //!< The quantiles to report.
+        /// The buckets of the values of one sign (see bucket()).
+        struct Histogram
+        {
+            std::vector< count_type > flat;               //!< The first FLAT_BUCKETS buckets.
+            std::map< size_type, count_type > sparse;     //!< The others that are not empty.
+        };
+        Histogram positive; //!< Values zero or larger.
+        Histogram negative; //!< Values smaller than zero, by magnitude.
+
+        void add_value( const T & v_ );
+        void count_error( const OutcomeBase & outcome_ );
+        static size_type bucket( const T & v_ );              // Bucket of the magnitude of v_.
+        static T lower_bound( size_type bucket_, bool negative_ ); // The bucket's value nearest to zero.
+};
+
+#endif
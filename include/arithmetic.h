@@ -0,0 +1,94 @@
+#ifndef _ARITHMETIC_H_
+#define _ARITHMETIC_H_
+
+#include <cstdint> // std::uint8_t
+
+/*!
+ * Checked integer arithmetic, used by the virtual machine.
+ *
+ * Every operation stores its exact result in `r_` and returns NO_ERROR, or returns what
+ * went wrong (leaving `r_` unspecified).  Overflow is detected on each operation with the
+ * compiler builtins, so an intermediate result that does not fit in `T` can never turn
+ * into a wrong final value; "^" is computed by squaring, exactly, without going through
+ * floating point.
+ *
+ * They are constexpr, so expressions evaluated at compile time (see constant.h) get
+ * exactly the same results and errors as the VM.
+ */
+namespace arithmetic {
+
+/// What may go wrong with an operation.
+enum error_t : std::uint8_t {
+    NO_ERROR = 0,     //!< The result is exact.
+    DIVISION_BY_ZERO, //!< "/" with a zero divisor (or zero raised to a negative power).
+    MODULO_BY_ZERO,   //!< "%" with a zero divisor.
+    NUMERIC_OVERFLOW  //!< The result does not fit in `T`.
+};
+
+/// `r_ = a_ + b_`.
+template < typename T >
+constexpr error_t add( T a_, T b_, T & r_ )
+{ return __builtin_add_overflow( a_, b_, &r_ ) ? NUMERIC_OVERFLOW : NO_ERROR; }
+
+/// `r_ = a_ - b_`.
+template < typename T >
+constexpr error_t sub( T a_, T b_, T & r_ )
+{ return __builtin_sub_overflow( a_, b_, &r_ ) ? NUMERIC_OVERFLOW : NO_ERROR; }
+
+/// `r_ = a_ * b_`.
+template < typename T >
+constexpr error_t mul( T a_, T b_, T & r_ )
+{ return __builtin_mul_overflow( a_, b_, &r_ ) ? NUMERIC_OVERFLOW : NO_ERROR; }
+
+/// `r_ = a_ / b_`, truncated toward zero.
+template < typename T >
+constexpr error_t div( T a_, T b_, T & r_ )
+{
+    if ( b_ == 0 ) return DIVISION_BY_ZERO;
+    // The smallest value divided by -1 is the only quotient out of range (and it traps).
+    if ( b_ == -1 ) return sub( T( 0 ), a_, r_ );
+    r_ = a_ / b_;
+    return NO_ERROR;
+}
+
+/// `r_ = a_ % b_`, with the sign of `a_`.
+template < typename T >
+constexpr error_t mod( T a_, T b_, T & r_ )
+{
+    if ( b_ == 0 ) return MODULO_BY_ZERO;
+    r_ = ( b_ == -1 ) ? T( 0 ) : a_ % b_; // Same trap as above.
+    return NO_ERROR;
+}
+
+/*!
+ * `r_ = a_ ^ b_`, by squaring (at most two multiplications per bit of the exponent).
+ *
+ * A negative exponent gives the integer part of 1/(a_^-b_): zero, unless `a_` is 1 or -1,
+ * and a division by zero when `a_` is zero.
+ */
+template < typename T >
+constexpr error_t pow( T a_, T b_, T & r_ )
+{
+    if ( b_ < 0 )
+    {
+        if ( a_ == 0 ) return DIVISION_BY_ZERO;
+        r_ = ( a_ == 1 or a_ == -1 ) ? ( ( b_ & 1 ) ? a_ : T( 1 ) ) : T( 0 );
+        return NO_ERROR;
+    }
+
+    T result = 1;
+    for (;;)
+    {
+        if ( ( b_ & 1 ) and __builtin_mul_overflow( result, a_, &result ) ) return NUMERIC_OVERFLOW;
+        b_ >>= 1;
+        if ( b_ == 0 ) break;
+        // A higher bit of the exponent is still set, so if the square overflows the result would too.
+        if ( __builtin_mul_overflow( a_, a_, &a_ ) ) return NUMERIC_OVERFLOW;
+    }
+    r_ = result;
+    return NO_ERROR;
+}
+
+} // namespace arithmetic
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef _BARES_H_
+#define _BARES_H_
+
+/*!
+ * The C interface of libbares, for programs that want to evaluate expressions in
+ * process (C++ programs may also use class Evaluator, in evaluator.h, directly).
+ *
+ * Nothing is printed and there is no global state: everything lives in an evaluator,
+ * created with bares_create(). An evaluator must not be used by two threads at once,
+ * but each thread may have its own. The results go to arrays owned by the caller.
+ *
+ *     bares_evaluator * e = bares_create( 0, 0 );
+ *     bares_result r;
+ *     if ( bares_evaluate( e, "2 ^ 10 - 1", 10, &r ) == BARES_OK ) printf( "%lld\n", r.value );
+ *     else printf( "%s,%zu\n", r.error, r.column );
+ *     bares_evaluate( e, "a + 1", 5, &r ); // ILL_FORMED_INTEGER, at column 0.
+ *     bares_destroy( e );
+ */
+
+#include <stddef.h> /* size_t */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// What happened to an expression (the same as Outcome::status_t, plus running out of memory).
+typedef enum bares_status {
+    BARES_OUT_OF_MEMORY = -1,  /*!< The expression could not be evaluated. */
+    BARES_OK = 0,              /*!< Parsed and evaluated: see `value`. */
+    BARES_PARSE_ERROR,         /*!< Syntax error: see `error` and `column`. */
+    BARES_DIVISION_BY_ZERO,    /*!< "/" with a zero divisor, at `column`. */
+    BARES_MODULO_BY_ZERO,      /*!< "%" with a zero divisor, at `column`. */
+    BARES_NUMERIC_OVERFLOW     /*!< The result, or some step on the way to it, does not fit. */
+} bares_status;
+
+/// The outcome of one expression.
+typedef struct bares_result {
+    bares_status status; /*!< What happened. */
+    long long value;     /*!< The result (meaningful for BARES_OK). */
+    size_t column;       /*!< Where the error is, as in the compact format (0 based, never negative; 0 for BARES_OK). */
+    const char * error;  /*!< Name of the error, e.g. "MISSING_TERM" ("OK" for BARES_OK); a static string. */
+} bares_result;
+
+/// An expression: `size` characters from `data` (no terminating '\0' needed).
+typedef struct bares_string {
+    const char * data;
+    size_t size;
+} bares_string;
+
+/// Opaque handle to an evaluator.
+typedef struct bares_evaluator bares_evaluator;
+
+/*!
+ * Creates an evaluator.
+ * @param cache_size outcomes of distinct expressions remembered (0: no cache).
+ * @param max_depth maximum nesting of parentheses (0: the default limit).
+ * @return the evaluator, or NULL if there is not enough memory.
+ */
+bares_evaluator * bares_create( size_t cache_size, size_t max_depth );
+
+/// Destroys an evaluator (NULL is ignored).
+void bares_destroy( bares_evaluator * evaluator );
+
+/*!
+ * Parses and evaluates one expression.
+ * @return the status, also stored in `result`.
+ */
+bares_status bares_evaluate( bares_evaluator * evaluator, const char * expr, size_t size, bares_result * result );
+
+/*!
+ * Parses and evaluates `n` expressions; the outcome of `exprs[i]` goes to `results[i]`.
+ * @return how many expressions were evaluated: `n`, unless memory ran out.
+ */
+size_t bares_evaluate_batch( bares_evaluator * evaluator, const bares_string * exprs, size_t n, bares_result * results );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
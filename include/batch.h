@@ -0,0 +1,109 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <string>             // std::string
+#include <string_view>        // std::string_view
+#include <vector>             // std::vector
+#include <deque>              // std::deque
+#include <memory>             // std::shared_ptr, std::unique_ptr
+#include <thread>             // std::thread
+#include <mutex>              // std::mutex
+#include <condition_variable> // std::condition_variable
+#include <atomic>             // std::atomic
+#include <cstddef>            // std::size_t
+
+#include "writer.h"           // class OutputWriter.
+#include "evaluator.h"        // struct EvaluatorConfig.
+
+/*!
+ * Evaluates a stream of expressions on a pool of worker threads.
+ *
+ * Lines are grouped into chunks, and chunks are handed to the workers through one
+ * queue per worker: a worker takes chunks from the front of its own queue and, when
+ * it runs out of work, steals from the back of the others.  Every worker has its own
+ * Evaluator and formats its reports in the format of the output writer.  The reports
+ * are handed to the writer in input order, as soon as all the chunks before them are done.
+ *
+ * Chunks that have been written out are recycled: emptying one is O(1) and it keeps the
+ * memory of its lines and reports, so once the runner is warm a batch does not allocate.
+ */
+class BatchRunner
+{
+    public:
+        //=== Alias
+        typedef std::size_t size_type; //!< Used for counting.
+
+        /// Default number of lines in a chunk.
+        static constexpr size_type CHUNK_LINES = 4096;
+
+        /// Starts `n_jobs_` workers whose reports go to `writer_`; each one has an Evaluator set up with `config_`.
+        BatchRunner( size_type n_jobs_, OutputWriter & writer_, const EvaluatorConfig & config_=EvaluatorConfig(),
+                     size_type chunk_lines_=CHUNK_LINES );
+        /// Finishes the remaining work and stops the workers.
+        ~BatchRunner();
+        /// Turn off copy constructor.
+        BatchRunner( const BatchRunner & ) = delete;
+        /// Turn off assignment operator.
+        BatchRunner & operator=( const BatchRunner & ) = delete;
+
+        /// Adds the next expression (it is copied).
+        void add_line( std::string_view line_ );
+        /// Waits until all the expressions added so far have been written out.
+        void finish( void );
+
+        /// Cache hits of all workers, for the chunks written so far.
+        size_type cache_hits( void ) const { return n_cache_hits; }
+        /// Cache misses of all workers, for the chunks written so far.
+        size_type cache_misses( void ) const { return n_cache_misses; }
+        /// Largest amount of memory (lines plus reports, in bytes) used by a chunk so far.
+        size_type chunk_high_water( void ) const { return high_water; }
+
+    private:
+        /// A group of consecutive lines and their reports.
+        struct Chunk
+        {
+            std::string text;     //!< The lines, each one terminated by '\n'.
+            std::string output;   //!< The reports for the lines.
+            bool done = false;    //!< Whether `output` is complete (guarded by `done_mtx`).
+        };
+
+        /// A worker thread and its queue.
+        struct Worker
+        {
+            std::deque< std::shared_ptr< Chunk > > queue; //!< Chunks waiting to be processed.
+            std::mutex mtx;                               //!< Guards `queue`.
+            std::thread thread;                           //!< The thread itself.
+        };
+
+        OutputWriter & writer;                               //!< Where the reports go.
+        EvaluatorConfig config;                              //!< Set up of the workers' evaluators.
+        size_type chunk_lines;                               //!< Lines per chunk.
+        size_type max_in_flight;                             //!< How many chunks may be waiting at the same time.
+        std::vector< std::unique_ptr< Worker > > workers;    //!< The pool.
+        size_type next_worker = 0;                           //!< Worker that gets the next chunk.
+
+        std::shared_ptr< Chunk > current;                    //!< Chunk being filled in.
+        size_type current_lines = 0;                         //!< Lines in `current`.
+        std::deque< std::shared_ptr< Chunk > > in_flight;    //!< Submitted chunks, in input order.
+        std::vector< std::shared_ptr< Chunk > > spare;       //!< Written chunks, emptied for reuse.
+        size_type high_water = 0;                            //!< See chunk_high_water().
+
+        std::mutex state_mtx;                                //!< Guards `pending` and `stopping`.
+        std::condition_variable work_cv;                     //!< Signals new work (or stop).
+        size_type pending = 0;                               //!< Chunks queued but not yet taken.
+        bool stopping = false;                               //!< Tells the workers to quit.
+
+        std::mutex done_mtx;                                 //!< Guards Chunk::done.
+        std::condition_variable done_cv;                     //!< Signals a finished chunk.
+
+        std::atomic< size_type > n_cache_hits{ 0 };          //!< Sum of the workers' cache hits.
+        std::atomic< size_type > n_cache_misses{ 0 };        //!< Sum of the workers' cache misses.
+
+        void submit( void );                                  // Hands `current` to the workers.
+        std::shared_ptr< Chunk > new_chunk( void );           // A recycled chunk, if there is one.
+        void write_front( void );                             // Waits for the oldest chunk and writes it.
+        std::shared_ptr< Chunk > take( size_type id_ );       // Gets work for worker `id_`.
+        void work( size_type id_ );                           // Worker main loop.
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef _BIGINT_H_
+#define _BIGINT_H_
+
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <vector>      // std::vector
+#include <cstdint>     // std::uint32_t, std::uint64_t
+#include <cstddef>     // std::size_t
+
+#include "arithmetic.h" // arithmetic::error_t.
+
+/*!
+ * An integer of any size (up to `MAX_BITS`), for the `--width big` evaluation.
+ *
+ * The magnitude is kept in 32-bit limbs, least significant first, with no leading zero
+ * limbs (zero has none), and the sign apart.  Products of large numbers, which is where
+ * "^" spends its time, use Karatsuba's method (three half size products instead of four)
+ * above `KARATSUBA_THRESHOLD` limbs, and the schoolbook method below it.
+ *
+ * The operations follow the same rules as the checked arithmetic of the other widths
+ * (see arithmetic.h): "/" truncates toward zero, "%" has the sign of the dividend, and a
+ * negative power gives the integer part of the fraction.  Nothing overflows, except that
+ * a result larger than `MAX_BITS` bits is reported as NUMERIC_OVERFLOW, so that
+ * "9 ^ 9 ^ 9" cannot eat up the memory.
+ */
+class BigInt
+{
+    public:
+        //=== Aliases
+        typedef std::uint32_t limb_type;        //!< A digit, in base 2^32.
+        typedef std::uint64_t double_limb_type; //!< Holds the product of two limbs.
+        typedef std::size_t size_type;          //!< Used for counting limbs and bits.
+
+        /// Largest result, in bits.
+        static constexpr size_type MAX_BITS = size_type( 1 ) << 20;
+        /// Products with both factors at least this long (in limbs) are split (Karatsuba).
+        static constexpr size_type KARATSUBA_THRESHOLD = 32;
+        /// Numbers up to this long (in limbs) are converted to and from decimal one group of nine digits at a time.
+        static constexpr size_type SMALL_CONVERSION = 32;
+
+        /// Zero.
+        BigInt() = default;
+        /// Converts a built in integer (implicitly, as between built in integers).
+        BigInt( long long v_ ) { *this = v_; }
+        /// Assigns a built in integer, keeping the memory already allocated.
+        BigInt & operator=( long long v_ );
+
+        /// Reads a decimal integer ("-" and digits). Returns false if `text_` is not one.
+        static bool parse( std::string_view text_, BigInt & r_ );
+        /// Appends the decimal representation to `out_`.
+        void append_to( std::string & out_ ) const;
+        /// The decimal representation.
+        std::string to_string( void ) const;
+
+        /// Whether this is zero.
+        bool is_zero( void ) const { return limbs.empty(); }
+        /// Whether this is less than zero.
+        bool is_negative( void ) const { return negative; }
+        /// Number of bits of the magnitude (0 for zero).
+        size_type bits( void ) const;
+        /// The `n_` (at most 64) most significant bits of the magnitude (all of them, if there are fewer).
+        std::uint64_t leading_bits( size_type n_ ) const;
+
+        /// Whether both have the same value.
+        friend bool operator==( const BigInt & a_, const BigInt & b_ )
+        { return a_.negative == b_.negative and a_.limbs == b_.limbs; }
+        /// Whether the values differ.
+        friend bool operator!=( const BigInt & a_, const BigInt & b_ ) { return not ( a_ == b_ ); }
+        /// Whether `a_` is smaller than `b_`.
+        friend bool operator<( const BigInt & a_, const BigInt & b_ );
+        /// Whether `a_` is larger than `b_`.
+        friend bool operator>( const BigInt & a_, const BigInt & b_ ) { return b_ < a_; }
+
+        //=== The checked operations (`r_` may be either operand).
+        static arithmetic::error_t add( const BigInt & a_, const BigInt & b_, BigInt & r_ );
+        static arithmetic::error_t sub( const BigInt & a_, const BigInt & b_, BigInt & r_ );
+        static arithmetic::error_t mul( const BigInt & a_, const BigInt & b_, BigInt & r_ );
+        static arithmetic::error_t div( const BigInt & a_, const BigInt & b_, BigInt & r_ );
+        static arithmetic::error_t mod( const BigInt & a_, const BigInt & b_, BigInt & r_ );
+        static arithmetic::error_t pow( const BigInt & a_, const BigInt & b_, BigInt & r_ );
+
+        /// `r_ = a_ * b_`, with no limit on the size.
+        static void multiply_unchecked( const BigInt & a_, const BigInt & b_, BigInt & r_ );
+
+    private:
+        std::vector< limb_type > limbs; //!< The magnitude, least significant limb first.
+        bool negative = false;          //!< The sign (never set for zero).
+
+        void trim( void );                             // Drops leading zero limbs (and the sign of zero).
+        bool is_unit( void ) const;                    // Whether the magnitude is 1.
+        static arithmetic::error_t add_signed( const BigInt & a_, const BigInt & b_, bool b_negative_, BigInt & r_ );
+        static void divide( const BigInt & a_, const BigInt & b_, BigInt * q_, BigInt * r_ ); // Truncated division.
+        static void parse_digits( std::string_view digits_, const std::vector< BigInt > & powers_, BigInt & r_ );
+        static void append_digits( std::string & out_, const BigInt & m_, const std::vector< BigInt > & powers_,
+                                   size_type k_, bool pad_ );
+};
+
+namespace arithmetic {
+
+/// @name The operations of arithmetic.h, for BigInt.
+///@{
+inline error_t add( const BigInt & a_, const BigInt & b_, BigInt & r_ ) { return BigInt::add( a_, b_, r_ ); }
+inline error_t sub( const BigInt & a_, const BigInt & b_, BigInt & r_ ) { return BigInt::sub( a_, b_, r_ ); }
+inline error_t mul( const BigInt & a_, const BigInt & b_, BigInt & r_ ) { return BigInt::mul( a_, b_, r_ ); }
+inline error_t div( const BigInt & a_, const BigInt & b_, BigInt & r_ ) { return BigInt::div( a_, b_, r_ ); }
+inline error_t mod( const BigInt & a_, const BigInt & b_, BigInt & r_ ) { return BigInt::mod( a_, b_, r_ ); }
+inline error_t pow( const BigInt & a_, const BigInt & b_, BigInt & r_ ) { return BigInt::pow( a_, b_, r_ ); }
+///@}
+
+} // namespace arithmetic
+
+#endif
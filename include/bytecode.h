@@ -0,0 +1,177 @@
+#ifndef _BYTECODE_H_
+#define _BYTECODE_H_
+
+#include <iostream> // std::ostream
+#include <vector>   // std::vector
+#include <array>    // std::array
+#include <string>   // std::string
+#include <string_view> // std::string_view
+#include <cstdint>  // std::uint8_t, std::int16_t
+#include <cstddef>  // std::size_t
+
+#include "arithmetic.h" // Checked operations.
+#include "grammar.h"    // grammar::width_t.
+
+/*!
+ * A compiled expression.
+ *
+ * The program is a flat array of bytes in postfix order: each operator is a single opcode
+ * and each operand is an `OP_PUSH` opcode followed by its 16-bit value stored inline
+ * (little endian), or an `OP_LOAD` followed by the 16-bit index of a variable.  Constants
+ * wider than 16 bits (see Parser::set_width()) are an `OP_PUSH64` with a 64-bit value or,
+ * beyond that, an `OP_LITERAL` that refers to their digits, kept apart.  The
+ * program also knows how deep the evaluation stack gets, so that the virtual machine can
+ * run it without ever checking for stack growth, and the column of each operator in the
+ * source expression, so that run time errors can point to it.
+ *
+ * Programs are emitted by the Parser while it validates an expression.
+ */
+class Program
+{
+    public:
+        //==== Aliases
+        typedef long int value_type;         //!< Type we operate on.
+        typedef std::int16_t immediate_type; //!< Type of the operands stored inline in the code.
+        typedef std::size_t size_type;       //!< Used for sizes and stack depths.
+
+        /// The instruction set.
+        enum opcode_t : std::uint8_t {
+            OP_PUSH = 0, //!< Pushes the 16-bit immediate that follows the opcode.
+            OP_ADD,      //!< "+"
+            OP_SUB,      //!< "-"
+            OP_MUL,      //!< "*"
+            OP_DIV,      //!< "/"
+            OP_MOD,      //!< "%"
+            OP_POW,      //!< "^"
+            OP_LOAD,     //!< Pushes the value of the variable whose 16-bit index follows the opcode.
+            OP_PUSH64,   //!< Pushes the 64-bit immediate that follows the opcode.
+            OP_LITERAL   //!< Pushes the constant whose 32-bit offset and length in the literals follow the opcode.
+        };
+
+        /// How far the emission of a program has gone (see mark() and rewind()).
+        struct Mark
+        {
+            size_type code_size;   //!< Bytes of code.
+            size_type n_sites;     //!< Operators emitted.
+            size_type depth;       //!< Stack depth after the last instruction.
+            size_type max_depth;   //!< Maximum stack depth so far.
+            size_type n_variables; //!< Variables needed so far.
+            size_type n_literals;  //!< Characters of the literals.
+        };
+
+        //==== Public interface
+        /// Removes all instructions, keeping the allocated memory for the next expression.
+        void clear( void );
+        /// Where the emission is now.
+        Mark mark( void ) const { return Mark{ code.size(), sites.size(), depth, max_depth, n_variables, literals.size() }; }
+        /// Drops the instructions emitted after `mark_` was taken, as if they had never been emitted.
+        void rewind( const Mark & mark_ );
+        /// Appends an instruction that pushes the operand `v_`.
+        void emit_push( immediate_type v_ );
+        /// Appends an instruction that pushes the 64-bit operand `v_`.
+        void emit_push64( std::int64_t v_ );
+        /// Appends an instruction that pushes the constant written as `digits_` (an optional "-" and decimal digits).
+        void emit_literal( std::string_view digits_ );
+        /// Appends the instruction for the binary operator `op_` (one of "+-*/%^") found at column `col_`.
+        void emit_operator( char op_, size_type col_=0 );
+        /// Appends an instruction that pushes the value of variable number `index_`.
+        void emit_load( std::uint16_t index_ );
+
+        /// Retrieves the code.
+        const std::vector< std::uint8_t > & get_code( void ) const { return code; }
+        /// The digits of the constant of the `OP_LITERAL` whose operands start at `pc_`.
+        std::string_view get_literal( const std::uint8_t * pc_ ) const;
+        /// Retrieves the maximum stack depth reached while running the program.
+        size_type get_max_depth( void ) const { return max_depth; }
+        /// Number of variables the program needs (one more than the largest index loaded).
+        size_type get_n_variables( void ) const { return n_variables; }
+        /// Column of the operator whose instruction is at `offset_` in the code.
+        size_type get_column( size_type offset_ ) const;
+        /// Column of the operator that computes the final result (0 if there is none).
+        size_type get_result_column( void ) const;
+        /// Checks whether there are any instructions.
+        bool empty( void ) const { return code.empty(); }
+
+        /// Appends the program to `out_`, in the binary form of precompiled files (see compiled.h).
+        void save( std::string & out_ ) const;
+        /// Replaces the program with the one saved at `p_`, and moves `p_` past it. False if it is not a valid program of the width `width_`.
+        bool load( const std::uint8_t * & p_, const std::uint8_t * end_, grammar::width_t width_ );
+
+        /// Prints the program in a readable (postfix) form, to help us debug the code.
+        friend std::ostream & operator<<( std::ostream & os_, const Program & p_ );
+
+    private:
+        std::vector< std::uint8_t > code; //!< The instructions.
+        size_type depth = 0;              //!< Stack depth after the last instruction.
+        size_type max_depth = 0;          //!< Maximum stack depth.
+        size_type n_variables = 0;        //!< See get_n_variables().
+        std::string literals;             //!< The digits of the `OP_LITERAL` constants, one after the other.
+
+        /// Where an operator came from.
+        struct Site
+        {
+            size_type offset; //!< Offset of its instruction in the code.
+            size_type column; //!< Its column in the source expression.
+        };
+        std::vector< Site > sites;        //!< One per operator, in the order of the code.
+};
+
+/*!
+ * A stack based virtual machine that runs a Program.
+ *
+ * Programs run on a fixed-size array; only programs deeper than `STACK_SIZE` fall back
+ * to a stack allocated on the heap (and kept for later runs).
+ *
+ * The machine is a template over the type it operates on, so that each width (see
+ * Parser::set_width()) runs its own loop, with the operations of arithmetic.h inlined for
+ * that type: `VM` (64-bit, the original BARES) is not slowed down by the others.  It is
+ * instantiated (in bytecode.cpp) for `long`, std::int32_t, __int128 and BigInt.
+ */
+template < typename T >
+class BasicVM
+{
+    public:
+        //=== Aliases
+        typedef T value_type; //!< Type we operate on.
+
+        /// This struct represents the result of running a program.
+        struct ResultType
+        {
+            /// List of possible run time errors (the same as the arithmetic::error_t).
+            enum code_t {
+                OK = arithmetic::NO_ERROR,                     //!< Expression successfuly evaluated.
+                DIVISION_BY_ZERO = arithmetic::DIVISION_BY_ZERO, //!< "/" with a zero divisor.
+                MODULO_BY_ZERO = arithmetic::MODULO_BY_ZERO,     //!< "%" with a zero divisor.
+                NUMERIC_OVERFLOW = arithmetic::NUMERIC_OVERFLOW  //!< Some operation left the range of `value_type`.
+            };
+
+            //=== Members (public).
+            code_t type;                //!< Error code.
+            value_type value;           //!< The result, when there is no error.
+            Program::size_type at_col;  //!< Column of the operator that failed, when there is an error.
+
+            /// Default contructor.
+            explicit ResultType( code_t type_=OK , value_type value_=0, Program::size_type col_=0 )
+                    : type{ type_ }
+                    , value{ value_ }
+                    , at_col{ col_ }
+            { /* empty */ }
+        };
+
+        /// Size of the built in stack.
+        static constexpr Program::size_type STACK_SIZE = 256;
+
+        /// Runs the program (with `variables_[i]` as the value of variable `i`) and returns its result.
+        ResultType run( const Program & program_, const value_type * variables_=nullptr );
+
+    private:
+        ResultType fail( const Program & program_, const std::uint8_t * pc_, arithmetic::error_t error_ ) const;
+
+        std::array< value_type, STACK_SIZE > stack;  //!< The evaluation stack.
+        std::vector< value_type > large_stack;       //!< Used only by programs that do not fit in `stack`.
+};
+
+/// The virtual machine of the original BARES (and of formulas).
+typedef BasicVM< Program::value_type > VM;
+
+#endif
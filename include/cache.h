@@ -0,0 +1,62 @@
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <string>        // std::string
+#include <string_view>   // std::string_view
+#include <list>          // std::list
+#include <unordered_map> // std::unordered_map
+#include <cstddef>       // std::size_t
+
+#include "evaluator.h"   // struct Outcome.
+
+/*!
+ * A bounded cache (least recently used) of the outcomes of expressions.
+ *
+ * The key is the expression with every run of blanks/tabs collapsed into a single blank.
+ * The parser treats any run of white spaces the same way, so two expressions with the
+ * same key have the same outcome; only the columns of the errors differ, and they are
+ * translated back to the expression that was looked up.
+ */
+class OutcomeCache
+{
+    public:
+        //=== Alias
+        typedef std::size_t size_type; //!< Used for sizes and counters.
+
+        /// Creates a cache that holds at most `capacity_` outcomes.
+        explicit OutcomeCache( size_type capacity_ );
+        /// Turn off copy constructor (the index points into the entries).
+        OutcomeCache( const OutcomeCache & ) = delete;
+        /// Turn off assignment operator.
+        OutcomeCache & operator=( const OutcomeCache & ) = delete;
+
+        /// Looks up the expression `e_`. Returns true (and fills in `outcome_`) on a hit.
+        bool find( std::string_view e_, Outcome & outcome_ );
+        /// Stores the outcome of the expression last looked up with find().
+        void insert( const Outcome & outcome_ );
+
+        /// Number of successful lookups.
+        size_type hits( void ) const { return n_hits; }
+        /// Number of failed lookups.
+        size_type misses( void ) const { return n_misses; }
+        /// Number of outcomes stored.
+        size_type size( void ) const { return index.size(); }
+
+    private:
+        /// An expression (normalized) and its outcome.
+        struct Entry
+        {
+            std::string key; //!< The normalized expression.
+            Outcome outcome; //!< Its outcome, with columns relative to `key`.
+        };
+
+        size_type capacity;                      //!< Maximum number of entries.
+        std::list< Entry > entries;              //!< Most recently used first.
+        std::unordered_map< std::string_view, std::list< Entry >::iterator > index; //!< Entries by key.
+        std::string key;                         //!< Key of the last lookup (reused buffer).
+        std::string_view source;                 //!< Expression of the last lookup.
+        size_type n_hits = 0;                    //!< Successful lookups.
+        size_type n_misses = 0;                  //!< Failed lookups.
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _COLUMN_H_
+#define _COLUMN_H_
+
+#include <vector>  // std::vector
+#include <cstdint> // std::uint8_t
+#include <cstddef> // std::size_t
+
+#include "bytecode.h" // class Program, class VM.
+
+/*!
+ * Runs one Program over many rows of variable values at once.
+ *
+ * The values come in columns (one array per variable, structure of arrays).  Rows are
+ * processed in blocks of `BLOCK`: every slot of the evaluation stack holds a whole block,
+ * and each instruction is a tight loop over it (vectorized with SSE2 or AVX2, chosen at run
+ * time like the Scanner kernels; BARES_SIMD=scalar turns it off).
+ *
+ * Lanes that need care are flagged instead of branching: an operation that may have
+ * overflowed, a zero divisor, a "/" or "%" whose operands are too large to go through a
+ * `double` exactly, or a "^" that is negative or leaves the exact range, makes the row
+ * "hard", and hard rows are run again, one by one, by the scalar VM (which also tells the
+ * error and its column).  So every row gets exactly what VM::run() would have returned.
+ */
+class ColumnVM
+{
+    public:
+        //=== Aliases
+        typedef Program::value_type value_type; //!< Type we operate on.
+        typedef std::size_t size_type;          //!< Used for counting rows.
+
+        /// Rows evaluated together.
+        static constexpr size_type BLOCK = 256;
+
+        /// Runs `program_` for `n_rows_` rows; variable `v` of row `r` is `columns_[v][r]`.
+        void run( const Program & program_, const value_type * const * columns_, size_type n_rows_,
+                  VM::ResultType * results_ );
+
+        /// Name of the implementation in use.
+        static const char * name( void );
+
+    private:
+        std::vector< value_type > stack;   //!< BLOCK values per stack slot.
+        std::vector< std::uint8_t > flags; //!< Per row of the block: see the kernels.
+        std::vector< value_type > row;     //!< Variables of a hard row.
+        VM vm;                             //!< Runs the hard rows.
+
+        void run_block( const Program & program_, const value_type * const * columns_, size_type first_,
+                        size_type n_, VM::ResultType * results_ );
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef _COMPILED_H_
+#define _COMPILED_H_
+
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <cstdint>     // std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstddef>     // std::size_t
+
+#include "parser.h"    // class Parser, grammar::width_t.
+#include "bytecode.h"  // class Program.
+#include "reader.h"    // class LineReader.
+#include "writer.h"    // class OutputWriter.
+
+/*!
+ * A file of precompiled expressions (".bexp"), written by `bares compile` and evaluated
+ * by `bares` with no lexing or parsing: each line of the source is kept with its program
+ * or its parsing error, so a run only reads the file (memory mapped) and evaluates.
+ *
+ * The layout, with every number little endian, is:
+ * ```
+ *   "BEXP", version (u32), width (u8, grammar::width_t), 3 zero bytes
+ *   for each line of the source:
+ *     size of the line (u32), the line (for the reports)
+ *     parsing result (u8, Parser::ResultType::code_t), then
+ *       OK:        the program (see Program::save())
+ *       otherwise: the column of the error (u32)
+ *   number of lines (u64)
+ * ```
+ * Files of another version are refused; a new version is needed whenever the layout or
+ * the instruction set changes.
+ */
+class CompiledFile
+{
+    public:
+        //=== Alias
+        typedef std::size_t size_type; //!< Used for sizes and offsets.
+
+        /// The first bytes of every precompiled file.
+        static constexpr std::string_view MAGIC = "BEXP";
+        /// Version of the layout written.
+        static constexpr std::uint32_t VERSION = 1;
+        /// Size of the header (magic, version, width and padding).
+        static constexpr size_type HEADER_SIZE = 12;
+        /// Size of the trailer (number of lines).
+        static constexpr size_type TRAILER_SIZE = 8;
+        /// The output is written in blocks of this size.
+        static constexpr size_type BLOCK_SIZE = 1 << 20;
+
+        /// Compiles every line of `reader_` into the file `path_`. Returns false (with errno set; EINVAL if it is the input) if it cannot be written.
+        static bool compile( LineReader & reader_, const char * path_, grammar::width_t width_,
+                             Parser::size_type max_depth_ );
+
+        /// Maps the file `path_`, if it is a precompiled file (see is_open()).
+        explicit CompiledFile( const char * path_ );
+        /// Unmaps the file.
+        ~CompiledFile();
+        /// Turn off copy constructor.
+        CompiledFile( const CompiledFile & ) = delete;
+        /// Turn off assignment operator.
+        CompiledFile & operator=( const CompiledFile & ) = delete;
+
+        /// Whether the file is a precompiled file (it starts with `MAGIC`).
+        bool is_open( void ) const { return map_begin != nullptr; }
+        /// Whether the file is cut short, damaged or of another version (nothing more is read from it).
+        bool is_damaged( void ) const { return damaged; }
+        /// Width the expressions were compiled with.
+        grammar::width_t get_width( void ) const { return width; }
+
+        /// Gets the next line and either its parsing error or its program. False at the end, or if the file is damaged.
+        bool next( std::string_view & line_, Parser::ResultType & result_, Program & program_ );
+        /// Evaluates every line (with the width of the file) and reports it through `writer_`. False if the file is damaged.
+        bool run( OutputWriter & writer_ );
+
+    private:
+        const std::uint8_t * map_begin = nullptr; //!< The mapping (nullptr if it is not a precompiled file).
+        size_type map_size = 0;                   //!< Size of the mapping.
+        size_type pos = 0;                        //!< Offset of the next line.
+        size_type records_end = 0;                //!< Offset of the trailer.
+        std::uint64_t n_lines = 0;                //!< Lines the trailer says there are.
+        std::uint64_t n_read = 0;                 //!< Lines read so far.
+        grammar::width_t width = grammar::width_t::W16; //!< See get_width().
+        bool damaged = false;                     //!< See is_damaged().
+
+        template < typename T, typename Finish >
+        void run_as( OutputWriter & writer_, Finish finish_ ); // run() with the VM of `T`.
+};
+
+#endif
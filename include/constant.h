@@ -0,0 +1,292 @@
+#ifndef _CONSTANT_H_
+#define _CONSTANT_H_
+
+#include <array>       // std::array
+#include <cstddef>     // std::size_t
+#include <limits>      // std::numeric_limits
+
+#include "grammar.h"    // The rules shared with the Parser.
+#include "arithmetic.h" // The operations shared with the VM.
+#include "evaluator.h"  // struct Outcome, result_in_range().
+
+/*!
+ * Evaluation of expressions at compile time, for formulas that are fixed when the
+ * program is built:
+ *
+ *     constexpr long limit = BARES_CONSTANT( "2 ^ 15 - 1" );       // 32767
+ *     constexpr auto r = constant::evaluate( "(1 + 2" );           // r.code == MISSING_CLOSING
+ *     long bad = BARES_CONSTANT( "7 / (3 - 3)" );                  // does not compile
+ *
+ * The expression is parsed the way the Parser does it, with the same character classes,
+ * precedence and associativity, and the same range for the integers (grammar.h), and the
+ * operators are applied with the same checked arithmetic as the VM (arithmetic.h).  So a
+ * literal gets exactly the outcome, and error column, the Evaluator would give it at run
+ * time.  BARES_CONSTANT() turns an error into a compile error that quotes its message
+ * and shows its column.
+ */
+namespace constant {
+
+//=== Aliases
+typedef Outcome::value_type value_type; //!< Type of the results.
+typedef std::size_t size_type;          //!< Used for sizes and positions.
+typedef Parser::ResultType::size_type column_type; //!< Used for the columns reported.
+
+/// The outcome of an expression (see struct Outcome).
+struct Result
+{
+    Outcome::status_t status = Outcome::OK;                 //!< What happened.
+    Parser::ResultType::code_t code = Parser::ResultType::OK; //!< The syntax error, for PARSE_ERROR.
+    column_type column = 0;                                 //!< Column of the error, as the compact format reports it (0 based, never negative).
+    value_type value = 0;                                   //!< The result, for OK.
+};
+
+/*!
+ * Parses and evaluates one expression in a single pass, with stacks of `N` entries (an
+ * expression of fewer than `N` characters cannot need more).
+ *
+ * Each step mirrors the one of the Parser with the same name; the operators are applied
+ * when the Parser would emit them, which is the order the VM runs them in.  As with the
+ * VM, which only runs programs that parsed, a syntax error later in the expression wins
+ * over an arithmetic error.
+ */
+template < size_type N >
+class Machine
+{
+    public:
+        /// Prepares to evaluate the `size_` characters of `e_` (fewer than `N`).
+        constexpr Machine( const char * e_, size_type size_ )
+            : expr{ e_ }
+            , size{ size_ }
+        { /* empty */ }
+
+        /// Parses and evaluates the expression.
+        constexpr Result run( void )
+        {
+            Result result;
+            parse( result );
+            if ( result.code != Parser::ResultType::OK )
+            {
+                result.status = Outcome::PARSE_ERROR;
+                return result;
+            }
+            switch ( error )
+            {
+                case arithmetic::NO_ERROR:
+                    result.value = values[0];
+                    if ( result_in_range( result.value ) ) return result;
+                    result.value = 0;
+                    result.status = Outcome::NUMERIC_OVERFLOW;
+                    result.column = column_type( result_column );
+                    return result;
+                case arithmetic::DIVISION_BY_ZERO: result.status = Outcome::DIVISION_BY_ZERO; break;
+                case arithmetic::MODULO_BY_ZERO:   result.status = Outcome::MODULO_BY_ZERO;   break;
+                case arithmetic::NUMERIC_OVERFLOW: result.status = Outcome::NUMERIC_OVERFLOW; break;
+            }
+            result.column = column_type( error_column );
+            return result;
+        }
+
+    private:
+        const char * expr;                  //!< The expression.
+        size_type size;                     //!< Its length.
+        size_type pos = 0;                  //!< The current character.
+        std::array< char, N > operators{};  //!< Operators waiting for their right operand, and "(" of the open scopes...
+        std::array< size_type, N > columns{}; //!< ... and their columns.
+        size_type n_operators = 0;          //!< Entries of `operators`.
+        std::array< value_type, N > values{}; //!< The operands computed so far.
+        size_type n_values = 0;             //!< Entries of `values`.
+        size_type depth = 0;                //!< Number of scopes open.
+        arithmetic::error_t error = arithmetic::NO_ERROR; //!< The first operation that failed...
+        size_type error_column = 0;         //!< ... and the column of its operator.
+        size_type result_column = 0;        //!< Column of the last operator applied.
+
+        constexpr bool end_input( void ) const { return pos == size; }
+        constexpr bool accept( char_class_t c_ )
+        {
+            if ( end_input() or grammar::classify( static_cast< unsigned char >( expr[pos] ) ) != c_ ) return false;
+            ++pos;
+            return true;
+        }
+        constexpr void skip_ws( void )
+        {
+            while ( accept( CC_WS ) or accept( CC_TAB ) ) { /* empty */ }
+        }
+        constexpr bool digit( void ) { return accept( CC_ZERO ) or accept( CC_NON_ZERO_DIGIT ); }
+
+        /// Applies the operator `op_`, found at `column_`, to the two operands on top.
+        constexpr void apply( char op_, size_type column_ )
+        {
+            value_type b = values[ --n_values ];
+            value_type & a = values[ n_values - 1 ];
+            result_column = column_;
+            if ( error != arithmetic::NO_ERROR ) return; // The VM would have stopped already.
+            switch ( op_ )
+            {
+                case '+': error = arithmetic::add( a, b, a ); break;
+                case '-': error = arithmetic::sub( a, b, a ); break;
+                case '*': error = arithmetic::mul( a, b, a ); break;
+                case '/': error = arithmetic::div( a, b, a ); break;
+                case '%': error = arithmetic::mod( a, b, a ); break;
+                default:  error = arithmetic::pow( a, b, a ); break;
+            }
+            error_column = column_;
+        }
+
+        /// Applies the pending operators of the innermost open scope that go before `op_` (all of them when `op_` is zero).
+        constexpr void reduce( char op_ )
+        {
+            while ( n_operators != 0 and operators[ n_operators - 1 ] != '(' )
+            {
+                if ( op_ != 0 and not grammar::applies_before( operators[ n_operators - 1 ], op_ ) ) break;
+                --n_operators;
+                apply( operators[ n_operators ], columns[ n_operators ] );
+            }
+        }
+
+        constexpr void push_operator( char op_, size_type column_ )
+        {
+            operators[ n_operators ] = op_;
+            columns[ n_operators++ ] = column_;
+        }
+
+        /// Stores a syntax error found at `at_col_` (a column of the Parser, before reported_column()).
+        constexpr bool fail( Result & result_, Parser::ResultType::code_t code_, size_type at_col_ )
+        {
+            result_.code = code_;
+            result_.column = grammar::reported_column( code_ == Parser::ResultType::ILL_FORMED_INTEGER, column_type( at_col_ ) );
+            return false;
+        }
+
+        constexpr void parse( Result & result_ )
+        {
+            skip_ws();
+            if ( end_input() )
+                fail( result_, Parser::ResultType::UNEXPECTED_END_OF_EXPRESSION, pos );
+            else if ( expression( result_ ) )
+            {
+                skip_ws();
+                if ( not end_input() ) fail( result_, Parser::ResultType::EXTRANEOUS_SYMBOL, pos );
+            }
+        }
+
+        constexpr bool expression( Result & result_ )
+        {
+            for (;;)
+            {
+                // Expecting a term: any number of "(" and then an integer.
+                skip_ws();
+                size_type begin = pos;
+                if ( accept( CC_OP_SCOPE ) )
+                {
+                    if ( depth == Parser::DEFAULT_MAX_DEPTH )
+                        return fail( result_, Parser::ResultType::NESTING_TOO_DEEP, begin );
+                    push_operator( '(', begin );
+                    ++depth;
+                    continue;
+                }
+                if ( not term( result_ ) ) return false;
+
+                // After a term: an operator, a ")" or the end of the (sub)expression.
+                for (;;)
+                {
+                    skip_ws();
+                    if ( not end_input() and grammar::is_operator( expr[pos] ) )
+                    {
+                        char op = expr[ pos++ ];
+                        reduce( op );
+                        push_operator( op, pos - 1 );
+                        break;
+                    }
+
+                    reduce( 0 );
+                    if ( n_operators == 0 ) return true;
+                    if ( not accept( CC_CL_SCOPE ) )
+                        return fail( result_, Parser::ResultType::MISSING_CLOSING, pos );
+                    --n_operators;
+                    --depth;
+                }
+            }
+        }
+
+        constexpr bool term( Result & result_ )
+        {
+            constexpr value_type limit = value_type( std::numeric_limits< grammar::integer_type >::max() ) + 1;
+
+            skip_ws();
+            size_type begin = pos;
+            if ( end_input() )
+                return fail( result_, Parser::ResultType::MISSING_TERM, pos );
+            if ( accept( CC_OPERATOR ) )
+                return fail( result_, Parser::ResultType::ILL_FORMED_INTEGER, pos );
+
+            // <integer>, accumulated as the digits are read.
+            value_type value = 0;
+            if ( not accept( CC_ZERO ) )
+            {
+                bool negative = accept( CC_MINUS );
+                if ( not accept( CC_NON_ZERO_DIGIT ) )
+                    return fail( result_, Parser::ResultType::ILL_FORMED_INTEGER, pos );
+                value = expr[ pos - 1 ] - '0';
+                while ( value <= limit and digit() )
+                    value = value * 10 + ( expr[ pos - 1 ] - '0' );
+                while ( value > limit and digit() ) { /* Out of range: skip the other digits. */ }
+                if ( negative ) value = -value;
+            }
+            if ( value < std::numeric_limits< grammar::integer_type >::min() or
+                 value > std::numeric_limits< grammar::integer_type >::max() )
+                return fail( result_, Parser::ResultType::INTEGER_OUT_OF_RANGE, begin );
+
+            values[ n_values++ ] = value;
+            return true;
+        }
+};
+
+/// Evaluates the string literal `e_`; usable in constant expressions.
+template < size_type N >
+constexpr Result evaluate( const char ( &e_ )[N] )
+{
+    return Machine< N >( e_, N - 1 ).run();
+}
+
+/// Always false, but only known once `Column_` is given (so a static_assert waits for the instantiation).
+template < column_type Column_ >
+constexpr bool error_at_column = false;
+
+/// Compiles only for an expression without errors (see BARES_CONSTANT).
+template < Outcome::status_t Status_, Parser::ResultType::code_t Code_, column_type Column_ >
+struct check { };
+
+// One specialization per error, each quoting its message; the column is in the template arguments.
+#define BARES_CONSTANT_ERROR( status, code, message ) \
+    template < column_type Column_ > \
+    struct check< Outcome::status, Parser::ResultType::code, Column_ > \
+    { static_assert( error_at_column< Column_ >, message " Column_ (see the check<> being instantiated)" ); };
+
+BARES_CONSTANT_ERROR( PARSE_ERROR, UNEXPECTED_END_OF_EXPRESSION, BARES_MSG_UNEXPECTED_END_OF_EXPRESSION )
+BARES_CONSTANT_ERROR( PARSE_ERROR, ILL_FORMED_INTEGER, BARES_MSG_ILL_FORMED_INTEGER )
+BARES_CONSTANT_ERROR( PARSE_ERROR, MISSING_TERM, BARES_MSG_MISSING_TERM )
+BARES_CONSTANT_ERROR( PARSE_ERROR, EXTRANEOUS_SYMBOL, BARES_MSG_EXTRANEOUS_SYMBOL )
+BARES_CONSTANT_ERROR( PARSE_ERROR, INTEGER_OUT_OF_RANGE, BARES_MSG_INTEGER_OUT_OF_RANGE )
+BARES_CONSTANT_ERROR( PARSE_ERROR, MISSING_CLOSING, BARES_MSG_MISSING_CLOSING )
+BARES_CONSTANT_ERROR( PARSE_ERROR, NESTING_TOO_DEEP, BARES_MSG_NESTING_TOO_DEEP )
+BARES_CONSTANT_ERROR( DIVISION_BY_ZERO, OK, BARES_MSG_DIVISION_BY_ZERO " at column" )
+BARES_CONSTANT_ERROR( MODULO_BY_ZERO, OK, BARES_MSG_MODULO_BY_ZERO " at column" )
+BARES_CONSTANT_ERROR( NUMERIC_OVERFLOW, OK, BARES_MSG_NUMERIC_OVERFLOW " at column" )
+
+#undef BARES_CONSTANT_ERROR
+
+/// The value of an expression that has been checked.
+template < Outcome::status_t Status_, Parser::ResultType::code_t Code_, column_type Column_, value_type Value_ >
+struct checked : check< Status_, Code_, Column_ >
+{
+    static constexpr value_type value = Value_;
+};
+
+} // namespace constant
+
+/// The value of the expression in the string literal `e_`, computed at compile time (a compile error if it has none).
+#define BARES_CONSTANT( e_ ) \
+    ( ::constant::checked< ::constant::evaluate( e_ ).status, ::constant::evaluate( e_ ).code, \
+                           ::constant::evaluate( e_ ).column, ::constant::evaluate( e_ ).value >::value )
+
+#endif
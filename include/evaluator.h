@@ -0,0 +1,177 @@
+#ifndef _EVALUATOR_H_
+#define _EVALUATOR_H_
+
+#include <string_view> // std::string_view
+#include <memory>      // std::unique_ptr
+#include <cstddef>     // std::size_t
+#include <limits>      // std::numeric_limits
+
+#include "parser.h"   // class Parser.
+#include "bytecode.h" // class VM.
+
+/// What happened to one expression, apart from its value (see BasicOutcome).
+struct OutcomeBase
+{
+    //=== Alias
+    typedef Program::size_type size_type;  //!< Used for columns.
+
+    /// List of possible outcomes.
+    enum status_t {
+        OK = 0,           //!< Expression parsed and evaluated.
+        PARSE_ERROR,      //!< Syntax error, details in `parse_result`.
+        DIVISION_BY_ZERO, //!< "/" with a zero divisor.
+        MODULO_BY_ZERO,   //!< "%" with a zero divisor.
+        NUMERIC_OVERFLOW  //!< The result, or some step on the way to it, does not fit.
+    };
+
+    //=== Members (public).
+    status_t status;                 //!< What happened.
+    Parser::ResultType parse_result; //!< The parser result (meaningful for PARSE_ERROR).
+    size_type at_col = 0;            //!< Column of the operator that failed (meaningful for the run time errors).
+
+    /// Default contructor.
+    explicit OutcomeBase( status_t status_=OK, Parser::ResultType parse_result_=Parser::ResultType() )
+        : status{ status_ }
+        , parse_result{ parse_result_ }
+    { /* empty */ }
+};
+
+/// The final outcome of processing one expression, whose value is a `T`.
+template < typename T >
+struct BasicOutcome : OutcomeBase
+{
+    //=== Alias
+    typedef T value_type; //!< Type of the result.
+
+    //=== Members (public).
+    value_type value;     //!< The result (meaningful for OK).
+
+    /// Default contructor.
+    explicit BasicOutcome( status_t status_=OK, value_type value_=0,
+                           Parser::ResultType parse_result_=Parser::ResultType() )
+        : OutcomeBase( status_, parse_result_ )
+        , value{ value_ }
+    { /* empty */ }
+};
+
+/// The outcome of the original BARES (a 64-bit value, see make_outcome()).
+typedef BasicOutcome< VM::value_type > Outcome;
+
+/// Whether a final value is a valid result: it must lie strictly between the smallest and the largest `int`.
+constexpr bool result_in_range( Outcome::value_type value_ )
+{
+    return value_ > std::numeric_limits< int >::min() and value_ < std::numeric_limits< int >::max();
+}
+
+/*!
+ * Turns the result of running `program_` into an outcome.
+ *
+ * Besides the errors of the VM, the final value must fit in an `int`; if it does not, the
+ * overflow is blamed on the operator that computed it.
+ */
+inline Outcome make_outcome( const VM::ResultType & exec_, const Program & program_ )
+{
+    Outcome outcome;
+    switch ( exec_.type )
+    {
+        case VM::ResultType::OK:
+            if ( result_in_range( exec_.value ) )
+                return Outcome( Outcome::OK, exec_.value );
+            outcome.status = Outcome::NUMERIC_OVERFLOW;
+            outcome.at_col = program_.get_result_column();
+            return outcome;
+        case VM::ResultType::DIVISION_BY_ZERO: outcome.status = Outcome::DIVISION_BY_ZERO; break;
+        case VM::ResultType::MODULO_BY_ZERO:   outcome.status = Outcome::MODULO_BY_ZERO;   break;
+        case VM::ResultType::NUMERIC_OVERFLOW: outcome.status = Outcome::NUMERIC_OVERFLOW; break;
+    }
+    outcome.at_col = exec_.at_col;
+    return outcome;
+}
+
+/*!
+ * Turns the result of running `program_` on a BasicVM of another width into an outcome.
+ * The value is whatever the machine computed: it already fits in `T`.
+ */
+template < typename T >
+BasicOutcome< T > make_wide_outcome( const typename BasicVM< T >::ResultType & exec_ )
+{
+    BasicOutcome< T > outcome;
+    switch ( exec_.type )
+    {
+        case BasicVM< T >::ResultType::OK:               outcome.value = exec_.value; return outcome;
+        case BasicVM< T >::ResultType::DIVISION_BY_ZERO: outcome.status = OutcomeBase::DIVISION_BY_ZERO; break;
+        case BasicVM< T >::ResultType::MODULO_BY_ZERO:   outcome.status = OutcomeBase::MODULO_BY_ZERO;   break;
+        case BasicVM< T >::ResultType::NUMERIC_OVERFLOW: outcome.status = OutcomeBase::NUMERIC_OVERFLOW; break;
+    }
+    outcome.at_col = exec_.at_col;
+    return outcome;
+}
+
+/// How an Evaluator is set up.
+struct EvaluatorConfig
+{
+    std::size_t cache_size = 0;                              //!< Outcomes remembered (0: no cache).
+    Parser::size_type max_depth = Parser::DEFAULT_MAX_DEPTH; //!< Maximum nesting of parentheses (0: no limit).
+};
+
+class OutcomeCache;
+
+/*!
+ * Parses and evaluates expressions.
+ *
+ * An evaluator owns its own Parser and VM (and, optionally, a cache of outcomes) and
+ * has no shared state, so each thread may use its own instance.
+ */
+class Evaluator
+{
+    public:
+        /// Creates an evaluator set up as `config_` says.
+        explicit Evaluator( const EvaluatorConfig & config_=EvaluatorConfig() );
+        /// Default destructor.
+        ~Evaluator();
+
+        /// Parses and evaluates the expression `e_`.
+        Outcome evaluate( std::string_view e_ );
+        /// Parses and evaluates the `n_` expressions of `exprs_`, storing their outcomes in `results_` (same order).
+        void evaluate( const std::string_view * exprs_, std::size_t n_, Outcome * results_ );
+
+        /// Remembers the outcomes of the last `capacity_` distinct expressions (0 turns it off).
+        void set_cache( std::size_t capacity_ );
+        /// Retrieves the cache (nullptr if there is none), e.g. to read its counters.
+        const OutcomeCache * get_cache( void ) const { return cache.get(); }
+
+    private:
+        Parser parser;                       //!< Translates the expression into a program...
+        VM vm;                               //!< ... that is run by the virtual machine.
+        std::unique_ptr< OutcomeCache > cache; //!< Outcomes of the expressions already seen.
+
+        Outcome run( std::string_view e_ );  // Parses and evaluates, without the cache.
+};
+
+/*!
+ * Parses and evaluates expressions with one of the widths other than W16 (see
+ * Parser::set_width()): the constants and every operation are of type `T`, and the final
+ * value only has to fit in `T`.
+ *
+ * It is instantiated (in evaluator.cpp) for std::int32_t, `long` (64 bits), __int128 and
+ * BigInt; there is no cache.
+ */
+template < typename T >
+class WideEvaluator
+{
+    public:
+        //=== Alias
+        typedef BasicOutcome< T > outcome_type; //!< What an expression gives.
+
+        /// Creates an evaluator for the width `width_` (of type `T`), set up as `config_` says.
+        explicit WideEvaluator( grammar::width_t width_, const EvaluatorConfig & config_=EvaluatorConfig() );
+
+        /// Parses and evaluates the expression `e_`.
+        outcome_type evaluate( std::string_view e_ );
+
+    private:
+        Parser parser;   //!< Translates the expression into a program...
+        BasicVM< T > vm; //!< ... that is run by the virtual machine of `T`.
+};
+
+#endif
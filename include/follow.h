@@ -0,0 +1,97 @@
+#ifndef _FOLLOW_H_
+#define _FOLLOW_H_
+
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <vector>      // std::vector
+#include <chrono>      // std::chrono::steady_clock
+#include <cstdint>     // std::uint64_t
+#include <cstddef>     // std::size_t
+#include <csignal>     // sigset_t
+
+/*!
+ * Reads the lines appended to a file that keeps growing (the --follow option), like
+ * "tail -f", but from a given byte offset on.
+ *
+ * The file is read with pread() from the offset of the first byte not returned yet, so
+ * nothing is read twice, and only complete lines are returned: a line still being written
+ * stays in the buffer until its '\n' arrives.  When everything appended so far has been
+ * returned, wait() sleeps on inotify until the file changes (or SIGINT/SIGTERM arrives).
+ * A file that shrinks (truncated) is read again from the start; a file that is replaced
+ * (renamed, as logs are rotated) is read to its end and then the new one is followed.
+ *
+ * Data is read at most `READ_SIZE` bytes at a time, and next() stops at the end of each
+ * read, so the caller can flush the reports of every batch: a large append does not hold
+ * back the results of its first lines.  The latency of each batch is measured, from the
+ * moment its data was known to be there (see wait()) to the call to batch_done().
+ */
+class Follower
+{
+    public:
+        //=== Aliases
+        typedef std::size_t size_type;             //!< Used for sizes and offsets.
+        typedef std::chrono::steady_clock clock;   //!< Used for the latencies.
+
+        /// Bytes read at a time (at most one batch).
+        static constexpr size_type READ_SIZE = 1 << 20;
+        /// Without events, the file name is checked this often (milliseconds) for a replaced file.
+        static constexpr int RECHECK_INTERVAL = 1000;
+
+        /// Opens the file `filename_`, to be read from the byte `offset_` on (moved to the start of the next line).
+        explicit Follower( const char * filename_, size_type offset_=0 );
+        /// Closes the file, the watch and the signals.
+        ~Follower();
+        /// Turn off copy constructor.
+        Follower( const Follower & ) = delete;
+        /// Turn off assignment operator.
+        Follower & operator=( const Follower & ) = delete;
+
+        /// Checks whether the file could be opened and watched.
+        bool is_open( void ) const { return fd >= 0 and inotify_fd >= 0 and signal_fd >= 0; }
+        /// Gets the next complete line of the current batch (without the '\n'). Returns false at the end of the batch.
+        bool next( std::string_view & line_ );
+        /// Waits for the next batch. Returns false when stopped by SIGINT or SIGTERM (or an error, see errno).
+        bool wait( void );
+        /// Tells that the reports of the batch have been written, which ends its latency.
+        void batch_done( void );
+
+        /// Offset of the first byte not returned by next() yet (where to resume).
+        size_type get_offset( void ) const { return file_pos - ( buf_end - buf_pos ); }
+        /// Number of batches with lines done so far.
+        std::uint64_t batches( void ) const { return n_batches; }
+        /// Longest latency of a batch, in microseconds.
+        std::uint64_t max_latency( void ) const { return latency_max; }
+        /// Average latency of a batch, in microseconds.
+        std::uint64_t mean_latency( void ) const { return n_batches == 0 ? 0 : latency_sum / n_batches; }
+
+    private:
+        std::string path;             //!< The name of the file.
+        int fd = -1;                  //!< The file.
+        int inotify_fd = -1;          //!< Events of the file.
+        int signal_fd = -1;           //!< SIGINT and SIGTERM, as events.
+        int watch = -1;               //!< The inotify watch of `fd`.
+        bool masked = false;          //!< Whether the signals were blocked by us.
+        sigset_t previous;            //!< The signal mask to restore.
+
+        std::vector< char > buffer;   //!< Data read: [buf_pos, buf_end) is not returned yet.
+        size_type buf_pos = 0;        //!< Start of the next line in `buffer`.
+        size_type buf_end = 0;        //!< End of the data in `buffer`.
+        size_type file_pos = 0;       //!< Offset in the file of `buffer[buf_end]`.
+        bool at_end = false;          //!< Whether the last read reached the end of the file.
+        bool skip_line = false;       //!< Whether to drop the data up to the first '\n' (resuming mid line).
+        bool reopen = false;          //!< Whether to follow the file that replaced ours, at the next wait().
+        bool lines_out = false;       //!< Whether next() returned lines in this batch.
+
+        clock::time_point since;      //!< When the data of the current batch was known to be there.
+        clock::time_point caught_up;  //!< When the last read reached the end of the file.
+        std::uint64_t n_batches = 0;  //!< See batches().
+        std::uint64_t latency_sum = 0; //!< Sum of the latencies, in microseconds.
+        std::uint64_t latency_max = 0; //!< See max_latency().
+
+        bool open( size_type offset_ );  // Opens `path` and starts reading at `offset_`.
+        bool read( void );               // Reads the next block of the file into the buffer (false if none).
+        bool replaced( void ) const;     // Whether `path` is now another file.
+        bool take_signal( void );        // Whether SIGINT or SIGTERM arrived (and consumes it).
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _FORMULA_H_
+#define _FORMULA_H_
+
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <vector>      // std::vector
+#include <cstddef>     // std::size_t
+
+#include "parser.h"    // class Parser.
+#include "column.h"    // class ColumnVM.
+#include "jit.h"       // class JitProgram.
+#include "evaluator.h" // struct Outcome.
+#include "writer.h"    // class OutputWriter.
+
+/*!
+ * An expression with variables (e.g. "a * (b + 3) ^ c"), compiled once and then
+ * evaluated over any number of rows of values.
+ *
+ * Instead of substituting the values into the text and parsing every row, the program is
+ * emitted once and run by the ColumnVM over blocks of rows, one column per variable.
+ * Each row gets the same outcome the Evaluator would give the expression with the values
+ * written in place of the variables.
+ *
+ * Optionally (set_jit()), the program is translated into native code instead, which runs
+ * the rows one after the other (see JitProgram); if that cannot be done on this machine,
+ * the ColumnVM is used.
+ */
+class Formula
+{
+    public:
+        //=== Aliases
+        typedef Program::value_type value_type; //!< Type of the values.
+        typedef std::size_t size_type;          //!< Used for counting rows.
+
+        /// Rows read (and evaluated together) at a time by run().
+        static constexpr size_type ROWS = 4096;
+
+        /// Creates an empty formula (compile() must be called before anything else).
+        Formula();
+
+        /// Parses the expression `e_` and compiles it.
+        Parser::ResultType compile( std::string_view e_ );
+        /// Whether compile() should also generate native code (must be called before it).
+        void set_jit( bool jit_ ) { use_jit = jit_; }
+        /// Whether the formula compiled runs as native code.
+        bool is_native( void ) const { return jit.is_compiled(); }
+        /// Names of the variables, in order of first appearance (the order of the columns).
+        const std::vector< std::string > & get_variables( void ) const { return parser.get_variables(); }
+
+        /// Evaluates `n_rows_` rows: variable `v` of row `r` is `columns_[v][r]`; the outcomes go to `out_`.
+        void evaluate( const value_type * const * columns_, size_type n_rows_, Outcome * out_ );
+        /// Evaluates every row of `reader_` (the values of the variables, in order) and writes the outcomes.
+        void run( LineReader & reader_, OutputWriter & writer_ );
+
+        /// Reads the `n_` values of a row, separated by commas and/or blanks, into `values_`.
+        static Parser::ResultType read_row( std::string_view line_, value_type * values_, size_type n_ );
+
+    private:
+        Parser parser;                        //!< Compiles the expression (and keeps the program).
+        ColumnVM vm;                          //!< Runs the program over the columns...
+        JitProgram jit;                       //!< ... unless it has been translated into native code.
+        bool use_jit = false;                 //!< See set_jit().
+        std::vector< VM::ResultType > results; //!< Results of the rows being evaluated.
+};
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef _GRAMMAR_H_
+#define _GRAMMAR_H_
+
+#include <cstdint> // std::uint8_t
+#include <cstddef> // std::ptrdiff_t
+
+/*!
+ * The rules of the BARES grammar that do not depend on how an expression is parsed:
+ * the classes of the characters, the operators with their precedence and associativity,
+ * the range of the integer constants and the messages of the errors.
+ *
+ * Everything here is constexpr, so the run time Parser (and Scanner) and the compile
+ * time evaluator (constant.h) are built from the same definitions.
+ */
+
+/// The classes of characters the lexer knows about.
+/*!
+ * Parser::terminal_symbol_t uses the very same codes, so a class may be compared
+ * directly against a terminal symbol.
+ */
+enum char_class_t : std::uint8_t {
+    CC_MINUS = 0,       //!< "-"
+    CC_OP_SCOPE,        //!< "("
+    CC_CL_SCOPE,        //!< ")"
+    CC_OPERATOR,        //!< "+", "^", "*", "%", "/"
+    CC_ZERO,            //!< "0"
+    CC_NON_ZERO_DIGIT,  //!< "1"->"9"
+    CC_WS,              //!< white-space
+    CC_TAB,             //!< tab
+    CC_EOS,             //!< "\0"
+    CC_INVALID          //!< anything else
+};
+
+/*!
+ * @name Error messages
+ * What the report says about each error (Parser::ResultType::code_t and the run time
+ * errors of Outcome), and what the compile time evaluator quotes.  They are macros so
+ * that they can be pasted into other string literals (e.g. of static_assert).
+ */
+///@{
+#define BARES_MSG_UNEXPECTED_END_OF_EXPRESSION "Unexpected end of input at column"
+#define BARES_MSG_ILL_FORMED_INTEGER           "Ill formed integer at column"
+#define BARES_MSG_MISSING_TERM                 "Missing <term> at column"
+#define BARES_MSG_EXTRANEOUS_SYMBOL            "Extraneous symbol after valid expression found at column"
+#define BARES_MSG_INTEGER_OUT_OF_RANGE         "Integer constant out of range beginning at column"
+#define BARES_MSG_MISSING_CLOSING              "Missing closing ”)” at column"
+#define BARES_MSG_NESTING_TOO_DEEP             "Too many nested ”(” at column"
+#define BARES_MSG_DIVISION_BY_ZERO             "Division by zero"
+#define BARES_MSG_MODULO_BY_ZERO               "Modulo by zero"
+#define BARES_MSG_NUMERIC_OVERFLOW             "Numeric overflow"
+///@}
+
+namespace grammar {
+
+/// The integer constants we accept (<integer> must fit in it).
+typedef short int integer_type;
+
+/*!
+ * The widths the expressions may be evaluated with (see Parser::set_width()).
+ *
+ * W16 is the original BARES: 16-bit constants, 64-bit arithmetic and a final result that
+ * must fit in an `int`.  The others take constants of their width and do every operation
+ * in it, checked; BIG has no limit other than BigInt::MAX_BITS.
+ */
+enum class width_t : std::uint8_t {
+    W16 = 0, //!< The original rules (the default).
+    W32,     //!< std::int32_t.
+    W64,     //!< std::int64_t.
+    W128,    //!< __int128.
+    BIG      //!< BigInt.
+};
+
+/// The binary operators.
+constexpr char OPERATORS[] = "+-*/%^";
+
+/// Classifies a character.
+constexpr char_class_t classify( unsigned char c_ )
+{
+    switch( c_ )
+    {
+        case '-': return CC_MINUS;
+        case '+':
+        case '^':
+        case '*':
+        case '%':
+        case '/':  return CC_OPERATOR;
+        case '(':  return CC_OP_SCOPE;
+        case ')':  return CC_CL_SCOPE;
+        case ' ':  return CC_WS;
+        case   9:  return CC_TAB;
+        case '0':  return CC_ZERO;
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':  return CC_NON_ZERO_DIGIT;
+        case '\0': return CC_EOS; // end of string: the $ terminal symbol
+    }
+    return CC_INVALID;
+}
+
+/// Whether `c_` is one of the binary operators.
+constexpr bool is_operator( char c_ )
+{
+    for ( const char * op = OPERATORS ; *op != '\0' ; ++op )
+        if ( *op == c_ ) return true;
+    return false;
+}
+
+/// Binding strength of a binary operator (higher binds tighter).
+constexpr int precedence( char op_ )
+{
+    switch ( op_ )
+    {
+        case '^': return 3;
+        case '*':
+        case '/':
+        case '%': return 2;
+        default:  return 1; // '+' and '-'.
+    }
+}
+
+/// Whether a run of the operator `op_` groups from the right ("^" does).
+constexpr bool right_associative( char op_ )
+{
+    return op_ == '^';
+}
+
+/// Whether the pending operator `left_` must be applied before the operator `op_` that follows its right operand.
+constexpr bool applies_before( char left_, char op_ )
+{
+    return precedence( left_ ) > precedence( op_ ) or
+           ( precedence( left_ ) == precedence( op_ ) and not right_associative( op_ ) );
+}
+
+/// The column shown to the user for a parsing error found at `at_col_`.
+/*!
+ * Most errors are reported at the position where the parser stopped; an ill formed integer
+ * is detected one character after the offending symbol, except at the very start of the
+ * expression (e.g. "a + 1"), which is column 0 as well.  So the column is never negative,
+ * whoever reports it: the reports, the C interface (an unsigned column) and the constant
+ * evaluator (a template argument).
+ */
+constexpr std::ptrdiff_t reported_column( bool ill_formed_integer_, std::ptrdiff_t at_col_ )
+{
+    return ill_formed_integer_ and at_col_ > 0 ? at_col_ - 1 : at_col_;
+}
+
+} // namespace grammar
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef _JIT_H_
+#define _JIT_H_
+
+#include <vector>  // std::vector
+#include <cstddef> // std::size_t
+
+#include "bytecode.h" // class Program, class VM.
+
+/*!
+ * A Program translated into native x86-64 code, to run it over many rows of variable
+ * values (the same interface as ColumnVM).
+ *
+ * The code is a loop over the rows whose body is the program as straight-line code: the
+ * evaluation stack lives in registers, each operand is a single load or move, and each
+ * operator a few instructions, with the checks inline ("jo" after "+", "-", "*" and every
+ * step of "^", zero and -1 divisors before "/" and "%").  A row that fails a check, or
+ * that raises to a negative power, leaves the loop and is run again by the scalar VM,
+ * which tells the error and its column; so every row gets exactly what VM::run() would
+ * have returned.
+ *
+ * The code is written to anonymous memory, which is then made executable (and no longer
+ * writable).  On other architectures, or for programs that need more than `MAX_DEPTH`
+ * registers, compile() fails and run() falls back to the interpreter.
+ */
+class JitProgram
+{
+    public:
+        //=== Aliases
+        typedef Program::value_type value_type; //!< Type we operate on.
+        typedef std::size_t size_type;          //!< Used for counting rows.
+
+        /// Deepest evaluation stack that fits in the registers.
+        static constexpr size_type MAX_DEPTH = 8;
+
+        /// Creates an empty (not compiled) program.
+        JitProgram() = default;
+        /// Releases the code.
+        ~JitProgram();
+        /// Turn off copy constructor.
+        JitProgram( const JitProgram & ) = delete;
+        /// Turn off assignment operator.
+        JitProgram & operator=( const JitProgram & ) = delete;
+
+        /// Translates `program_` into native code. Returns false if it cannot be done here.
+        bool compile( const Program & program_ );
+        /// Drops the code (is_compiled() becomes false).
+        void clear( void );
+        /// Whether the last compile() succeeded.
+        bool is_compiled( void ) const { return entry != nullptr; }
+
+        /// Runs `program_` (the one compiled) for `n_rows_` rows; variable `v` of row `r` is `columns_[v][r]`.
+        void run( const Program & program_, const value_type * const * columns_, size_type n_rows_,
+                  VM::ResultType * results_ );
+
+        /// Whether native code can be generated on this machine.
+        static bool available( void );
+
+    private:
+        /// The generated code: evaluates rows [first, last) into `results`; returns the first row it could not finish.
+        typedef size_type ( *entry_t )( const value_type * const * columns, size_type first, size_type last,
+                                        VM::ResultType * results );
+
+        void * memory = nullptr;           //!< The executable mapping.
+        size_type memory_size = 0;         //!< Its size.
+        entry_t entry = nullptr;           //!< Start of the code (nullptr if not compiled).
+        std::vector< value_type > row;     //!< Variables of a row the VM runs.
+        VM vm;                             //!< Runs the rows the code could not finish.
+};
+
+#endif
@@ -4,28 +4,42 @@
 #include <iostream> // cout, cin
 #include <iterator> // std::distance()
 #include <vector>   // std::vector
-#include <sstream>  // std::istringstream
+#include <string_view> // std::string_view
 #include <cstddef>  // std::ptrdiff_t
 #include <limits>   // std::numeric_limits, para validar a faixa de um inteiro.
 #include <algorithm>// std::copy, para copiar substrings.
 
 #include "token.h"  // struct Token.
+#include "bytecode.h" // class Program.
+#include "scanner.h"  // class Scanner, char_class_t.
 #include "reader.h"
 
 /*!
- * Implements a recursive descendent parser for a EBNF grammar.
+ * Implements a parser for a EBNF grammar (operator precedence, without recursion).
  *
- * This class also tokenizes the input expression into its components, creating a list of tokens.
+ * While the expression is validated, the parser emits the equivalent postfix Program,
+ * so there is no separate conversion pass. It may also tokenize the input expression
+ * into its components, creating a list of tokens.
  *
  * The grammar is:
  * ```
- *   <expr>            := <term>,{ ("+"|"-"),<term> };
- *   <term>            := <integer>;
+ *   <expr>            := <product>,{ ("+"|"-"),<product> };
+ *   <product>         := <power>,{ ("*"|"/"|"%"),<power> };
+ *   <power>           := <term>,[ "^",<power> ];
+ *   <term>            := "(",<expr>,")" | <integer> | <variable>;
  *   <integer>         := 0 | ["-"],<natural_number>;
  *   <natural_number>  := <digit_excl_zero>,{<digit>};
  *   <digit_excl_zero> := "1" | "2" | "3" | "4" | "5" | "6" | "7" | "8" | "9";
  *   <digit>           := "0"| <digit_excl_zero>;
+ *   <variable>        := <letter>,{ <letter> | <digit> };
+ *   <letter>          := "a" | ... | "z" | "A" | ... | "Z" | "_";
  * ```
+ * Variables are only accepted when turned on with set_variables() (see class Formula).
+ * The range of <integer> is 16 bits, unless another width is chosen with set_width().
+ *
+ * An expression that is edited may be parsed again with reparse(), which resumes from the
+ * last point (recorded while parsing, see set_incremental()) before the first change,
+ * keeping the tokens and the program of the unchanged prefix.
  */
 class Parser
 {
@@ -44,7 +58,8 @@ class Parser
                     MISSING_TERM,
                     EXTRANEOUS_SYMBOL,
                     INTEGER_OUT_OF_RANGE,
-                    MISSING_CLOSING
+                    MISSING_CLOSING,
+                    NESTING_TOO_DEEP //!< More nested parentheses than the limit (see set_max_depth()).
             };
 
             //=== Members (public).
@@ -59,14 +74,42 @@ class Parser
         };
 
         //==== Aliases
-        typedef short int required_int_type; //!< The interger type we accept as valid for an expression.
+        typedef grammar::integer_type required_int_type; //!< The interger type we accept as valid for an expression.
         typedef long long int input_int_type; //!< The integer type that we read from the input (larger thatn the required int).
+        typedef std::size_t size_type; //!< Used for nesting depths.
+
+        /// Default limit for the nesting of parentheses.
+        static constexpr size_type DEFAULT_MAX_DEPTH = 100000;
+        /// Least number of characters between two of the points reparse() resumes from.
+        static constexpr std::size_t CHECKPOINT_SPACING = 64;
+        /// Most digits of a constant with the BIG width (any such constant fits in BigInt::MAX_BITS).
+        static constexpr std::size_t BIG_MAX_DIGITS = 315652;
 
         //==== Public interface
         /// Parses and tokenizes an input source expression.  Return the result as a struct.
-        ResultType parse( std::string e_ );
-        /// Retrieves the list of tokens created during the partins process.
+        ResultType parse( std::string_view e_ );
+        /// Parses `e_`, whose first `unchanged_` characters are those of the expression parsed last.
+        ResultType reparse( std::string_view e_, std::size_t unchanged_ );
+        /// Retrieves a copy of the list of tokens created during the parsing process.
         std::vector< Token > get_tokens( void ) const;
+        /// Retrieves the list of tokens created during the parsing process, as views into the source expression.
+        const std::vector< TokenView > & get_token_views( void ) const;
+        /// Retrieves the postfix program emitted during the parsing process.
+        const Program & get_program( void ) const;
+        /// Chooses whether the list of tokens is recorded (default) or only the program is emitted.
+        void set_keep_tokens( bool keep_ );
+        /// Limits the nesting of parentheses (0 means no limit).
+        void set_max_depth( size_type max_depth_ );
+        /// Chooses whether variables are accepted as terms (default: no).
+        void set_variables( bool allow_ );
+        /// Chooses the width of the constants and of the program (default: grammar::width_t::W16).
+        void set_width( grammar::width_t width_ );
+        /// Retrieves the width of the constants.
+        grammar::width_t get_width( void ) const { return width; }
+        /// Chooses whether parsing records the points reparse() resumes from (default: no).
+        void set_incremental( bool on_ );
+        /// Retrieves the names of the variables, in order of first appearance (the index used by the program).
+        const std::vector< std::string > & get_variables( void ) const;
 
         //==== Special methods
         /// Default constructor
@@ -79,25 +122,53 @@ class Parser
         Parser & operator=( const Parser & ) = delete; // Atribuição.
 
     private:
-        // Terminal symbols table
-        enum class terminal_symbol_t{  // The symbols:-
-
-            TS_MINUS,	        //!< code for "-"
-            TS_OP_SCOPE,         //!< code for "("
-            TS_CL_SCOPE,         //!< code for ")"
-            TS_OPERATOR,
-            TS_ZERO,            //!< code for "0"
-            TS_NON_ZERO_DIGIT,  //!< code for digits "1"->"9"
-            TS_WS,              //!< code for a white-space
-            TS_TAB,             //!< code for tab
-            TS_EOS,             //!< code for "End Of String"
-            TS_INVALID	        //!< invalid token
+        // Terminal symbols table (same codes as the Scanner character classes).
+        enum class terminal_symbol_t : std::uint8_t {  // The symbols:-
+
+            TS_MINUS = CC_MINUS,	                //!< code for "-"
+            TS_OP_SCOPE = CC_OP_SCOPE,              //!< code for "("
+            TS_CL_SCOPE = CC_CL_SCOPE,              //!< code for ")"
+            TS_OPERATOR = CC_OPERATOR,
+            TS_ZERO = CC_ZERO,                      //!< code for "0"
+            TS_NON_ZERO_DIGIT = CC_NON_ZERO_DIGIT,  //!< code for digits "1"->"9"
+            TS_WS = CC_WS,                          //!< code for a white-space
+            TS_TAB = CC_TAB,                        //!< code for tab
+            TS_EOS = CC_EOS,                        //!< code for "End Of String"
+            TS_INVALID = CC_INVALID	                //!< invalid token
         };
 
         //==== Private members.
-        std::string expr;                //!< The source expression to be parsed
-        std::string::iterator it_curr_symb; //!< Pointer to the current char inside the expression.
-        std::vector< Token > token_list; //!< Resulting list of tokens extracted from the expression.
+        std::string_view expr;                    //!< The source expression to be parsed (not owned).
+        std::string_view::const_iterator it_curr_symb; //!< Pointer to the current char inside the expression.
+        std::vector< TokenView > token_list;      //!< Resulting list of tokens extracted from the expression.
+        bool keep_tokens = true;                  //!< Whether token_list must be filled in.
+        Program program;                          //!< Resulting postfix program.
+        std::vector< std::uint8_t > classes;      //!< Class of each char of the expression, plus a TS_EOS sentinel.
+        /// An operator waiting for its right operand (or the "(" of an open scope).
+        struct Pending
+        {
+            char symbol;          //!< The operator, or "(".
+            std::size_t column;   //!< Where it is in the expression.
+        };
+        std::vector< Pending > operators;         //!< Operators waiting for their right operand, and "(" of the open scopes.
+        size_type max_depth = DEFAULT_MAX_DEPTH;  //!< Maximum nesting of parentheses (0: no limit).
+        bool allow_variables = false;             //!< Whether <variable> is part of the grammar.
+        grammar::width_t width = grammar::width_t::W16; //!< Range of the constants (see set_width()).
+        std::vector< std::string > variables;     //!< Names of the variables found in the expression.
+
+        /// The state of the parser at the start of a term, to resume from (see reparse()).
+        struct Checkpoint
+        {
+            std::size_t position;      //!< Offset of the term (before any white space).
+            size_type depth;           //!< Scopes open.
+            std::size_t n_tokens;      //!< Tokens recorded.
+            std::size_t n_variables;   //!< Variables found.
+            Program::Mark program;     //!< Code emitted.
+            std::size_t operators_end; //!< End of its pending operators in `saved_operators`.
+        };
+        bool incremental = false;                 //!< Whether checkpoints are recorded.
+        std::vector< Checkpoint > checkpoints;    //!< In order of position.
+        std::vector< Pending > saved_operators;   //!< The `operators` of each checkpoint, one after the other.
 
         terminal_symbol_t lexer( char c_ ) const;
         //std::string token_str( terminal_symbol_t s_ ) const;
@@ -109,18 +180,27 @@ class Parser
         bool expect( terminal_symbol_t c_ );        // Skips any WS/Tab and tries to accept the requested symbol.
         void skip_ws( void );                    // Skips any WS/Tab ans stops at the next character.
         bool end_input( void ) const;            // Checks whether we reached the end of the expression string.
+        std::size_t position( void ) const;      // Offset of the current char inside the expression.
+        bool accept_operator( std::string_view ops_, char & op_ ); // Skips any WS/Tab and tries to accept one of the operators.
+        void reduce( char op_ );                 // Emits the pending operators that bind tighter than op_.
+        void add_token( std::string_view::const_iterator first_, std::string_view::const_iterator last_,
+                        Token::token_t type_, TokenView::number_type number_=0 ); // Records a token, if we keep them.
+        void start( std::string_view e_, std::size_t classified_ ); // Takes a new expression to parse.
+        void save_checkpoint( size_type depth_ ); // Records where the parser is, if it is time to.
+        ResultType finish( ResultType result_ ); // Checks that nothing but blanks follows the expression.
 
         //=== NTS methods.
-        ResultType expression();
+        ResultType expression( size_type depth_ );
         ResultType term();
-        ResultType integer();
-        ResultType natural_number();
+        ResultType variable();
+        ResultType wide_integer( std::string_view::const_iterator begin_token_ );
+        template < typename U > ResultType integer( U & magnitude_, bool & negative_, U limit_ );
+        template < typename U > ResultType natural_number( U & value_, U limit_ );
         bool digit_excl_zero();
         bool digit();
         bool is_operator();
         bool is_op_scope();
         bool is_cl_scope();
-        bool is_minus();
 };
 
 #endif
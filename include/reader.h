@@ -4,8 +4,63 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <vector>
+#include <cstddef>
 
-std::vector<std::string> reader_file(char* filename);
+/*!
+ * Reads an input source one line at a time, without loading it all in memory.
+ *
+ * Regular files are memory mapped, and the lines are views straight into the mapping.
+ * Anything else (the standard input, pipes, ...) is read in large blocks, and the lines
+ * are views into the current block.  Either way, a line is valid only until the next call
+ * to next(), and memory use does not depend on the size of the input.
+ */
+class LineReader
+{
+    public:
+        //=== Alias
+        typedef std::size_t size_type; //!< Used for sizes and offsets.
+
+        /// Size of each block read from non mappable sources.
+        static constexpr size_type BLOCK_SIZE = 1 << 20;
+
+        /// Opens the file `filename_`; `nullptr` or "-" means the standard input.
+        explicit LineReader( const char * filename_ );
+        /// Unmaps/closes the input.
+        ~LineReader();
+        /// Turn off copy constructor.
+        LineReader( const LineReader & ) = delete;
+        /// Turn off assignment operator.
+        LineReader & operator=( const LineReader & ) = delete;
+
+        /// Checks whether the input could be opened.
+        bool is_open( void ) const { return fd >= 0; }
+        /// The file descriptor of the input (e.g. to fstat() it).
+        int get_fd( void ) const { return fd; }
+        /// Gets the next line (without the '\n'). Returns false at the end of the input.
+        bool next( std::string_view & line_ );
+
+    private:
+        int fd = -1;                     //!< The input file descriptor.
+        bool owns_fd = false;            //!< Whether we must close `fd`.
+
+        // Memory mapped input.
+        const char * map_begin = nullptr; //!< Beginning of the mapping (nullptr if not mapped).
+        size_type map_size = 0;           //!< Size of the mapping.
+        size_type map_pos = 0;            //!< Offset of the next line.
+        size_type map_released = 0;       //!< Pages before this offset have been given back.
+
+        // Block input.
+        std::vector< char > buffer;       //!< The current block.
+        size_type buf_pos = 0;            //!< Offset of the next line in `buffer`.
+        size_type buf_end = 0;            //!< Bytes of `buffer` holding data.
+        bool eof = false;                 //!< Whether the source has no more data.
+
+        bool next_mapped( std::string_view & line_ ); // next() for mapped files.
+        bool next_block( std::string_view & line_ );  // next() for everything else.
+        bool fill( void );                            // Reads more data into `buffer`.
+};
 
 #endif
@@ -0,0 +1,78 @@
+#ifndef _REPL_H_
+#define _REPL_H_
+
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <vector>      // std::vector
+#include <cstddef>     // std::size_t
+
+#include "evaluator.h" // struct Outcome, struct EvaluatorConfig.
+
+/*!
+ * An interactive prompt that checks and evaluates the expression while it is typed.
+ *
+ * After every change the line is parsed again with Parser::reparse(), which resumes from
+ * the last checkpoint before the first character changed, so the cost of a keystroke does
+ * not grow with the part of the line before it.  Below the line, a caret points to the
+ * column of the error (the same one print_error_msg() points to) and the next line tells
+ * the error or the result.  Lines longer than the terminal scroll sideways.
+ *
+ * Keys: the arrows, Home/End (or Ctrl-A/Ctrl-E), Backspace/Delete, Ctrl-U and Ctrl-K (erase
+ * to the beginning/end), Enter (keeps the line in the history), Ctrl-D on an empty line or
+ * Ctrl-C to leave.
+ */
+class Repl
+{
+    public:
+        //=== Alias
+        typedef std::size_t size_type; //!< Used for offsets into the line.
+
+        /// Bytes read from the terminal at a time (a paste is handled as a single edit).
+        static constexpr size_type READ_SIZE = 4096;
+
+        /// Creates a prompt whose parser is set up as `config_` says (only `max_depth` applies).
+        explicit Repl( const EvaluatorConfig & config_=EvaluatorConfig() );
+        /// Turn off copy constructor.
+        Repl( const Repl & ) = delete;
+        /// Turn off assignment operator.
+        Repl & operator=( const Repl & ) = delete;
+
+        /// Runs the prompt on the terminal `in_fd_`, drawing on `out_fd_`. Returns false if `in_fd_` is not a terminal.
+        bool run( int in_fd_, int out_fd_ );
+
+        /// Replaces the `count_` characters of the line from `first_` on with `text_` (see check()).
+        void edit( size_type first_, size_type count_, std::string_view text_ );
+        /// Parses (from the first change on) and evaluates the line, if it changed since the last time.
+        const Outcome & check( void );
+        /// Retrieves the line.
+        const std::string & get_line( void ) const { return line; }
+
+    private:
+        /// Where we are in an escape sequence sent by the terminal.
+        enum class escape_t { NONE, ESC, CSI };
+
+        Parser parser;                      //!< Keeps the checkpoints of the line.
+        VM vm;                              //!< Runs the program of the line.
+        Outcome outcome;                    //!< What the line gives.
+        std::string line;                   //!< The expression being edited.
+        size_type unchanged = 0;            //!< Characters of the line the parser has seen unchanged.
+        bool dirty = true;                  //!< Whether the line changed since check().
+        size_type cursor = 0;               //!< Where the next character goes.
+        size_type scroll = 0;               //!< First character of the line on the screen.
+        std::vector< std::string > history; //!< Lines entered.
+        size_type history_pos = 0;          //!< Line of the history shown (history.size(): a new one).
+        escape_t escape = escape_t::NONE;   //!< State of the escape sequence being read.
+        std::string escape_args;            //!< Parameters of the escape sequence.
+        std::string screen;                 //!< What is sent to the terminal.
+        int out_fd = -1;                    //!< The terminal we draw on.
+
+        bool key( char c_, std::string & typed_ );  // Handles a byte typed; false to leave.
+        void control( char c_ );                    // Handles the end of an escape sequence.
+        void insert( std::string & typed_ );        // Inserts the characters typed so far at the cursor.
+        void enter( void );                         // Keeps the line and starts a new one.
+        void recall( size_type pos_ );              // Puts a line of the history on the prompt.
+        void draw( void );                          // Shows the line and its outcome.
+        void send( void );                          // Writes `screen` to the terminal.
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef _REPORT_H_
+#define _REPORT_H_
+
+#include <string>      // std::string
+#include <string_view> // std::string_view
+
+#include "evaluator.h" // struct BasicOutcome.
+
+/// The ways the outcome of an expression may be reported.
+enum class report_format_t {
+    HUMAN = 0, //!< Banner, parsing status, result and a caret under syntax errors.
+    COMPACT    //!< One line per expression: the result, or "ERROR_CODE,column".
+};
+
+/// Appends to `out_` the decimal representation of `v_` (instantiated for the values of every width).
+template < typename T >
+void append_number( std::string & out_, const T & v_ );
+
+/// Returns the column we show to the user for a parsing error.
+Parser::ResultType::size_type reported_column( const Parser::ResultType & result_ );
+/// Returns the name of an error (e.g. "MISSING_TERM") as used by the compact format.
+const char * error_name( const OutcomeBase & outcome_ );
+
+/// Appends to `out_` the line that describes a parsing error.
+void print_error_line( std::string & out_, const Parser::ResultType & result_ );
+
+/// Appends to `out_` the error message (and the caret line) for a parsing error in `expr_`.
+void print_error_msg( std::string & out_, const Parser::ResultType & result_, std::string_view expr_ );
+
+/*!
+ * @name Reports of one expression
+ * They are instantiated (in report.cpp) for the outcomes of every width: `long`,
+ * std::int32_t, __int128 and BigInt.
+ */
+///@{
+/// Appends to `out_` the full report (banner, parsing status and result) for one expression.
+template < typename T >
+void print_report( std::string & out_, std::string_view expr_, const BasicOutcome< T > & outcome_ );
+
+/// Appends to `out_` the compact (one line) report for one expression.
+template < typename T >
+void print_compact( std::string & out_, const BasicOutcome< T > & outcome_ );
+
+/// Appends to `out_` the report for one expression, in the format requested.
+template < typename T >
+inline void print_outcome( std::string & out_, std::string_view expr_, const BasicOutcome< T > & outcome_,
+                           report_format_t format_ )
+{
+    if ( format_ == report_format_t::COMPACT ) print_compact( out_, outcome_ );
+    else print_report( out_, expr_, outcome_ );
+}
+///@}
+
+#endif
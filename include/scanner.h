@@ -0,0 +1,49 @@
+#ifndef _SCANNER_H_
+#define _SCANNER_H_
+
+#include <cstdint> // std::uint8_t
+#include <cstddef> // std::size_t
+#include <array>   // std::array
+
+#include "grammar.h" // char_class_t.
+
+/*!
+ * Vectorized scanning primitives for the lexer.
+ *
+ * Each primitive handles 32 (AVX2) or 16 (SSE2) bytes per step.  The implementation is
+ * chosen once, at start up, from what the processor supports; other architectures get a
+ * scalar version.  The choice may be forced with the environment variable `BARES_SIMD`
+ * ("avx2", "sse2" or "scalar"), e.g. to compare them.
+ */
+class Scanner
+{
+    public:
+        /// Classifies a single character (table lookup).
+        static char_class_t classify( char c_ ) { return table[ static_cast< std::uint8_t >( c_ ) ]; }
+        /// Classifies every character in [first_,last_), writing the classes to `out_`.
+        static void classify( const char * first_, const char * last_, std::uint8_t * out_ )
+        { kernels.classify( first_, last_, out_ ); }
+        /// Returns the first character in [first_,last_) that is neither a blank nor a tab.
+        static const char * skip_ws( const char * first_, const char * last_ )
+        { return kernels.skip_ws( first_, last_ ); }
+        /// Returns the first character in [first_,last_) that is not a decimal digit.
+        static const char * skip_digits( const char * first_, const char * last_ )
+        { return kernels.skip_digits( first_, last_ ); }
+        /// Name of the implementation in use.
+        static const char * name( void ) { return kernels.name; }
+
+        /// A set of implementations of the primitives.
+        struct Kernels
+        {
+            void (*classify)( const char *, const char *, std::uint8_t * );
+            const char * (*skip_ws)( const char *, const char * );
+            const char * (*skip_digits)( const char *, const char * );
+            const char * name;
+        };
+
+    private:
+        static const std::array< char_class_t, 256 > table; //!< Class of each character.
+        static const Kernels kernels;                       //!< The implementation in use.
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include <string>        // std::string
+#include <vector>        // std::vector
+#include <memory>        // std::unique_ptr
+#include <unordered_map> // std::unordered_map
+#include <cstddef>       // std::size_t
+
+#include "evaluator.h"   // class Evaluator, struct EvaluatorConfig.
+
+/*!
+ * Evaluates expressions for other processes, over a Unix domain socket.
+ *
+ * The protocol is the compact format: clients send expressions, one per line, and get back
+ * one line per expression (the result, or "ERROR_CODE,column"), in the order they were
+ * sent.  A client may send as many lines as it wants before reading any answer
+ * (pipelining); a connection whose answers are not being read stops being read from
+ * until they are, so memory stays bounded.  For the same reason a line may not be longer
+ * than `MAX_LINE` bytes: a connection that sends a longer one gets "LINE_TOO_LONG,<MAX_LINE>"
+ * for it, and is closed once its earlier answers have been sent.  The last line does not need a '\n' if the
+ * client shuts its side down (or closes) after it.
+ *
+ * A single thread serves every connection with an epoll loop, through one Evaluator
+ * (and so one Parser, VM and cache) that stays warm for the life of the server.
+ * SIGINT and SIGTERM stop it cleanly.  When the process runs out of file descriptors, new
+ * connections wait in the backlog of the socket until one is closed (or `ACCEPT_RETRY`
+ * milliseconds have passed).
+ */
+class Server
+{
+    public:
+        //=== Alias
+        typedef std::size_t size_type; //!< Used for sizes and counters.
+
+        /// Bytes read from a connection at a time.
+        static constexpr size_type READ_SIZE = 64 << 10;
+        /// A connection with this many bytes of answers not yet sent is not read from.
+        static constexpr size_type HIGH_WATER = 1 << 20;
+        /// Longest line (expression) a client may send.
+        static constexpr size_type MAX_LINE = 16 << 20;
+        /// Milliseconds before accepting again, after running out of file descriptors.
+        static constexpr int ACCEPT_RETRY = 100;
+
+        /// Creates a server whose evaluator is set up as `config_` says.
+        explicit Server( const EvaluatorConfig & config_=EvaluatorConfig() );
+        /// Closes every connection and removes the socket.
+        ~Server();
+        /// Turn off copy constructor.
+        Server( const Server & ) = delete;
+        /// Turn off assignment operator.
+        Server & operator=( const Server & ) = delete;
+
+        /// Creates the socket `path_` (replacing a stale one) and listens on it. Returns false (see errno) on failure.
+        bool listen( const std::string & path_ );
+        /// Serves the connections until SIGINT or SIGTERM. Returns false (see errno) if the loop could not be set up.
+        bool run( void );
+
+        /// Connects to the server listening on `path_` (client side). Returns the socket, or -1 (see errno).
+        static int connect( const std::string & path_ );
+
+        /// Retrieves the evaluator, e.g. to read its cache counters.
+        const Evaluator & get_evaluator( void ) const { return evaluator; }
+        /// Number of connections accepted so far.
+        size_type connections_served( void ) const { return n_connections; }
+
+    private:
+        /// A client.
+        struct Connection
+        {
+            int fd = -1;            //!< The socket.
+            std::vector< char > in; //!< Data read: [in_begin, in_end) is not evaluated yet.
+            size_type in_begin = 0; //!< Start of the next line in `in`.
+            size_type in_end = 0;   //!< End of the data read.
+            std::string out;        //!< Answers not sent yet (from `out_pos` on).
+            size_type out_pos = 0;  //!< Start of the data not sent in `out`.
+            bool eof = false;       //!< Whether the client will send nothing more.
+            unsigned events = 0;    //!< Events we are waiting for.
+        };
+
+        Evaluator evaluator;        //!< Shared by every connection.
+        std::string path;           //!< Where the socket is.
+        int listen_fd = -1;         //!< The listening socket.
+        int epoll_fd = -1;          //!< The event loop.
+        int signal_fd = -1;         //!< SIGINT and SIGTERM, as events.
+        std::unordered_map< int, std::unique_ptr< Connection > > connections; //!< Open connections, by socket.
+        std::vector< std::unique_ptr< Connection > > spare; //!< Closed connections, kept for their buffers.
+        size_type n_connections = 0; //!< Connections accepted.
+        bool accepting = true;       //!< Whether the listening socket is watched.
+
+        void accept_all( void );               // Accepts every pending connection.
+        void watch_listener( bool on_ );       // Starts/stops watching the listening socket.
+        void on_readable( Connection & c_ );   // Reads, evaluates and answers.
+        void evaluate_lines( Connection & c_ ); // Answers every complete line read.
+        void send( Connection & c_ );           // Sends what it can and updates the events or closes.
+        void close( Connection & c_ );          // Closes the connection (and recycles it).
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+/*!
+ * Whether the SIMD kernels of the scanner and of the column VM are built.
+ *
+ * Only on x86-64, where SSE2 is part of the base instruction set (AVX2 is then chosen at
+ * run time, with __builtin_cpu_supports()); everywhere else, 32-bit x86 included, which
+ * may lack SSE2, the scalar code is used.
+ */
+#if defined( __x86_64__ )
+#  define BARES_X86_64 1
+#  include <immintrin.h>
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef _SPLIT_H_
+#define _SPLIT_H_
+
+#include <string_view> // std::string_view
+#include <vector>      // std::vector
+#include <memory>      // std::unique_ptr
+#include <atomic>      // std::atomic
+#include <cstddef>     // std::size_t, std::ptrdiff_t
+
+#include "evaluator.h" // BasicOutcome, EvaluatorConfig.
+
+/*!
+ * Evaluates a single very long expression on several threads.
+ *
+ * The line is cut into one block per thread.  A first parallel scan finds the parentheses
+ * of each block, which gives the nesting depth at the start of every block; a second one
+ * finds which operators appear outside of all parentheses ("at the top").  The operators of
+ * the lowest precedence at the top split the expression into operands (e.g. the products
+ * of a long sum), and each thread parses and evaluates the operands that start in its
+ * block.  The values are then combined, one operator at a time, in the order the whole
+ * expression would apply them: from the left for "+", "-", "*", "/" and "%", from the right
+ * for "^".  Every step is checked as usual, so the outcome (value, error and column) is the
+ * one the whole line gives; the columns of the operands are moved to where they are in the
+ * line.
+ *
+ * Lines shorter than `MIN_SPLIT_SIZE`, lines with no operator at the top, and lines that do
+ * not parse (their error must be the first one of the line) are evaluated as a whole by a
+ * single thread.
+ *
+ * It is instantiated (in split.cpp) for the types of every width (see WideEvaluator);
+ * there is no cache.
+ */
+template < typename T >
+class SplitEvaluator
+{
+    public:
+        //=== Aliases
+        typedef BasicOutcome< T > outcome_type; //!< What an expression gives.
+        typedef std::size_t size_type;          //!< Used for sizes and positions.
+
+        /// Shorter lines are not split.
+        static constexpr size_type MIN_SPLIT_SIZE = size_type( 1 ) << 16;
+
+        /// Creates `n_jobs_` workers with the width `width_` (of type `T`), set up as `config_` says.
+        SplitEvaluator( size_type n_jobs_, grammar::width_t width_, const EvaluatorConfig & config_=EvaluatorConfig() );
+        /// Default destructor.
+        ~SplitEvaluator();
+        /// Turn off copy constructor.
+        SplitEvaluator( const SplitEvaluator & ) = delete;
+        /// Turn off assignment operator.
+        SplitEvaluator & operator=( const SplitEvaluator & ) = delete;
+
+        /// Parses and evaluates the expression `e_`.
+        outcome_type evaluate( std::string_view e_ );
+        /// Number of lines evaluated in pieces so far.
+        size_type lines_split( void ) const { return n_split; }
+
+    private:
+        /// An operand at the top, with the operator that joins it to the previous one.
+        struct Operand
+        {
+            T value;          //!< Its value.
+            char op;          //!< The operator on its left (none for the first operand).
+            size_type column; //!< Column of that operator.
+        };
+
+        struct Worker; // A thread's parser, VM and share of the line (split.cpp).
+
+        std::vector< std::unique_ptr< Worker > > workers; //!< One per block of the line.
+        grammar::width_t width;                           //!< Width of the constants.
+        std::string_view expr;                            //!< The line being evaluated.
+        int level = 0;                                    //!< Precedence of the operators it is split at.
+        std::atomic< bool > parse_failed{ false };        //!< Some operand does not parse.
+        size_type n_split = 0;                            //!< See lines_split().
+
+        template < typename F > void in_parallel( F f_ ); // Runs f_( worker ) on every worker at once.
+        bool scan_depths( void );                         // Finds the depth at the start of each block.
+        void find_level( void );                          // Finds the operators to split at.
+        size_type next_split( size_type from_, std::ptrdiff_t & depth_, size_type end_ ) const;
+        void evaluate_operands( Worker & w_ );            // Parses and evaluates the operands of a block.
+        outcome_type combine( void );                     // Applies the operators at the top.
+        outcome_type finish( const typename BasicVM< T >::ResultType & exec_, size_type result_col_ ) const;
+        outcome_type whole( std::string_view e_ );         // Evaluates the line with no splitting.
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/*!
+ * Per-stage timing and counters (the --stats option).
+ *
+ * They only exist when the program is compiled with BARES_STATS defined (`make stats`);
+ * otherwise the BARES_STAGE and BARES_COUNT* macros expand to nothing and there is no
+ * cost at all. Each thread updates its own counters (no atomics, no locks), which are
+ * added up when the summary is printed, after the workers are done.
+ */
+
+#ifdef BARES_STATS
+
+#include <cstdint> // std::uint64_t
+#include <ostream> // std::ostream
+#include <algorithm> // std::max
+
+#include "evaluator.h" // struct Outcome.
+
+class Stats
+{
+    public:
+        /// The stages of the pipeline we time.
+        enum stage_t {
+            READ = 0, //!< Finding the next line of the input.
+            PARSE,    //!< Parser::parse (lexing and emitting the program).
+            EVAL,     //!< VM::run.
+            OUTPUT,   //!< Formatting and writing the reports.
+            N_STAGES
+        };
+
+        /// Plain counters.
+        enum counter_t {
+            LINES = 0,    //!< Expressions evaluated.
+            BYTES,        //!< Size of the expressions evaluated.
+            CACHE_HITS,   //!< Outcomes found in the cache.
+            CACHE_MISSES, //!< Outcomes not found in the cache.
+            N_COUNTERS
+        };
+
+        /// The counters of one thread.
+        struct Counters
+        {
+            std::uint64_t ticks[ N_STAGES ] = {};   //!< Time spent in each stage.
+            std::uint64_t calls[ N_STAGES ] = {};   //!< Times each stage was entered.
+            std::uint64_t counts[ N_COUNTERS ] = {}; //!< Plain counters.
+            std::uint64_t outcomes[ Outcome::NUMERIC_OVERFLOW + 1 ] = {};                  //!< Per Outcome::status_t.
+            std::uint64_t parse_errors[ Parser::ResultType::NESTING_TOO_DEEP + 1 ] = {};     //!< Per ResultType::code_t.
+            std::uint64_t high_water = 0;            //!< Largest batch (chunk of lines and reports), in bytes.
+        };
+
+        /// The counters of the calling thread.
+        static Counters & local( void );
+        /// Reads the clock used to time the stages (TSC ticks, where available).
+        static std::uint64_t now( void );
+        /// Counts the outcome of one expression.
+        static void count_outcome( const OutcomeBase & outcome_ );
+        /// Prints the totals of all threads, either as text or as a JSON object.
+        static void print( std::ostream & os_, bool json_ );
+};
+
+/// Adds the time spent in a scope to one stage.
+class StageTimer
+{
+    public:
+        explicit StageTimer( Stats::stage_t stage_ ) : stage{ stage_ }, start{ Stats::now() } {}
+        ~StageTimer()
+        {
+            auto & c = Stats::local();
+            c.ticks[ stage ] += Stats::now() - start;
+            ++c.calls[ stage ];
+        }
+    private:
+        Stats::stage_t stage;
+        std::uint64_t start;
+};
+
+#define BARES_STATS_CONCAT_( a, b ) a ## b
+#define BARES_STATS_NAME_( a, b ) BARES_STATS_CONCAT_( a, b )
+/// Times the rest of the enclosing scope as stage `s` (READ, PARSE, EVAL or OUTPUT).
+#define BARES_STAGE( s ) StageTimer BARES_STATS_NAME_( bares_stage_, __LINE__ )( Stats::s )
+/// Adds `n` to the counter `c` (LINES, BYTES, CACHE_HITS or CACHE_MISSES).
+#define BARES_COUNT( c, n ) ( Stats::local().counts[ Stats::c ] += ( n ) )
+/// Counts the outcome `o` of an expression.
+#define BARES_COUNT_OUTCOME( o ) Stats::count_outcome( o )
+/// Records a batch of `n` bytes, keeping the largest one.
+#define BARES_HIGH_WATER( n ) ( Stats::local().high_water = std::max< std::uint64_t >( Stats::local().high_water, ( n ) ) )
+
+#else
+
+#define BARES_STAGE( s )
+#define BARES_COUNT( c, n )
+#define BARES_COUNT_OUTCOME( o )
+#define BARES_HIGH_WATER( n )
+
+#endif
+
+#endif
@@ -1,8 +1,9 @@
 #ifndef _TOKEN_H_
 #define _TOKEN_H_
 
-#include <string>   // std::string
-#include <iostream> // std::ostream
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <iostream>    // std::ostream
 
 /// Represents a token.
 struct Token
@@ -13,7 +14,8 @@ struct Token
             OPERAND = 0, //!< A type representing numbers.
             OPERATOR,     //!< A type representing  "+", "-", "^", "*", "%", "/".
             OP_SCOPE,     //!< A type representing "(".
-            CL_SCOPE      //!< A type representing ")".
+            CL_SCOPE,     //!< A type representing ")".
+            VARIABLE      //!< A type representing a variable name (only in formulas).
         };
 
         std::string value; //!< The token value as a string.
@@ -28,7 +30,7 @@ struct Token
         /// Just to help us debug the code.
         friend std::ostream & operator<<( std::ostream& os_, const Token & t_ )
         {
-            std::string types[] = { "OPERAND", "OPERATOR", "OP_SCOPE", "CL_SCOPE" };
+            std::string types[] = { "OPERAND", "OPERATOR", "OP_SCOPE", "CL_SCOPE", "VARIABLE" };
 
             os_ << "<" << t_.value << "," << types[(int)(t_.type)] << ">";
 
@@ -36,4 +38,36 @@ struct Token
         }
 };
 
+/// A token that refers back into the source expression, instead of owning a copy of its text.
+/*!
+ * The parser fills a list of these without allocating memory (once the list has grown
+ * to its working size).  The `value` view is only valid while the source expression
+ * handed to Parser::parse() is alive and unchanged.
+ */
+struct TokenView
+{
+    public:
+        typedef long long int number_type; //!< Type of the pre-decoded value of an operand.
+
+        std::string_view value; //!< The slice of the source expression that makes up this token.
+        Token::token_t type;    //!< The token type.
+        number_type number;     //!< The pre-decoded integer, meaningful only for Token::token_t::OPERAND.
+
+        /// Construtor default.
+        explicit TokenView( std::string_view value_="", Token::token_t type_ = Token::token_t::OPERAND,
+                            number_type number_=0 )
+            : value( value_ )
+            , type( type_ )
+            , number( number_ )
+        {/* empty */}
+
+        /// Creates the corresponding owning token (this allocates).
+        Token to_token( void ) const
+        { return Token( std::string( value ), type ); }
+
+        /// Prints the token the same way Token does.
+        friend std::ostream & operator<<( std::ostream& os_, const TokenView & t_ )
+        { return os_ << t_.to_token(); }
+};
+
 #endif
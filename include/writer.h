@@ -0,0 +1,58 @@
+#ifndef _WRITER_H_
+#define _WRITER_H_
+
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <cstddef>     // std::size_t
+
+#include "report.h"    // report_format_t, print_outcome().
+
+/*!
+ * Collects the reports in a large buffer and writes them out in big blocks.
+ *
+ * The buffer is reused after every flush, so formatting does not allocate once it has
+ * grown to its working size.  Nothing is flushed per line: the data goes to the file
+ * descriptor when the buffer reaches the flush size, when flush() is called, or when
+ * the writer is destroyed.
+ */
+class OutputWriter
+{
+    public:
+        //=== Alias
+        typedef std::size_t size_type; //!< Used for sizes.
+
+        /// Default flush size.
+        static constexpr size_type FLUSH_SIZE = 1 << 20;
+
+        /// Creates a writer for the file descriptor `fd_`. A flush size of 0 flushes every report.
+        explicit OutputWriter( int fd_, report_format_t format_=report_format_t::HUMAN,
+                               size_type flush_size_=FLUSH_SIZE );
+        /// Flushes whatever is left.
+        ~OutputWriter();
+        /// Turn off copy constructor.
+        OutputWriter( const OutputWriter & ) = delete;
+        /// Turn off assignment operator.
+        OutputWriter & operator=( const OutputWriter & ) = delete;
+
+        /// Reports the outcome of the expression `expr_`, in the format of this writer (see print_outcome()).
+        template < typename T >
+        void write( std::string_view expr_, const BasicOutcome< T > & outcome_ );
+        /// Writes text that is already formatted (e.g. reports produced by other threads).
+        void write_raw( std::string_view text_ );
+        /// Sends the buffered data to the file descriptor.
+        void flush( void );
+
+        /// Retrieves the format of the reports.
+        report_format_t get_format( void ) const { return format; }
+
+    private:
+        int fd;                 //!< Where the data goes.
+        report_format_t format; //!< Format of the reports.
+        size_type flush_size;   //!< Flush when the buffer gets this big.
+        std::string buffer;     //!< Data not written yet.
+
+        void maybe_flush( void ) { if ( buffer.size() >= flush_size ) flush(); }
+        void write_all( std::string_view data_ ); // Writes straight to the file descriptor.
+};
+
+#endif
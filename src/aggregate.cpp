@@ -0,0 +1,237 @@
+#include "../include/aggregate.h"
+#include "../include/report.h"
+#include <algorithm> // std::min
+#include <cmath>     // std::ceil
+#include <cstdio>    // std::snprintf
+
+/// The BigInt of `v_`, built 32 bits at a time (BigInt only takes a `long long`).
+static BigInt to_big( __int128 v_ )
+{
+    BigInt r( static_cast< long long >( v_ >> 96 ) ), chunk, base( 1ll << 32 );
+    for ( int shift = 64 ; shift >= 0 ; shift -= 32 )
+    {
+        chunk = static_cast< long long >( ( v_ >> shift ) & 0xFFFFFFFF );
+        BigInt::mul( r, base, r );
+        BigInt::add( r, chunk, r );
+    }
+    return r;
+}
+
+/// @param quantiles_ the quantiles print() reports (none turns the histogram off).
+template < typename T >
+Aggregate< T >::Aggregate( const std::vector< double > & quantiles_ )
+    : status_counts( OutcomeBase::NUMERIC_OVERFLOW + 1 )
+    , parse_counts( Parser::ResultType::NESTING_TOO_DEEP + 1 )
+    , quantiles( quantiles_ )
+{
+    if ( not quantiles.empty() )
+    {
+        positive.flat.resize( FLAT_BUCKETS );
+        negative.flat.resize( FLAT_BUCKETS );
+    }
+}
+
+/// Adds a value to the sum, the extremes and (if there are quantiles) the histogram.
+template < typename T >
+void Aggregate< T >::add_value( const T & v_ )
+{
+    if ( n_valid++ == 0 ) min = max = v_;
+    else if ( v_ < min ) min = v_;
+    else if ( max < v_ ) max = v_;
+
+    if constexpr ( std::is_same< T, BigInt >::value )
+        BigInt::add( sum, v_, sum );
+    else if constexpr ( std::is_same< sum_type, BigInt >::value )
+    {
+        __int128 next;
+        if ( not __builtin_add_overflow( partial, v_, &next ) ) partial = next;
+        else
+        {
+            BigInt::add( sum, to_big( partial ), sum );
+            partial = v_;
+        }
+    }
+    else
+        sum += v_;
+
+    if ( quantiles.empty() ) return;
+    auto & histogram = v_ < 0 ? negative : positive;
+    auto b = bucket( v_ );
+    if ( b < FLAT_BUCKETS ) ++histogram.flat[b];
+    else ++histogram.sparse[b];
+}
+
+/// Counts an outcome with an error under its name.
+template < typename T >
+void Aggregate< T >::count_error( const OutcomeBase & outcome_ )
+{
+    ++n_invalid;
+    ++status_counts[ outcome_.status ];
+    if ( outcome_.status == OutcomeBase::PARSE_ERROR )
+        ++parse_counts[ outcome_.parse_result.type ];
+}
+
+/*!
+ * The bucket of a magnitude below 64 is the magnitude itself; otherwise, for a magnitude
+ * of `n` bits whose `MANTISSA_BITS + 1` leading bits are `m`, it is `m + 32 * ( n - 6 )`.
+ */
+template < typename T >
+typename Aggregate< T >::size_type Aggregate< T >::bucket( const T & v_ )
+{
+    constexpr size_type top = MANTISSA_BITS + 1;
+    size_type n_bits;
+    std::uint64_t leading;
+    if constexpr ( std::is_same< T, BigInt >::value )
+    {
+        n_bits = v_.bits();
+        leading = v_.leading_bits( top );
+    }
+    else
+    {
+        typedef typename std::conditional< ( sizeof( T ) > sizeof( long ) ), unsigned __int128, unsigned long >::type U;
+        U m = v_ < 0 ? U( 0 ) - U( v_ ) : U( v_ );
+        auto high = std::uint64_t( m >> 32 >> 32 ); // Zero, unless U is 128 bits.
+        n_bits = high != 0 ? 128 - __builtin_clzll( high )
+                           : ( std::uint64_t( m ) != 0 ? 64 - __builtin_clzll( std::uint64_t( m ) ) : 0 );
+        leading = std::uint64_t( n_bits > top ? m >> ( n_bits - top ) : m );
+    }
+    return n_bits <= top ? leading : leading + ( ( n_bits - top ) << MANTISSA_BITS );
+}
+
+/// The value of the bucket `bucket_` of the sign `negative_` that is nearest to zero.
+template < typename T >
+T Aggregate< T >::lower_bound( size_type bucket_, bool negative_ )
+{
+    size_type shift = 0, m = bucket_;
+    if ( bucket_ >= ( size_type( 2 ) << MANTISSA_BITS ) )
+    {
+        shift = ( bucket_ >> MANTISSA_BITS ) - 1;
+        m = ( bucket_ & ( ( 1u << MANTISSA_BITS ) - 1 ) ) | ( 1u << MANTISSA_BITS );
+    }
+
+    if constexpr ( std::is_same< T, BigInt >::value )
+    {
+        BigInt r;
+        BigInt::pow( BigInt( 2 ), BigInt( static_cast< long long >( shift ) ), r );
+        BigInt::mul( r, BigInt( static_cast< long long >( m ) ), r );
+        if ( negative_ ) BigInt::sub( BigInt(), r, r );
+        return r;
+    }
+    else
+    {
+        // In the unsigned type: the magnitude of the smallest value does not fit in T.
+        typedef typename std::conditional< ( sizeof( T ) > sizeof( long ) ), unsigned __int128, unsigned long >::type U;
+        U magnitude = U( m ) << shift;
+        return T( negative_ ? U( 0 ) - magnitude : magnitude );
+    }
+}
+
+/*!
+ * Goes through the buckets in the order of their values (the negative ones by decreasing
+ * magnitude) up to the one with the value of rank `q_ * n`, and takes its bound nearest to
+ * zero, kept between the smallest and the largest value.
+ */
+template < typename T >
+T Aggregate< T >::quantile( double q_ ) const
+{
+    count_type rank = static_cast< count_type >( std::ceil( q_ * n_valid ) );
+    rank = std::min( std::max< count_type >( rank, 1 ), n_valid );
+    if ( rank == 1 ) return min;
+    if ( rank == n_valid ) return max;
+
+    count_type seen = 0;
+    T value = max;
+    bool found = false;
+    auto visit = [&]( size_type bucket_, count_type count_, bool negative_ ) {
+        if ( found or ( seen += count_ ) < rank ) return;
+        value = lower_bound( bucket_, negative_ );
+        found = true;
+    };
+    for ( auto it = negative.sparse.rbegin() ; it != negative.sparse.rend() ; ++it ) visit( it->first, it->second, true );
+    for ( size_type b = negative.flat.size() ; b-- > 0 ; ) visit( b, negative.flat[b], true );
+    for ( size_type b{0} ; b < positive.flat.size() ; ++b ) visit( b, positive.flat[b], false );
+    for ( const auto & e : positive.sparse ) visit( e.first, e.second, false );
+
+    if ( value < min ) return min;
+    if ( max < value ) return max;
+    return value;
+}
+
+/*!
+ * The text form has one "name: value" per line: the counts, the sum, the extremes and the
+ * quantiles (as "p50" and so on) of the values, and then the count of each error that
+ * happened, by the name the compact format gives it.  The JSON form has the same, with the
+ * quantiles and the errors in objects of their own.
+ *
+ * @param out_ the buffer that receives the text.
+ * @param json_ whether to write a JSON object.
+ */
+template < typename T >
+void Aggregate< T >::print( std::string & out_, bool json_ ) const
+{
+    auto field = [&]( const char * name_, bool first_ ) {
+        if ( json_ ) ( ( ( out_ += first_ ? "\"" : ",\"" ) += name_ ) += "\":" );
+        else ( out_ += name_ ) += ": ";
+    };
+    auto end_field = [&]() { if ( not json_ ) out_ += '\n'; };
+    auto number = [&]( const char * name_, const auto & v_, bool first_=false ) {
+        field( name_, first_ );
+        append_number( out_, v_ );
+        end_field();
+    };
+
+    if ( json_ ) out_ += '{';
+    number( "lines", static_cast< long >( n_lines() ), true );
+    number( "valid", static_cast< long >( n_valid ) );
+    number( "invalid", static_cast< long >( n_invalid ) );
+    if constexpr ( std::is_same< sum_type, BigInt >::value and not std::is_same< T, BigInt >::value )
+    {
+        BigInt total;
+        BigInt::add( sum, to_big( partial ), total );
+        number( "sum", total );
+    }
+    else
+        number( "sum", sum );
+
+    // Sem valores, não há extremos nem quantis.
+    char label[32];
+    if ( n_valid != 0 )
+    {
+        number( "min", min );
+        number( "max", max );
+    }
+    else if ( json_ )
+        out_ += ",\"min\":null,\"max\":null";
+    if ( json_ and not quantiles.empty() ) out_ += ",\"quantiles\":{";
+    for ( size_type i{0} ; i < quantiles.size() ; ++i )
+    {
+        if ( json_ ) std::snprintf( label, sizeof( label ), "%s\"%g\":", i == 0 ? "" : ",", quantiles[i] );
+        else std::snprintf( label, sizeof( label ), "p%g: ", quantiles[i] * 100 );
+        out_ += label;
+        if ( n_valid != 0 ) append_number( out_, quantile( quantiles[i] ) );
+        else out_ += json_ ? "null" : "-";
+        end_field();
+    }
+    if ( json_ and not quantiles.empty() ) out_ += '}';
+
+    if ( json_ ) out_ += ",\"errors\":{";
+    bool first = true;
+    auto error = [&]( const OutcomeBase & outcome_, count_type count_ ) {
+        if ( count_ == 0 ) return;
+        field( error_name( outcome_ ), first );
+        append_number( out_, static_cast< long >( count_ ) );
+        end_field();
+        first = false;
+    };
+    for ( size_type c{1} ; c < parse_counts.size() ; ++c )
+        error( OutcomeBase( OutcomeBase::PARSE_ERROR,
+                            Parser::ResultType( static_cast< Parser::ResultType::code_t >( c ) ) ), parse_counts[c] );
+    for ( size_type s = OutcomeBase::DIVISION_BY_ZERO ; s < status_counts.size() ; ++s )
+        error( OutcomeBase( static_cast< OutcomeBase::status_t >( s ) ), status_counts[s] );
+    if ( json_ ) out_ += "}}\n";
+}
+
+template class Aggregate< std::int32_t >;
+template class Aggregate< long >;
+template class Aggregate< __int128 >;
+template class Aggregate< BigInt >;
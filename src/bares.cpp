@@ -0,0 +1,78 @@
+#include "../include/bares.h"
+#include "../include/evaluator.h"
+#include "../include/report.h" // error_name(), reported_column()
+#include <new>                 // std::nothrow, std::bad_alloc
+
+/// The handle is the evaluator itself.
+struct bares_evaluator
+{
+    Evaluator evaluator;
+
+    explicit bares_evaluator( const EvaluatorConfig & config_ )
+        : evaluator( config_ )
+    { /* empty */ }
+};
+
+/// Translates an outcome into its C form.
+static bares_status to_result( const Outcome & outcome_, bares_result & result_ )
+{
+    result_.status = static_cast< bares_status >( outcome_.status );
+    result_.value = outcome_.status == Outcome::OK ? outcome_.value : 0;
+    result_.error = error_name( outcome_ );
+    switch ( outcome_.status )
+    {
+        case Outcome::OK:          result_.column = 0; break;
+        case Outcome::PARSE_ERROR: result_.column = reported_column( outcome_.parse_result ); break;
+        default:                   result_.column = outcome_.at_col; break;
+    }
+    return result_.status;
+}
+
+bares_evaluator * bares_create( size_t cache_size, size_t max_depth )
+{
+    EvaluatorConfig config;
+    config.cache_size = cache_size;
+    if ( max_depth != 0 ) config.max_depth = max_depth;
+    try
+    {
+        return new bares_evaluator( config );
+    }
+    catch ( const std::bad_alloc & )
+    {
+        return nullptr;
+    }
+}
+
+void bares_destroy( bares_evaluator * evaluator )
+{
+    delete evaluator;
+}
+
+bares_status bares_evaluate( bares_evaluator * evaluator, const char * expr, size_t size, bares_result * result )
+{
+    // Running out of memory is the only thing that may throw.
+    try
+    {
+        return to_result( evaluator->evaluator.evaluate( std::string_view( expr, size ) ), *result );
+    }
+    catch ( const std::bad_alloc & )
+    {
+        *result = bares_result{ BARES_OUT_OF_MEMORY, 0, 0, "OUT_OF_MEMORY" };
+        return result->status;
+    }
+}
+
+size_t bares_evaluate_batch( bares_evaluator * evaluator, const bares_string * exprs, size_t n, bares_result * results )
+{
+    size_t i = 0;
+    try
+    {
+        for ( ; i < n ; ++i )
+            to_result( evaluator->evaluator.evaluate( std::string_view( exprs[i].data, exprs[i].size ) ), results[i] );
+    }
+    catch ( const std::bad_alloc & )
+    {
+        results[i] = bares_result{ BARES_OUT_OF_MEMORY, 0, 0, "OUT_OF_MEMORY" };
+    }
+    return i;
+}
@@ -0,0 +1,182 @@
+#include "../include/batch.h"
+#include "../include/evaluator.h"
+#include "../include/report.h"
+#include "../include/cache.h"
+#include "../include/stats.h"
+
+/*!
+ * @param n_jobs_ number of worker threads (at least one).
+ * @param writer_ the writer that receives the reports.
+ * @param config_ set up of the evaluator of each worker (e.g. the size of its cache).
+ * @param chunk_lines_ number of lines handed to a worker at a time.
+ */
+BatchRunner::BatchRunner( size_type n_jobs_, OutputWriter & writer_, const EvaluatorConfig & config_,
+                          size_type chunk_lines_ )
+    : writer( writer_ )
+    , config( config_ )
+    , chunk_lines( chunk_lines_ == 0 ? 1 : chunk_lines_ )
+{
+    if ( n_jobs_ == 0 ) n_jobs_ = 1;
+    // Enough chunks to keep everybody busy, but no more, so memory stays bounded.
+    max_in_flight = 4 * n_jobs_;
+
+    for ( size_type i{0} ; i < n_jobs_ ; ++i )
+        workers.emplace_back( new Worker );
+    for ( size_type i{0} ; i < n_jobs_ ; ++i )
+        workers[i]->thread = std::thread( &BatchRunner::work, this, i );
+
+    current = new_chunk();
+}
+
+/// Writes out whatever is left and joins the workers.
+BatchRunner::~BatchRunner()
+{
+    finish();
+    {
+        std::lock_guard< std::mutex > lock( state_mtx );
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for ( auto & w : workers )
+        w->thread.join();
+}
+
+/// Appends a line to the chunk being filled in, handing it to the workers when it is full.
+void BatchRunner::add_line( std::string_view line_ )
+{
+    current->text += line_;
+    current->text += '\n';
+    if ( ++current_lines == chunk_lines )
+        submit();
+}
+
+/// Submits the partial chunk and writes out all the pending reports.
+void BatchRunner::finish( void )
+{
+    if ( current_lines != 0 )
+        submit();
+    while ( not in_flight.empty() )
+        write_front();
+}
+
+/// Queues the current chunk on the next worker (round robin) and starts a new one.
+void BatchRunner::submit( void )
+{
+    // Do not get too far ahead of the output.
+    if ( in_flight.size() >= max_in_flight )
+        write_front();
+
+    auto & w = *workers[ next_worker ];
+    next_worker = ( next_worker + 1 ) % workers.size();
+    {
+        std::lock_guard< std::mutex > lock( w.mtx );
+        w.queue.push_back( current );
+    }
+    {
+        std::lock_guard< std::mutex > lock( state_mtx );
+        ++pending;
+    }
+    work_cv.notify_one();
+
+    in_flight.push_back( current );
+    current = new_chunk();
+    current_lines = 0;
+}
+
+/// Waits for the oldest submitted chunk to be done and writes its reports.
+void BatchRunner::write_front( void )
+{
+    auto chunk = in_flight.front();
+    in_flight.pop_front();
+    {
+        std::unique_lock< std::mutex > lock( done_mtx );
+        done_cv.wait( lock, [&]{ return chunk->done; } );
+    }
+    writer.write_raw( chunk->output );
+
+    // The worker is done with it, so the chunk may be emptied and used again.
+    auto used = chunk->text.size() + chunk->output.size();
+    if ( used > high_water ) high_water = used;
+    BARES_HIGH_WATER( used );
+    chunk->text.clear();
+    chunk->output.clear();
+    chunk->done = false;
+    spare.push_back( std::move( chunk ) );
+}
+
+/// Returns an empty chunk, reusing the memory of one already written if possible.
+std::shared_ptr< BatchRunner::Chunk > BatchRunner::new_chunk( void )
+{
+    if ( spare.empty() ) return std::make_shared< Chunk >();
+    auto chunk = std::move( spare.back() );
+    spare.pop_back();
+    return chunk;
+}
+
+/*!
+ * Gets the next chunk for a worker: first from its own queue, otherwise stolen from another worker.
+ *
+ * @param id_ the worker asking for work.
+ * @return the chunk, or `nullptr` when the runner is stopping and there is nothing left.
+ */
+std::shared_ptr< BatchRunner::Chunk > BatchRunner::take( size_type id_ )
+{
+    {
+        std::unique_lock< std::mutex > lock( state_mtx );
+        work_cv.wait( lock, [&]{ return pending != 0 or stopping; } );
+        if ( pending == 0 ) return nullptr;
+        // We own one of the queued chunks now, we only have to find it.
+        --pending;
+    }
+
+    for (;;)
+    {
+        for ( size_type k{0} ; k < workers.size() ; ++k )
+        {
+            auto & w = *workers[ ( id_ + k ) % workers.size() ];
+            std::lock_guard< std::mutex > lock( w.mtx );
+            if ( w.queue.empty() ) continue;
+
+            std::shared_ptr< Chunk > chunk;
+            if ( k == 0 ) { chunk = w.queue.front(); w.queue.pop_front(); } // Our own work, oldest first.
+            else          { chunk = w.queue.back();  w.queue.pop_back(); }  // Stolen work, newest first.
+            return chunk;
+        }
+    }
+}
+
+/// Worker main loop: evaluates every line of each chunk it gets.
+void BatchRunner::work( size_type id_ )
+{
+    Evaluator evaluator( config ); // Each worker has its own parser and VM (and cache).
+    const auto format = writer.get_format();
+    size_type hits{0}, misses{0}; // Cache counters already added to the totals.
+
+    while ( auto chunk = take( id_ ) )
+    {
+        std::string_view text( chunk->text );
+        while ( not text.empty() )
+        {
+            auto eol = text.find( '\n' );
+            auto line = text.substr( 0, eol );
+            auto outcome = evaluator.evaluate( line );
+            BARES_STAGE( OUTPUT );
+            print_outcome( chunk->output, line, outcome, format );
+            text.remove_prefix( eol + 1 );
+        }
+
+        if ( auto cache = evaluator.get_cache() )
+        {
+            n_cache_hits += cache->hits() - hits;
+            n_cache_misses += cache->misses() - misses;
+            hits = cache->hits();
+            misses = cache->misses();
+        }
+
+        {
+            std::lock_guard< std::mutex > lock( done_mtx );
+            chunk->done = true;
+        }
+        done_cv.notify_all();
+    }
+}
@@ -0,0 +1,663 @@
+#include "../include/bigint.h"
+#include <algorithm> // std::fill, std::copy, std::reverse
+#include <cassert>   // assert
+
+namespace {
+
+typedef BigInt::limb_type limb;
+typedef BigInt::double_limb_type dlimb;
+
+constexpr unsigned LIMB_BITS = 32;
+constexpr limb DECIMAL_BASE = 1000000000; // The largest power of ten in a limb.
+constexpr unsigned DECIMAL_DIGITS = 9;    // Its number of zeros.
+
+/*!
+ * Where products and quotients are computed.  The result is then swapped into its
+ * BigInt, whose old limbs are kept here for the next one, so that once the buffers have
+ * grown to their working size the operations do not allocate.
+ */
+thread_local std::vector< limb > spare[2];
+
+//=== Operations on magnitudes (arrays of limbs, least significant first).
+
+/// r = a + b, all `n_` limbs long; returns the carry. `r_` may be `a_` or `b_`.
+limb add_n( limb * r_, const limb * a_, const limb * b_, std::size_t n_ )
+{
+    dlimb carry = 0;
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+    {
+        carry += dlimb( a_[i] ) + b_[i];
+        r_[i] = limb( carry );
+        carry >>= LIMB_BITS;
+    }
+    return limb( carry );
+}
+
+/// r = a + c, `n_` limbs long; returns the carry. `r_` may be `a_`.
+limb add_1( limb * r_, const limb * a_, std::size_t n_, limb c_ )
+{
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+    {
+        dlimb sum = dlimb( a_[i] ) + c_;
+        r_[i] = limb( sum );
+        c_ = limb( sum >> LIMB_BITS );
+    }
+    return c_;
+}
+
+/// r = a - b, all `n_` limbs long; returns the borrow. `r_` may be `a_` or `b_`.
+limb sub_n( limb * r_, const limb * a_, const limb * b_, std::size_t n_ )
+{
+    dlimb borrow = 0;
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+    {
+        dlimb diff = dlimb( a_[i] ) - b_[i] - borrow;
+        r_[i] = limb( diff );
+        borrow = ( diff >> LIMB_BITS ) & 1;
+    }
+    return limb( borrow );
+}
+
+/// r = a - c, `n_` limbs long; returns the borrow. `r_` may be `a_`.
+limb sub_1( limb * r_, const limb * a_, std::size_t n_, limb c_ )
+{
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+    {
+        dlimb diff = dlimb( a_[i] ) - c_;
+        r_[i] = limb( diff );
+        c_ = limb( ( diff >> LIMB_BITS ) & 1 );
+    }
+    return c_;
+}
+
+/// Compares two magnitudes without leading zero limbs: <0, 0 or >0.
+int compare( const limb * a_, std::size_t na_, const limb * b_, std::size_t nb_ )
+{
+    if ( na_ != nb_ ) return na_ < nb_ ? -1 : 1;
+    for ( std::size_t i = na_ ; i-- > 0 ; )
+        if ( a_[i] != b_[i] ) return a_[i] < b_[i] ? -1 : 1;
+    return 0;
+}
+
+void multiply( limb * r_, const limb * a_, std::size_t na_, const limb * b_, std::size_t nb_ );
+
+/// r = a * b, the schoolbook way; `r_` (na_+nb_ limbs) must not overlap the factors.
+void multiply_basecase( limb * r_, const limb * a_, std::size_t na_, const limb * b_, std::size_t nb_ )
+{
+    std::fill( r_, r_ + na_ + nb_, 0 );
+    for ( std::size_t i{0} ; i < nb_ ; ++i )
+    {
+        dlimb carry = 0;
+        for ( std::size_t j{0} ; j < na_ ; ++j )
+        {
+            carry += dlimb( a_[j] ) * b_[i] + r_[ i + j ];
+            r_[ i + j ] = limb( carry );
+            carry >>= LIMB_BITS;
+        }
+        r_[ i + na_ ] = limb( carry );
+    }
+}
+
+/*!
+ * r = a * b, both `n_` limbs long, with Karatsuba's method: with a = a1*B^h + a0 and
+ * b = b1*B^h + b0, a*b = z2*B^2h + z1*B^h + z0, where z0 = a0*b0, z2 = a1*b1 and
+ * z1 = (a0+a1)*(b0+b1) - z0 - z2: three products of half the size.
+ */
+void multiply_karatsuba( limb * r_, const limb * a_, const limb * b_, std::size_t n_ )
+{
+    const std::size_t h = n_ / 2;     // Limbs of a0 and b0.
+    const std::size_t hh = n_ - h;    // Limbs of a1 and b1 (h or h+1).
+
+    multiply( r_, a_, h, b_, h );                     // z0, in r[0, 2h).
+    multiply( r_ + 2 * h, a_ + h, hh, b_ + h, hh );   // z2, in r[2h, 2n).
+
+    std::vector< limb > sa( hh + 1 ), sb( hh + 1 ), z1( 2 * hh + 2 );
+    std::copy( a_ + h, a_ + n_, sa.begin() );
+    std::copy( b_ + h, b_ + n_, sb.begin() );
+    sa[ hh ] = add_1( sa.data() + h, sa.data() + h, hh - h, add_n( sa.data(), sa.data(), a_, h ) );
+    sb[ hh ] = add_1( sb.data() + h, sb.data() + h, hh - h, add_n( sb.data(), sb.data(), b_, h ) );
+    multiply( z1.data(), sa.data(), hh + 1, sb.data(), hh + 1 );
+
+    // z1 -= z0 + z2 (it cannot go below zero).
+    limb borrow = sub_n( z1.data(), z1.data(), r_, 2 * h );
+    sub_1( z1.data() + 2 * h, z1.data() + 2 * h, z1.size() - 2 * h, borrow );
+    borrow = sub_n( z1.data(), z1.data(), r_ + 2 * h, 2 * hh );
+    sub_1( z1.data() + 2 * hh, z1.data() + 2 * hh, z1.size() - 2 * hh, borrow );
+
+    // r += z1 * B^h (z1 is below B^(h+2hh), so its top limbs are zero when they do not fit).
+    const std::size_t room = 2 * n_ - h;
+    std::size_t len = std::min( z1.size(), room );
+    limb carry = add_n( r_ + h, r_ + h, z1.data(), len );
+    add_1( r_ + h + len, r_ + h + len, room - len, carry );
+}
+
+/// r = a * b; `r_` (na_+nb_ limbs) must not overlap the factors.
+void multiply( limb * r_, const limb * a_, std::size_t na_, const limb * b_, std::size_t nb_ )
+{
+    if ( na_ < nb_ )
+    {
+        std::swap( a_, b_ );
+        std::swap( na_, nb_ );
+    }
+    if ( nb_ == 0 )
+    {
+        std::fill( r_, r_ + na_, 0 );
+        return;
+    }
+    if ( nb_ < BigInt::KARATSUBA_THRESHOLD )
+    {
+        multiply_basecase( r_, a_, na_, b_, nb_ );
+        return;
+    }
+    if ( na_ == nb_ )
+    {
+        multiply_karatsuba( r_, a_, b_, na_ );
+        return;
+    }
+
+    // Unbalanced: `a` in slices as long as `b`.
+    std::fill( r_, r_ + na_ + nb_, 0 );
+    std::vector< limb > partial( 2 * nb_ );
+    for ( std::size_t i{0} ; i < na_ ; i += nb_ )
+    {
+        std::size_t m = std::min( nb_, na_ - i );
+        multiply( partial.data(), a_ + i, m, b_, nb_ );
+        limb carry = add_n( r_ + i, r_ + i, partial.data(), m + nb_ );
+        add_1( r_ + i + m + nb_, r_ + i + m + nb_, na_ - i - m, carry );
+    }
+}
+
+/// Divides the magnitude `a_` in place by `d_`; returns the remainder.
+limb divide_1( std::vector< limb > & a_, limb d_ )
+{
+    dlimb rem = 0;
+    for ( std::size_t i = a_.size() ; i-- > 0 ; )
+    {
+        dlimb cur = ( rem << LIMB_BITS ) | a_[i];
+        a_[i] = limb( cur / d_ );
+        rem = cur % d_;
+    }
+    while ( not a_.empty() and a_.back() == 0 ) a_.pop_back();
+    return limb( rem );
+}
+
+/*!
+ * q = u / v and r = u % v, for magnitudes (Knuth's algorithm D, as in Hacker's Delight).
+ *
+ * @param u_ the dividend, `m_` limbs (m_ >= n_).
+ * @param v_ the divisor, `n_` limbs (n_ >= 2, no leading zero).
+ * @param q_ receives m_-n_+1 limbs.
+ * @param r_ receives n_ limbs.
+ */
+void divide_knuth( const limb * u_, std::size_t m_, const limb * v_, std::size_t n_, limb * q_, limb * r_ )
+{
+    const dlimb base = dlimb( 1 ) << LIMB_BITS;
+    // Normalize: the top bit of the divisor must be set.
+    const unsigned s = __builtin_clz( v_[ n_ - 1 ] );
+    std::vector< limb > vn( n_ ), un( m_ + 1 );
+    for ( std::size_t i = n_ - 1 ; i > 0 ; --i )
+        vn[i] = ( v_[i] << s ) | ( s == 0 ? 0 : limb( dlimb( v_[ i - 1 ] ) >> ( LIMB_BITS - s ) ) );
+    vn[0] = v_[0] << s;
+    un[ m_ ] = s == 0 ? 0 : limb( dlimb( u_[ m_ - 1 ] ) >> ( LIMB_BITS - s ) );
+    for ( std::size_t i = m_ - 1 ; i > 0 ; --i )
+        un[i] = ( u_[i] << s ) | ( s == 0 ? 0 : limb( dlimb( u_[ i - 1 ] ) >> ( LIMB_BITS - s ) ) );
+    un[0] = u_[0] << s;
+
+    for ( std::size_t j = m_ - n_ + 1 ; j-- > 0 ; )
+    {
+        // Estimate the quotient digit, and correct the estimate (at most twice).
+        dlimb num = ( dlimb( un[ j + n_ ] ) << LIMB_BITS ) | un[ j + n_ - 1 ];
+        dlimb qhat = num / vn[ n_ - 1 ];
+        dlimb rhat = num % vn[ n_ - 1 ];
+        while ( qhat >= base or qhat * vn[ n_ - 2 ] > ( ( rhat << LIMB_BITS ) | un[ j + n_ - 2 ] ) )
+        {
+            --qhat;
+            rhat += vn[ n_ - 1 ];
+            if ( rhat >= base ) break;
+        }
+
+        // Multiply and subtract.
+        std::int64_t k = 0, t;
+        for ( std::size_t i{0} ; i < n_ ; ++i )
+        {
+            dlimb p = qhat * vn[i];
+            t = std::int64_t( un[ i + j ] ) - k - std::int64_t( p & 0xFFFFFFFF );
+            un[ i + j ] = limb( t );
+            k = std::int64_t( p >> LIMB_BITS ) - ( t >> LIMB_BITS );
+        }
+        t = std::int64_t( un[ j + n_ ] ) - k;
+        un[ j + n_ ] = limb( t );
+
+        q_[j] = limb( qhat );
+        if ( t < 0 )
+        {
+            // Subtracted too much: add one divisor back.
+            --q_[j];
+            un[ j + n_ ] += add_n( un.data() + j, un.data() + j, vn.data(), n_ );
+        }
+    }
+
+    // Unnormalize the remainder.
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+        r_[i] = ( un[i] >> s ) | ( s == 0 ? 0 : limb( dlimb( un[ i + 1 ] ) << ( LIMB_BITS - s ) ) );
+}
+
+/// Whether a result of `bits_` bits is too large.
+bool too_large( BigInt::size_type bits_ )
+{
+    return bits_ > BigInt::MAX_BITS;
+}
+
+} // namespace
+
+//=== BigInt.
+
+/// The limbs already allocated are kept.
+BigInt & BigInt::operator=( long long v_ )
+{
+    negative = v_ < 0;
+    // The magnitude of the smallest long long does not fit in it, but does in an unsigned one.
+    unsigned long long m = negative ? 0ull - static_cast< unsigned long long >( v_ ) : v_;
+    limbs.clear();
+    while ( m != 0 )
+    {
+        limbs.push_back( limb( m ) );
+        m >>= LIMB_BITS;
+    }
+    return *this;
+}
+
+/// Drops leading zero limbs; zero is never negative.
+void BigInt::trim( void )
+{
+    while ( not limbs.empty() and limbs.back() == 0 ) limbs.pop_back();
+    if ( limbs.empty() ) negative = false;
+}
+
+/// Whether the magnitude is one.
+bool BigInt::is_unit( void ) const
+{
+    return limbs.size() == 1 and limbs[0] == 1;
+}
+
+/// @return the position of the highest bit set, plus one.
+BigInt::size_type BigInt::bits( void ) const
+{
+    if ( limbs.empty() ) return 0;
+    return limbs.size() * LIMB_BITS - __builtin_clz( limbs.back() );
+}
+
+/// @return the bits of the magnitude from `bits() - n_` on (or all of them).
+std::uint64_t BigInt::leading_bits( size_type n_ ) const
+{
+    auto n_bits = bits();
+    size_type shift = n_bits > n_ ? n_bits - n_ : 0;
+    // The bits wanted lie in (at most) three limbs, from the one of the lowest of them.
+    unsigned __int128 window = 0;
+    for ( size_type i = std::min( limbs.size(), shift / LIMB_BITS + 3 ) ; i-- > shift / LIMB_BITS ; )
+        window = window << LIMB_BITS | limbs[i];
+    return std::uint64_t( window >> ( shift % LIMB_BITS ) );
+}
+
+/// Negative values are smaller than the others; magnitudes are compared limb by limb.
+bool operator<( const BigInt & a_, const BigInt & b_ )
+{
+    if ( a_.negative != b_.negative ) return a_.negative;
+    int c = compare( a_.limbs.data(), a_.limbs.size(), b_.limbs.data(), b_.limbs.size() );
+    return a_.negative ? c > 0 : c < 0;
+}
+
+/// r = a * b, with no limit on the size (for the conversions).
+void BigInt::multiply_unchecked( const BigInt & a_, const BigInt & b_, BigInt & r_ )
+{
+    std::vector< limb > product( a_.limbs.size() + b_.limbs.size() );
+    multiply( product.data(), a_.limbs.data(), a_.limbs.size(), b_.limbs.data(), b_.limbs.size() );
+    r_.negative = a_.negative != b_.negative;
+    r_.limbs.swap( product );
+    r_.trim();
+}
+
+/// Appends 10^(9*2^k) to `powers_` (which holds the previous ones) while `more_` says so.
+template < typename More >
+static void grow_decimal_powers( std::vector< BigInt > & powers_, More more_ )
+{
+    if ( powers_.empty() ) powers_.emplace_back( DECIMAL_BASE );
+    while ( more_( powers_.back() ) )
+    {
+        BigInt square;
+        BigInt::multiply_unchecked( powers_.back(), powers_.back(), square );
+        powers_.push_back( std::move( square ) );
+    }
+}
+
+/*!
+ * Reads decimal digits (already validated).  Short runs are read nine digits at a time
+ * (r = r * 10^9 + group); longer ones are split, so that the value is
+ * high * 10^(9*2^k) + low, with `powers_[k]` and fast products.
+ */
+void BigInt::parse_digits( std::string_view digits_, const std::vector< BigInt > & powers_, BigInt & r_ )
+{
+    if ( digits_.size() <= DECIMAL_DIGITS * SMALL_CONVERSION )
+    {
+        r_.limbs.clear();
+        r_.negative = false;
+        for ( std::size_t i{0} ; i < digits_.size() ; )
+        {
+            std::size_t n = std::min< std::size_t >( DECIMAL_DIGITS, digits_.size() - i );
+            limb group = 0, scale = 1;
+            for ( std::size_t k{0} ; k < n ; ++k, ++i )
+            {
+                group = group * 10 + limb( digits_[i] - '0' );
+                scale *= 10;
+            }
+            // r = r * scale + group.
+            dlimb carry = group;
+            for ( auto & l : r_.limbs )
+            {
+                carry += dlimb( l ) * scale;
+                l = limb( carry );
+                carry >>= LIMB_BITS;
+            }
+            if ( carry != 0 ) r_.limbs.push_back( limb( carry ) );
+        }
+        r_.trim();
+        return;
+    }
+
+    std::size_t k = 0; // The low part gets 9*2^k digits, less than all of them.
+    while ( ( DECIMAL_DIGITS << ( k + 1 ) ) < digits_.size() ) ++k;
+    const std::size_t low_size = DECIMAL_DIGITS << k;
+    BigInt high, low;
+    parse_digits( digits_.substr( 0, digits_.size() - low_size ), powers_, high );
+    parse_digits( digits_.substr( digits_.size() - low_size ), powers_, low );
+    multiply_unchecked( high, powers_[k], r_ );
+    add( r_, low, r_ );
+}
+
+/*!
+ * @param text_ an optional "-" followed by one or more decimal digits.
+ * @param r_ receives the value.
+ * @return false if `text_` is not a decimal integer (`r_` is then unspecified).
+ */
+bool BigInt::parse( std::string_view text_, BigInt & r_ )
+{
+    bool minus = not text_.empty() and text_[0] == '-';
+    if ( minus ) text_.remove_prefix( 1 );
+    if ( text_.empty() ) return false;
+    for ( auto c : text_ )
+        if ( c < '0' or c > '9' ) return false;
+
+    std::vector< BigInt > powers;
+    grow_decimal_powers( powers, [&]( const BigInt & ) {
+        return ( DECIMAL_DIGITS << powers.size() ) < text_.size();
+    });
+    parse_digits( text_, powers, r_ );
+    r_.negative = minus and not r_.is_zero();
+    return true;
+}
+
+/*!
+ * Appends the digits of the magnitude `m_`, which is less than `powers_[k_]`, padded with
+ * zeros to 9*2^k_ digits if `pad_` is set.  Short magnitudes give their groups of nine
+ * digits by repeated divisions by 10^9; longer ones are split into the quotient and the
+ * remainder of a division by `powers_[k_-1]`.
+ */
+void BigInt::append_digits( std::string & out_, const BigInt & m_, const std::vector< BigInt > & powers_,
+                            size_type k_, bool pad_ )
+{
+    if ( m_.limbs.size() > SMALL_CONVERSION )
+    {
+        // Without padding, the quotient must not be zero.
+        while ( not pad_ and compare( m_.limbs.data(), m_.limbs.size(),
+                                      powers_[ k_ - 1 ].limbs.data(), powers_[ k_ - 1 ].limbs.size() ) < 0 )
+            --k_;
+        BigInt q, r;
+        divide( m_, powers_[ k_ - 1 ], &q, &r );
+        append_digits( out_, q, powers_, k_ - 1, pad_ );
+        append_digits( out_, r, powers_, k_ - 1, true );
+        return;
+    }
+
+    std::vector< limb > m( m_.limbs );
+    limb groups[ SMALL_CONVERSION * LIMB_BITS / 29 + 1 ]; // 10^9 > 2^29.
+    std::size_t n = 0;
+    while ( not m.empty() )
+    {
+        dlimb rem = 0;
+        for ( std::size_t i = m.size() ; i-- > 0 ; )
+        {
+            dlimb cur = ( rem << LIMB_BITS ) | m[i];
+            m[i] = limb( cur / DECIMAL_BASE );
+            rem = cur % DECIMAL_BASE;
+        }
+        while ( not m.empty() and m.back() == 0 ) m.pop_back();
+        groups[ n++ ] = limb( rem );
+    }
+
+    if ( pad_ ) out_.append( ( DECIMAL_DIGITS << k_ ) - DECIMAL_DIGITS * n, '0' );
+    else if ( n == 0 ) return;
+    for ( std::size_t i = n ; i-- > 0 ; )
+    {
+        if ( i + 1 == n and not pad_ )
+        {
+            out_ += std::to_string( groups[i] );
+            continue;
+        }
+        char digits[ DECIMAL_DIGITS ];
+        limb g = groups[i];
+        for ( unsigned d = DECIMAL_DIGITS ; d-- > 0 ; g /= 10 )
+            digits[d] = char( '0' + g % 10 );
+        out_.append( digits, DECIMAL_DIGITS );
+    }
+}
+
+/// The digits are produced by divide and conquer (see append_digits()).
+void BigInt::append_to( std::string & out_ ) const
+{
+    if ( limbs.empty() )
+    {
+        out_ += '0';
+        return;
+    }
+
+    BigInt m( *this );
+    m.negative = false;
+    std::vector< BigInt > powers;
+    grow_decimal_powers( powers, [&]( const BigInt & p_ ) {
+        return compare( p_.limbs.data(), p_.limbs.size(), m.limbs.data(), m.limbs.size() ) <= 0;
+    });
+
+    if ( negative ) out_ += '-';
+    append_digits( out_, m, powers, powers.size() - 1, false );
+}
+
+/// @return the decimal representation.
+std::string BigInt::to_string( void ) const
+{
+    std::string s;
+    append_to( s );
+    return s;
+}
+
+/*!
+ * r = a + (-1)^b_negative_ * |b|, adding or subtracting the magnitudes.  The result is
+ * computed in the limbs of `r_`, which may be those of either operand.
+ */
+arithmetic::error_t BigInt::add_signed( const BigInt & a_, const BigInt & b_, bool b_negative_, BigInt & r_ )
+{
+    if ( b_.is_zero() )
+    {
+        if ( &r_ != &a_ ) r_ = a_;
+        return arithmetic::NO_ERROR;
+    }
+
+    const BigInt * x = &a_; // The larger magnitude...
+    const BigInt * y = &b_; // ... and the other one.
+    bool x_negative = a_.negative, y_negative = b_negative_;
+    bool same_sign = x_negative == y_negative;
+    if ( compare( a_.limbs.data(), a_.limbs.size(), b_.limbs.data(), b_.limbs.size() ) < 0 )
+    {
+        std::swap( x, y );
+        std::swap( x_negative, y_negative );
+    }
+    const std::size_t nx = x->limbs.size(), ny = y->limbs.size();
+
+    // If `r_` is one of the operands, growing it pads that operand with zeros.
+    r_.limbs.resize( nx + ( same_sign ? 1 : 0 ) );
+    limb * r = r_.limbs.data();
+    const limb * px = x->limbs.data();
+    const limb * py = y->limbs.data();
+    if ( same_sign )
+    {
+        limb carry = add_n( r, px, py, ny );
+        r[ nx ] = add_1( r + ny, px + ny, nx - ny, carry );
+    }
+    else
+    {
+        limb borrow = sub_n( r, px, py, ny );
+        sub_1( r + ny, px + ny, nx - ny, borrow );
+    }
+    r_.negative = x_negative;
+    r_.trim();
+    return too_large( r_.bits() ) ? arithmetic::NUMERIC_OVERFLOW : arithmetic::NO_ERROR;
+}
+
+/// `r_ = a_ + b_`.
+arithmetic::error_t BigInt::add( const BigInt & a_, const BigInt & b_, BigInt & r_ )
+{
+    return add_signed( a_, b_, b_.negative, r_ );
+}
+
+/// `r_ = a_ - b_`.
+arithmetic::error_t BigInt::sub( const BigInt & a_, const BigInt & b_, BigInt & r_ )
+{
+    return add_signed( a_, b_, not b_.negative, r_ );
+}
+
+/// `r_ = a_ * b_` (Karatsuba's method for large factors).
+arithmetic::error_t BigInt::mul( const BigInt & a_, const BigInt & b_, BigInt & r_ )
+{
+    if ( a_.is_zero() or b_.is_zero() )
+    {
+        r_ = 0;
+        return arithmetic::NO_ERROR;
+    }
+    // The product has bits(a) + bits(b) bits, or one less.
+    if ( too_large( a_.bits() + b_.bits() - 1 ) )
+        return arithmetic::NUMERIC_OVERFLOW;
+
+    auto & product = spare[0];
+    product.assign( a_.limbs.size() + b_.limbs.size(), 0 );
+    multiply( product.data(), a_.limbs.data(), a_.limbs.size(), b_.limbs.data(), b_.limbs.size() );
+    r_.negative = a_.negative != b_.negative;
+    r_.limbs.swap( product );
+    r_.trim();
+    return too_large( r_.bits() ) ? arithmetic::NUMERIC_OVERFLOW : arithmetic::NO_ERROR;
+}
+
+/*!
+ * Truncated division: the quotient goes toward zero and the remainder has the sign of
+ * the dividend. Either result may be left out (nullptr); they may be the operands.
+ */
+void BigInt::divide( const BigInt & a_, const BigInt & b_, BigInt * q_, BigInt * r_ )
+{
+    const std::size_t m = a_.limbs.size(), n = b_.limbs.size();
+    assert( n != 0 );
+    if ( compare( a_.limbs.data(), m, b_.limbs.data(), n ) < 0 )
+    {
+        if ( r_ != nullptr and r_ != &a_ ) *r_ = a_;
+        if ( q_ != nullptr ) *q_ = 0;
+        return;
+    }
+
+    auto & q = spare[0];
+    auto & r = spare[1];
+    r.assign( n, 0 );
+    if ( n == 1 )
+    {
+        q.assign( a_.limbs.begin(), a_.limbs.end() );
+        r[0] = divide_1( q, b_.limbs[0] );
+    }
+    else
+    {
+        q.assign( m - n + 1, 0 );
+        divide_knuth( a_.limbs.data(), m, b_.limbs.data(), n, q.data(), r.data() );
+    }
+
+    bool a_negative = a_.negative, b_negative = b_.negative;
+    if ( q_ != nullptr )
+    {
+        q_->limbs.swap( q );
+        q_->negative = a_negative != b_negative;
+        q_->trim();
+    }
+    if ( r_ != nullptr )
+    {
+        r_->limbs.swap( r );
+        r_->negative = a_negative;
+        r_->trim();
+    }
+}
+
+/// `r_ = a_ / b_`, truncated toward zero.
+arithmetic::error_t BigInt::div( const BigInt & a_, const BigInt & b_, BigInt & r_ )
+{
+    if ( b_.is_zero() ) return arithmetic::DIVISION_BY_ZERO;
+    divide( a_, b_, &r_, nullptr );
+    return arithmetic::NO_ERROR;
+}
+
+/// `r_ = a_ % b_`, with the sign of `a_`.
+arithmetic::error_t BigInt::mod( const BigInt & a_, const BigInt & b_, BigInt & r_ )
+{
+    if ( b_.is_zero() ) return arithmetic::MODULO_BY_ZERO;
+    divide( a_, b_, nullptr, &r_ );
+    return arithmetic::NO_ERROR;
+}
+
+/*!
+ * `r_ = a_ ^ b_`, by squaring, as arithmetic::pow().  Results that would be too large are
+ * found before they are computed: |a| >= 2^(bits(a)-1), so |a|^b has at least
+ * (bits(a)-1)*b+1 bits.
+ */
+arithmetic::error_t BigInt::pow( const BigInt & a_, const BigInt & b_, BigInt & r_ )
+{
+    const bool odd = not b_.is_zero() and ( b_.limbs[0] & 1 );
+    if ( b_.negative )
+    {
+        if ( a_.is_zero() ) return arithmetic::DIVISION_BY_ZERO;
+        if ( a_.is_unit() ) r_ = ( a_.negative and odd ) ? -1 : 1;
+        else r_ = 0;
+        return arithmetic::NO_ERROR;
+    }
+    if ( b_.is_zero() or a_.is_unit() )
+    {
+        r_ = ( a_.negative and odd ) ? -1 : 1;
+        return arithmetic::NO_ERROR;
+    }
+    if ( a_.is_zero() )
+    {
+        r_ = 0;
+        return arithmetic::NO_ERROR;
+    }
+
+    // |a| >= 2 from here on, so an exponent of MAX_BITS or more is already too much.
+    if ( b_.bits() > LIMB_BITS * 2 ) return arithmetic::NUMERIC_OVERFLOW;
+    std::uint64_t e = b_.limbs[0] | ( b_.limbs.size() > 1 ? std::uint64_t( b_.limbs[1] ) << LIMB_BITS : 0 );
+    if ( e >= MAX_BITS or too_large( ( a_.bits() - 1 ) * e + 1 ) )
+        return arithmetic::NUMERIC_OVERFLOW;
+
+    BigInt base( a_ ), result( 1 );
+    base.negative = false;
+    for (;;)
+    {
+        if ( e & 1 )
+            if ( auto error = mul( result, base, result ) ) return error;
+        e >>= 1;
+        if ( e == 0 ) break;
+        if ( auto error = mul( base, base, base ) ) return error;
+    }
+    result.negative = a_.negative and odd;
+    r_ = std::move( result );
+    return arithmetic::NO_ERROR;
+}
@@ -0,0 +1,417 @@
+#include "../include/bytecode.h"
+#include "../include/bigint.h"
+#include "../include/parser.h" // Parser::BIG_MAX_DIGITS
+#include <cassert>   // assert
+#include <cstring>   // std::memcpy
+#include <type_traits> // std::is_integral
+#include <algorithm> // std::lower_bound
+
+//=== Program.
+
+/// Removes all instructions, but keeps the memory already allocated.
+void Program::clear( void )
+{
+    code.clear();
+    sites.clear();
+    literals.clear();
+    depth = max_depth = n_variables = 0;
+}
+
+/// The code and the sites are only shrunk, so rewinding does not free (nor allocate) memory.
+void Program::rewind( const Mark & mark_ )
+{
+    code.resize( mark_.code_size );
+    sites.resize( mark_.n_sites );
+    depth = mark_.depth;
+    max_depth = mark_.max_depth;
+    n_variables = mark_.n_variables;
+    literals.resize( mark_.n_literals );
+}
+
+/// Appends an `OP_PUSH` followed by the two bytes of the operand (little endian).
+void Program::emit_push( immediate_type v_ )
+{
+    auto bits = static_cast< std::uint16_t >( v_ );
+    code.push_back( OP_PUSH );
+    code.push_back( static_cast< std::uint8_t >( bits & 0xFF ) );
+    code.push_back( static_cast< std::uint8_t >( bits >> 8 ) );
+
+    if ( ++depth > max_depth ) max_depth = depth;
+}
+
+/// Appends an `OP_PUSH64` followed by the eight bytes of the operand (little endian).
+void Program::emit_push64( std::int64_t v_ )
+{
+    auto bits = static_cast< std::uint64_t >( v_ );
+    code.push_back( OP_PUSH64 );
+    for ( int i{0} ; i < 8 ; ++i, bits >>= 8 )
+        code.push_back( static_cast< std::uint8_t >( bits & 0xFF ) );
+
+    if ( ++depth > max_depth ) max_depth = depth;
+}
+
+/// Appends an `OP_LITERAL` followed by the offset and the length of the digits (four bytes each, little endian).
+void Program::emit_literal( std::string_view digits_ )
+{
+    std::uint32_t operands[2] = { static_cast< std::uint32_t >( literals.size() ),
+                                  static_cast< std::uint32_t >( digits_.size() ) };
+    literals += digits_;
+    code.push_back( OP_LITERAL );
+    for ( auto v : operands )
+        for ( int i{0} ; i < 4 ; ++i, v >>= 8 )
+            code.push_back( static_cast< std::uint8_t >( v & 0xFF ) );
+
+    if ( ++depth > max_depth ) max_depth = depth;
+}
+
+/// @param pc_ points just after the opcode.
+std::string_view Program::get_literal( const std::uint8_t * pc_ ) const
+{
+    auto word = [pc_]( int at_ ) {
+        return std::uint32_t( pc_[at_] ) | std::uint32_t( pc_[at_+1] ) << 8 |
+               std::uint32_t( pc_[at_+2] ) << 16 | std::uint32_t( pc_[at_+3] ) << 24;
+    };
+    return std::string_view( literals ).substr( word( 0 ), word( 4 ) );
+}
+
+/// Appends an `OP_LOAD` followed by the two bytes of the index (little endian).
+void Program::emit_load( std::uint16_t index_ )
+{
+    code.push_back( OP_LOAD );
+    code.push_back( static_cast< std::uint8_t >( index_ & 0xFF ) );
+    code.push_back( static_cast< std::uint8_t >( index_ >> 8 ) );
+
+    if ( index_ >= n_variables ) n_variables = index_ + 1;
+    if ( ++depth > max_depth ) max_depth = depth;
+}
+
+/// Appends the opcode that corresponds to the binary operator `op_`, and remembers its column.
+void Program::emit_operator( char op_, size_type col_ )
+{
+    sites.push_back( Site{ code.size(), col_ } );
+    switch( op_ )
+    {
+        case '+': code.push_back( OP_ADD ); break;
+        case '-': code.push_back( OP_SUB ); break;
+        case '*': code.push_back( OP_MUL ); break;
+        case '/': code.push_back( OP_DIV ); break;
+        case '%': code.push_back( OP_MOD ); break;
+        case '^': code.push_back( OP_POW ); break;
+        default: assert( false );
+    }
+    // Two operands out, one result in.
+    --depth;
+}
+
+/// @param offset_ the offset of an operator instruction (as the VM reports it).
+Program::size_type Program::get_column( size_type offset_ ) const
+{
+    auto it = std::lower_bound( sites.begin(), sites.end(), offset_,
+                                []( const Site & s_, size_type o_ ) { return s_.offset < o_; } );
+    return it == sites.end() ? 0 : it->column;
+}
+
+/// The last instruction of a program computes the result; it is an operator unless the program is a single operand.
+Program::size_type Program::get_result_column( void ) const
+{
+    return ( sites.empty() or sites.back().offset + 1 != code.size() ) ? 0 : sites.back().column;
+}
+
+/// The 64-bit value stored (little endian) at `p_`.
+static std::int64_t read_int64( const std::uint8_t * p_ )
+{
+    std::uint64_t bits = 0;
+    for ( int i{7} ; i >= 0 ; --i )
+        bits = bits << 8 | p_[i];
+    return static_cast< std::int64_t >( bits );
+}
+
+/// Appends `v_` to `out_` as a varint (seven bits per byte, low bits first; the high bit means "more").
+static void put_varint( std::string & out_, std::uint64_t v_ )
+{
+    while ( v_ >= 0x80 )
+    {
+        out_ += static_cast< char >( ( v_ & 0x7F ) | 0x80 );
+        v_ >>= 7;
+    }
+    out_ += static_cast< char >( v_ );
+}
+
+/// Reads a varint at `p_`, if it ends before `end_` and fits in 32 bits, and moves `p_` past it.
+static bool get_varint( const std::uint8_t * & p_, const std::uint8_t * end_, std::uint32_t & v_ )
+{
+    std::uint64_t v = 0;
+    for ( int shift{0} ; p_ != end_ and shift < 35 ; shift += 7 )
+    {
+        auto byte = *p_++;
+        v |= std::uint64_t( byte & 0x7F ) << shift;
+        if ( not ( byte & 0x80 ) )
+        {
+            v_ = static_cast< std::uint32_t >( v );
+            return v <= 0xFFFFFFFF;
+        }
+    }
+    return false;
+}
+
+/// Whether the parser emits an `OP_PUSH64` of `v_` in the width `width_` (W16 has only `OP_PUSH`).
+static bool constant_fits( std::int64_t v_, grammar::width_t width_ )
+{
+    if ( width_ == grammar::width_t::W16 ) return false;
+    if ( width_ == grammar::width_t::W32 ) return v_ >= INT32_MIN and v_ <= INT32_MAX;
+    return true;
+}
+
+/*!
+ * Whether the parser emits an `OP_LITERAL` of `digits_` (an optional '-' and decimal digits)
+ * in the width `width_`: only W128, with a value in its range, and BIG, with at most
+ * Parser::BIG_MAX_DIGITS digits, have them.
+ */
+static bool constant_fits( std::string_view digits_, grammar::width_t width_ )
+{
+    bool negative = digits_[0] == '-';
+    auto magnitude_digits = digits_.substr( negative );
+    if ( width_ == grammar::width_t::BIG ) return magnitude_digits.size() <= Parser::BIG_MAX_DIGITS;
+    if ( width_ != grammar::width_t::W128 ) return false;
+
+    // O mesmo limite que Parser::wide_integer() aplica.
+    const unsigned __int128 limit = static_cast< unsigned __int128 >( 1 ) << 127;
+    unsigned __int128 magnitude = 0;
+    for ( auto c : magnitude_digits )
+    {
+        unsigned digit = c - '0';
+        if ( magnitude > ( limit - digit ) / 10 ) return false;
+        magnitude = magnitude * 10 + digit;
+    }
+    return magnitude < limit or ( negative and magnitude == limit );
+}
+
+/*!
+ * Writes the code, the columns of the operators (in the order of the code) and the
+ * literals, each preceded by its size; sizes and columns are varints (see put_varint()),
+ * so a program takes about as many bytes as its source.  The offsets of the operators,
+ * the stack depths and the number of variables are not saved: load() finds them again
+ * while it checks the code.
+ *
+ * @param out_ the buffer the program is appended to.
+ */
+void Program::save( std::string & out_ ) const
+{
+    put_varint( out_, code.size() );
+    out_.append( reinterpret_cast< const char * >( code.data() ), code.size() );
+    put_varint( out_, sites.size() );
+    for ( const auto & site : sites )
+        put_varint( out_, site.column );
+    put_varint( out_, literals.size() );
+    out_ += literals;
+}
+
+/*!
+ * Reads a program written by save(), reusing the memory of this one.
+ *
+ * The data comes from a file, so it is checked before anything runs it: every opcode
+ * must be known and complete, the stack must never run out and hold a single value at
+ * the end, there must be a column for each operator, and the constants must be integers
+ * that the parser would take in the width `width_` (see constant_fits()), so the virtual
+ * machine never gets one out of the range of its type.  Programs with variables are
+ * rejected (precompiled files have none).
+ *
+ * @param p_ where the program starts; on success, it is moved past the program.
+ * @param end_ the end of the data.
+ * @param width_ the width the program was compiled with.
+ * @return true if a valid program was read; false otherwise (the program is then unspecified).
+ */
+bool Program::load( const std::uint8_t * & p_, const std::uint8_t * end_, grammar::width_t width_ )
+{
+    clear();
+    const std::uint8_t * p = p_;
+    std::uint32_t n = 0;
+    if ( not get_varint( p, end_, n ) or std::uint32_t( end_ - p ) < n ) return false;
+    code.assign( p, p + n );
+    p += n;
+    if ( not get_varint( p, end_, n ) or std::uint32_t( end_ - p ) < n ) return false;
+    sites.resize( n );
+    for ( auto & site : sites )
+    {
+        std::uint32_t column = 0;
+        if ( not get_varint( p, end_, column ) ) return false;
+        site.column = column;
+    }
+    if ( not get_varint( p, end_, n ) or std::uint32_t( end_ - p ) < n ) return false;
+    literals.assign( reinterpret_cast< const char * >( p ), n );
+    p += n;
+
+    // Runs the code "dry", as the emit_*() calls that produced it would have counted.
+    size_type next_site = 0;
+    for ( size_type i{0} ; i < code.size() ; )
+    {
+        auto op = code[ i ];
+        size_type operands = op == OP_PUSH ? 2 : ( op == OP_PUSH64 or op == OP_LITERAL ) ? 8 : 0;
+        if ( op > OP_LITERAL or op == OP_LOAD or code.size() - i - 1 < operands ) return false;
+        if ( op == OP_LITERAL )
+        {
+            const std::uint8_t * operand = &code[ i + 1 ];
+            std::uint32_t offset = operand[0] | operand[1] << 8 | operand[2] << 16 | std::uint32_t( operand[3] ) << 24;
+            std::uint32_t length = operand[4] | operand[5] << 8 | operand[6] << 16 | std::uint32_t( operand[7] ) << 24;
+            if ( offset > literals.size() or length > literals.size() - offset ) return false;
+            auto digits = std::string_view( literals ).substr( offset, length );
+            auto first = digits.find_first_not_of( '-' );
+            if ( first > 1 or first == digits.size() or
+                 digits.find_first_not_of( "0123456789", first ) != std::string_view::npos or
+                 not constant_fits( digits, width_ ) )
+                return false;
+        }
+        if ( op == OP_PUSH64 and not constant_fits( read_int64( &code[ i + 1 ] ), width_ ) ) return false;
+        if ( operands != 0 )
+        {
+            if ( ++depth > max_depth ) max_depth = depth;
+        }
+        else
+        {
+            if ( depth < 2 or next_site == sites.size() ) return false;
+            sites[ next_site++ ].offset = i;
+            --depth;
+        }
+        i += 1 + operands;
+    }
+    if ( depth != 1 or next_site != sites.size() ) return false;
+
+    p_ = p;
+    return true;
+}
+
+/// Prints the program in postfix notation.
+std::ostream & operator<<( std::ostream & os_, const Program & p_ )
+{
+    const char symbols[] = "?+-*/%^";
+    const auto & code = p_.code;
+    for ( std::size_t i{0} ; i < code.size() ; ++i )
+    {
+        if ( i != 0 ) os_ << " ";
+        if ( code[i] == Program::OP_PUSH )
+        {
+            os_ << static_cast< Program::immediate_type >( code[i+1] | ( code[i+2] << 8 ) );
+            i += 2;
+        }
+        else if ( code[i] == Program::OP_LOAD )
+        {
+            os_ << '$' << ( code[i+1] | ( code[i+2] << 8 ) );
+            i += 2;
+        }
+        else if ( code[i] == Program::OP_PUSH64 )
+        {
+            os_ << read_int64( &code[i+1] );
+            i += 8;
+        }
+        else if ( code[i] == Program::OP_LITERAL )
+        {
+            os_ << p_.get_literal( &code[i+1] );
+            i += 8;
+        }
+        else os_ << symbols[ code[i] ];
+    }
+    return os_;
+}
+
+//=== VM.
+
+/// Decodes the digits of an `OP_LITERAL` (the parser only emits, and Program::load() only takes, the ones that fit in `T`).
+template < typename T >
+static void decode_literal( std::string_view digits_, T & r_ )
+{
+    static_assert( std::is_integral< T >::value or sizeof( T ) == 16, "a built in integer" );
+    bool negative = digits_[0] == '-';
+    T value = 0;
+    for ( auto c : digits_.substr( negative ) )
+        value = value * 10 - ( c - '0' ); // The negative range is the larger one.
+    r_ = negative ? value : -value;
+}
+
+/// Decodes the digits of an `OP_LITERAL` of any size.
+static void decode_literal( std::string_view digits_, BigInt & r_ )
+{
+    BigInt::parse( digits_, r_ );
+}
+
+/// The result of an operation that failed at the instruction just before `pc_`.
+template < typename T >
+typename BasicVM< T >::ResultType
+BasicVM< T >::fail( const Program & program_, const std::uint8_t * pc_, arithmetic::error_t error_ ) const
+{
+    auto offset = static_cast< Program::size_type >( pc_ - 1 - program_.get_code().data() );
+    return ResultType( static_cast< typename ResultType::code_t >( error_ ), 0, program_.get_column( offset ) );
+}
+
+/*!
+ * Runs the program.
+ *
+ * Every operation is checked (see arithmetic.h): the first one that fails stops the program,
+ * and its error comes back with the column of its operator.
+ *
+ * @param program_ a program emitted by the Parser.
+ * @param variables_ the values of the variables (at least `program_.get_n_variables()` of them).
+ * @return the value of the expression, or the error of the first operation that failed.
+ */
+template < typename T >
+typename BasicVM< T >::ResultType
+BasicVM< T >::run( const Program & program_, const value_type * variables_ )
+{
+    if ( program_.empty() ) return ResultType( ResultType::OK );
+
+    value_type * sp = stack.data(); // Points to the next free position.
+    if ( program_.get_max_depth() > STACK_SIZE )
+    {
+        large_stack.resize( program_.get_max_depth() );
+        sp = large_stack.data();
+    }
+    value_type * const base = sp;
+
+    const auto & code = program_.get_code();
+    const std::uint8_t * pc = code.data();
+    const std::uint8_t * const end = pc + code.size();
+
+    // Applies a checked operation to the two values on top of the stack.
+#define BINARY( operation ) \
+    --sp; \
+    if ( auto error = arithmetic::operation( sp[-1], sp[0], sp[-1] ) ) \
+        return fail( program_, pc, error ); \
+    break
+
+    while ( pc != end )
+    {
+        switch( *pc++ )
+        {
+            case Program::OP_PUSH:
+                *sp++ = static_cast< Program::immediate_type >( pc[0] | ( pc[1] << 8 ) );
+                pc += 2;
+                break;
+            case Program::OP_ADD: BINARY( add );
+            case Program::OP_SUB: BINARY( sub );
+            case Program::OP_MUL: BINARY( mul );
+            case Program::OP_DIV: BINARY( div );
+            case Program::OP_MOD: BINARY( mod );
+            case Program::OP_POW: BINARY( pow );
+            case Program::OP_LOAD:
+                *sp++ = variables_[ pc[0] | ( pc[1] << 8 ) ];
+                pc += 2;
+                break;
+            case Program::OP_PUSH64:
+                // Only emitted for constants that fit in `T`.
+                *sp++ = static_cast< long long >( read_int64( pc ) );
+                pc += 8;
+                break;
+            case Program::OP_LITERAL:
+                decode_literal( program_.get_literal( pc ), *sp++ );
+                pc += 8;
+                break;
+        }
+    }
+#undef BINARY
+
+    return ResultType( ResultType::OK, *base );
+}
+
+template class BasicVM< long >;
+template class BasicVM< std::int32_t >;
+template class BasicVM< __int128 >;
+template class BasicVM< BigInt >;
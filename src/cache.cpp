@@ -0,0 +1,134 @@
+#include "../include/cache.h"
+#include <iterator> // std::prev
+#include <utility>  // std::move
+
+/// Checks whether `c_` is a white space, as far as the parser is concerned.
+static bool is_ws( char c_ )
+{ return c_ == ' ' or c_ == '\t'; }
+
+/// Writes the key of `e_` into `key_`: every run of white spaces becomes a single blank.
+static void normalize( std::string_view e_, std::string & key_ )
+{
+    key_.clear();
+    bool in_ws = false;
+    for ( auto c : e_ )
+    {
+        if ( is_ws( c ) )
+        {
+            if ( not in_ws ) key_ += ' ';
+            in_ws = true;
+        }
+        else
+        {
+            key_ += c;
+            in_ws = false;
+        }
+    }
+}
+
+/// Translates a column of `e_` into the corresponding column of its key.
+static OutcomeCache::size_type to_key_column( std::string_view e_, OutcomeCache::size_type col_ )
+{
+    OutcomeCache::size_type k{0};
+    for ( OutcomeCache::size_type i{0} ; i < col_ and i < e_.size() ; ++i )
+        if ( not is_ws( e_[i] ) or i == 0 or not is_ws( e_[i-1] ) ) ++k;
+    return k;
+}
+
+/// Translates a column of the key of `e_` back into the corresponding column of `e_`.
+/*!
+ * A column inside a run of white spaces is mapped to the first character of the run,
+ * which is where the parser stops after consuming the symbol before the run.
+ */
+static OutcomeCache::size_type to_source_column( std::string_view e_, OutcomeCache::size_type col_ )
+{
+    OutcomeCache::size_type k{0};
+    for ( OutcomeCache::size_type i{0} ; i < e_.size() ; ++i )
+    {
+        if ( not is_ws( e_[i] ) or i == 0 or not is_ws( e_[i-1] ) )
+        {
+            if ( k == col_ ) return i;
+            ++k;
+        }
+    }
+    return e_.size();
+}
+
+/// @param capacity_ the maximum number of outcomes kept (at least one).
+OutcomeCache::OutcomeCache( size_type capacity_ )
+    : capacity( capacity_ == 0 ? 1 : capacity_ )
+{
+    index.reserve( capacity );
+}
+
+/*!
+ * Looks up an expression. On a miss, the key is kept so that the outcome may be stored
+ * with insert() once the expression has been evaluated.
+ *
+ * @param e_ the expression.
+ * @param outcome_ receives the outcome, with its columns relative to `e_`, on a hit.
+ * @return true on a hit; false otherwise.
+ */
+bool OutcomeCache::find( std::string_view e_, Outcome & outcome_ )
+{
+    normalize( e_, key );
+    source = e_;
+
+    auto it = index.find( key );
+    if ( it == index.end() )
+    {
+        ++n_misses;
+        return false;
+    }
+
+    ++n_hits;
+    // Most recently used goes to the front.
+    entries.splice( entries.begin(), entries, it->second );
+    outcome_ = it->second->outcome;
+    if ( outcome_.status == Outcome::PARSE_ERROR )
+        outcome_.parse_result.at_col = to_source_column( e_, outcome_.parse_result.at_col );
+    else if ( outcome_.status != Outcome::OK )
+        outcome_.at_col = to_source_column( e_, outcome_.at_col );
+    return true;
+}
+
+/*!
+ * Stores the outcome of the expression of the last (failed) lookup, evicting the least
+ * recently used outcome when the cache is full.
+ *
+ * @param outcome_ the outcome, with its columns relative to the expression looked up.
+ */
+void OutcomeCache::insert( const Outcome & outcome_ )
+{
+    if ( index.find( key ) != index.end() ) return;
+
+    decltype( index )::node_type node;
+    if ( index.size() == capacity )
+    {
+        // Reuse the oldest entry (and the memory of its key), as well as its node in the
+        // index, so that a full cache does not allocate.
+        node = index.extract( entries.back().key );
+        entries.splice( entries.begin(), entries, std::prev( entries.end() ) );
+        entries.front().key = key;
+    }
+    else
+    {
+        entries.push_front( Entry{ key, outcome_ } );
+    }
+
+    auto & entry = entries.front();
+    entry.outcome = outcome_;
+    if ( entry.outcome.status == Outcome::PARSE_ERROR )
+        entry.outcome.parse_result.at_col = to_key_column( source, entry.outcome.parse_result.at_col );
+    else if ( entry.outcome.status != Outcome::OK )
+        entry.outcome.at_col = to_key_column( source, entry.outcome.at_col );
+
+    if ( node.empty() )
+    {
+        index.emplace( entry.key, entries.begin() );
+        return;
+    }
+    node.key() = entry.key;
+    node.mapped() = entries.begin();
+    index.insert( std::move( node ) );
+}
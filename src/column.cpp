@@ -0,0 +1,293 @@
+#include "../include/column.h"
+#include <cmath>    // std::fabs
+#include <cstring>  // std::memcpy, std::strcmp
+#include <cstdlib>  // std::getenv
+#include <algorithm> // std::fill, std::min
+
+#include "../include/simd.h" // BARES_X86_64
+
+namespace {
+
+typedef ColumnVM::value_type value_type;
+typedef unsigned long uvalue_type; // Wraps around instead of overflowing, as the VM does in practice.
+// The kernels work on the bits of a `double` (EXACT, MAGIC_BITS, the sign in bit 63).
+static_assert( sizeof( value_type ) == 8 and sizeof( uvalue_type ) == 8, "the column VM needs 64-bit values" );
+
+/// Flags of a lane (row of the block).
+enum : std::uint8_t {
+    LANE_HARD = 1  //!< Some instruction must be redone by the scalar VM (which also reports the errors).
+};
+
+/// Magnitudes below this go through a `double` exactly (and so do their quotients).
+constexpr value_type EXACT = value_type( 1 ) << 51;
+/// 1.5 * 2^52: adding it to an integer below 2^51 puts the integer in the low bits of the mantissa.
+constexpr double MAGIC = 6755399441055744.0;
+constexpr uvalue_type MAGIC_BITS = 0x4338000000000000UL;
+
+//=== Kernel bodies: each one goes once through `n_` lanes, with no branches (conditions
+//    become all-ones/zero masks). They are instantiated once per target below.
+
+#define KERNEL static inline __attribute__((always_inline))
+
+/// Checks whether |x_| < EXACT, with a single compare.
+KERNEL bool exact( value_type x_ )
+{ return uvalue_type( x_ ) + uvalue_type( EXACT ) < uvalue_type( 2 * EXACT ); }
+
+/// Converts an integer below EXACT into a double (plain conversions do not vectorize before AVX-512).
+KERNEL double to_double( value_type x_ )
+{
+    uvalue_type bits = uvalue_type( x_ ) + MAGIC_BITS;
+    double d;
+    std::memcpy( &d, &bits, sizeof( d ) );
+    return d - MAGIC;
+}
+
+/// `mask_` (all ones or zero) ? `x_` : `y_`, on the bits.
+KERNEL double select( uvalue_type mask_, double x_, double y_ )
+{
+    uvalue_type x, y;
+    std::memcpy( &x, &x_, sizeof( x ) );
+    std::memcpy( &y, &y_, sizeof( y ) );
+    x = ( x & mask_ ) | ( y & ~mask_ );
+    std::memcpy( &x_, &x, sizeof( x ) );
+    return x_;
+}
+
+/*!
+ * Truncated quotient of two integers below EXACT (the divisor is not zero).  The quotient of
+ * the doubles is rounded to the nearest integer (adding MAGIC), and then moved one step
+ * toward zero if that was away from zero, which the sign of the remainder tells.
+ */
+KERNEL value_type quotient( value_type x_, value_type d_ )
+{
+    double q = to_double( x_ ) / to_double( d_ ) + MAGIC;
+    uvalue_type bits;
+    std::memcpy( &bits, &q, sizeof( bits ) );
+    value_type n = value_type( bits - MAGIC_BITS );
+
+    value_type rem = x_ - n * d_;
+    value_type away = -value_type( ( rem != 0 ) & ( ( rem ^ x_ ) < 0 ) ); // All ones or zero.
+    value_type step = ( ( x_ ^ d_ ) >> 63 ) | 1;                           // -1 or 1.
+    return n - ( step & away );
+}
+
+/// Magnitudes below this multiply without overflow.
+constexpr value_type SMALL = value_type( 1 ) << 31;
+
+/// Wrapping add; a lane whose signs show an overflow is hard.
+KERNEL void add_body( value_type * a_, const value_type * b_, std::uint8_t * f_, std::size_t n_ )
+{
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+    {
+        value_type r = value_type( uvalue_type( a_[i] ) + uvalue_type( b_[i] ) );
+        f_[i] |= std::uint8_t( ( ( a_[i] ^ r ) & ( b_[i] ^ r ) ) < 0 ) * LANE_HARD;
+        a_[i] = r;
+    }
+}
+
+/// Wrapping subtract, likewise.
+KERNEL void sub_body( value_type * a_, const value_type * b_, std::uint8_t * f_, std::size_t n_ )
+{
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+    {
+        value_type r = value_type( uvalue_type( a_[i] ) - uvalue_type( b_[i] ) );
+        f_[i] |= std::uint8_t( ( ( a_[i] ^ b_[i] ) & ( a_[i] ^ r ) ) < 0 ) * LANE_HARD;
+        a_[i] = r;
+    }
+}
+
+/// Wrapping multiply; a lane with a factor of 2^31 or more is hard (it might have overflowed).
+KERNEL void mul_body( value_type * a_, const value_type * b_, std::uint8_t * f_, std::size_t n_ )
+{
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+    {
+        bool big = ( uvalue_type( a_[i] ) + uvalue_type( SMALL ) >= uvalue_type( 2 * SMALL ) ) |
+                   ( uvalue_type( b_[i] ) + uvalue_type( SMALL ) >= uvalue_type( 2 * SMALL ) );
+        f_[i] |= std::uint8_t( big ) * LANE_HARD;
+        a_[i] = value_type( uvalue_type( a_[i] ) * uvalue_type( b_[i] ) );
+    }
+}
+
+/*!
+ * Lanes whose divisor is zero, or whose operands are not exact, are divided by one instead
+ * (and flagged).  Everything is done with masks: no short circuits nor selects the compiler
+ * could turn back into branches, so that the loop can be vectorized.
+ */
+KERNEL void checked_operands( value_type & x_, value_type & d_, std::uint8_t & f_ )
+{
+    value_type hard = -value_type( d_ == 0 ) | -value_type( not exact( x_ ) ) | -value_type( not exact( d_ ) );
+    x_ &= ~hard;
+    d_ = ( d_ & ~hard ) | ( hard & 1 );
+    f_ |= std::uint8_t( hard & LANE_HARD );
+}
+
+/// Truncated division through a `double`, exact while both operands are below EXACT.
+KERNEL void div_body( value_type * a_, const value_type * b_, std::uint8_t * f_, std::size_t n_ )
+{
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+    {
+        value_type x = a_[i], d = b_[i];
+        checked_operands( x, d, f_[i] );
+        a_[i] = quotient( x, d );
+    }
+}
+
+/// Remainder of the truncated division above.
+KERNEL void mod_body( value_type * a_, const value_type * b_, std::uint8_t * f_, std::size_t n_ )
+{
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+    {
+        value_type x = a_[i], d = b_[i];
+        checked_operands( x, d, f_[i] );
+        a_[i] = x - quotient( x, d ) * d;
+    }
+}
+
+/*!
+ * Integer power by squaring, for exponents in [0,63].  A `double` shadow of the result tells
+ * whether it stays below EXACT, where the product cannot have wrapped.  Lanes with an
+ * exponent outside [0,63], or a result of EXACT or more, are flagged and left to the
+ * checked scalar VM (arithmetic::pow).
+ */
+KERNEL void pow_body( value_type * a_, const value_type * b_, std::uint8_t * f_, std::size_t n_ )
+{
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+    {
+        value_type hard = -value_type( ( uvalue_type( b_[i] ) > 63 ) | not exact( a_[i] ) );
+        uvalue_type e = b_[i] & ~hard;
+        uvalue_type base = a_[i], r = 1;
+        double base_d = to_double( a_[i] & ~hard ), r_d = 1.0;
+#pragma GCC unroll 6
+        for ( int k{0} ; k < 6 ; ++k )
+        {
+            uvalue_type bit = -( ( e >> k ) & 1 );
+            r = ( ( r * base ) & bit ) | ( r & ~bit );
+            r_d = select( bit, r_d * base_d, r_d );
+            base *= base;
+            base_d *= base_d;
+        }
+        hard |= -value_type( not ( std::fabs( r_d ) < double( EXACT ) ) );
+        a_[i] = value_type( r );
+        f_[i] |= std::uint8_t( hard & LANE_HARD );
+    }
+}
+
+/// A kernel: `a_[i] = a_[i] op b_[i]` for `n_` lanes, flagging lanes in `f_`.
+typedef void (*kernel_t)( value_type * a_, const value_type * b_, std::uint8_t * f_, std::size_t n_ );
+
+/// A set of kernels, indexed by opcode (OP_ADD .. OP_POW).
+struct Kernels
+{
+    kernel_t op[ Program::OP_POW + 1 ];
+    const char * name;
+};
+
+#define DEFINE_KERNELS( suffix, attr ) \
+    attr void add_##suffix( value_type * a, const value_type * b, std::uint8_t * f, std::size_t n ) { add_body( a, b, f, n ); } \
+    attr void sub_##suffix( value_type * a, const value_type * b, std::uint8_t * f, std::size_t n ) { sub_body( a, b, f, n ); } \
+    attr void mul_##suffix( value_type * a, const value_type * b, std::uint8_t * f, std::size_t n ) { mul_body( a, b, f, n ); } \
+    attr void div_##suffix( value_type * a, const value_type * b, std::uint8_t * f, std::size_t n ) { div_body( a, b, f, n ); } \
+    attr void mod_##suffix( value_type * a, const value_type * b, std::uint8_t * f, std::size_t n ) { mod_body( a, b, f, n ); } \
+    attr void pow_##suffix( value_type * a, const value_type * b, std::uint8_t * f, std::size_t n ) { pow_body( a, b, f, n ); }
+
+DEFINE_KERNELS( base, )
+#ifdef BARES_X86_64
+DEFINE_KERNELS( avx2, __attribute__((target("avx2"))) )
+#endif
+
+/// Picks AVX2 if the processor has it (and BARES_SIMD does not ask for "sse2" or "scalar").
+Kernels select_kernels( void )
+{
+#ifdef BARES_X86_64
+    const Kernels base{ { nullptr, add_base, sub_base, mul_base, div_base, mod_base, pow_base }, "sse2" };
+    const Kernels avx2{ { nullptr, add_avx2, sub_avx2, mul_avx2, div_avx2, mod_avx2, pow_avx2 }, "avx2" };
+
+    const char * wanted = std::getenv( "BARES_SIMD" );
+    if ( wanted != nullptr and ( std::strcmp( wanted, "sse2" ) == 0 or std::strcmp( wanted, "scalar" ) == 0 ) )
+        return base;
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) ? avx2 : base;
+#else
+    return Kernels{ { nullptr, add_base, sub_base, mul_base, div_base, mod_base, pow_base }, "scalar" };
+#endif
+}
+
+const Kernels kernels = select_kernels();
+
+} // namespace
+
+const char * ColumnVM::name( void )
+{
+    return kernels.name;
+}
+
+/*!
+ * Evaluates the program for every row.
+ *
+ * @param program_ a program emitted by the Parser (with variables turned on).
+ * @param columns_ one array of `n_rows_` values per variable of the program.
+ * @param n_rows_ number of rows.
+ * @param results_ receives the result of each row, the same VM::run() would give.
+ */
+void ColumnVM::run( const Program & program_, const value_type * const * columns_, size_type n_rows_,
+                    VM::ResultType * results_ )
+{
+    stack.resize( ( program_.get_max_depth() + 1 ) * BLOCK );
+    flags.resize( BLOCK );
+    row.resize( program_.get_n_variables() );
+
+    for ( size_type first{0} ; first < n_rows_ ; first += BLOCK )
+        run_block( program_, columns_, first, std::min( BLOCK, n_rows_ - first ), results_ + first );
+}
+
+/// Runs rows [first_, first_+n_) together.
+void ColumnVM::run_block( const Program & program_, const value_type * const * columns_, size_type first_,
+                          size_type n_, VM::ResultType * results_ )
+{
+    if ( program_.empty() )
+    {
+        for ( size_type i{0} ; i < n_ ; ++i ) results_[i] = VM::ResultType( VM::ResultType::OK );
+        return;
+    }
+
+    value_type * sp = stack.data(); // Next free slot.
+    std::fill( flags.begin(), flags.begin() + n_, 0 );
+
+    const auto & code = program_.get_code();
+    const std::uint8_t * pc = code.data();
+    const std::uint8_t * const end = pc + code.size();
+    while ( pc != end )
+    {
+        auto op = *pc++;
+        if ( op == Program::OP_PUSH )
+        {
+            value_type v = static_cast< Program::immediate_type >( pc[0] | ( pc[1] << 8 ) );
+            std::fill( sp, sp + n_, v );
+            sp += BLOCK;
+            pc += 2;
+        }
+        else if ( op == Program::OP_LOAD )
+        {
+            std::memcpy( sp, columns_[ pc[0] | ( pc[1] << 8 ) ] + first_, n_ * sizeof( value_type ) );
+            sp += BLOCK;
+            pc += 2;
+        }
+        else
+        {
+            sp -= BLOCK;
+            kernels.op[ op ]( sp - BLOCK, sp, flags.data(), n_ );
+        }
+    }
+
+    const value_type * top = stack.data();
+    for ( size_type i{0} ; i < n_ ; ++i )
+    {
+        if ( flags[i] & LANE_HARD )
+        {
+            // Once more, slowly.
+            for ( size_type v{0} ; v < row.size() ; ++v ) row[v] = columns_[v][ first_ + i ];
+            results_[i] = vm.run( program_, row.data() );
+        }
+        else results_[i] = VM::ResultType( VM::ResultType::OK, top[i] );
+    }
+}
@@ -0,0 +1,272 @@
+#include "../include/compiled.h"
+#include "../include/evaluator.h"
+#include "../include/stats.h"
+#include "../include/bigint.h"
+#include <cstring>    // std::memcmp
+#include <cstdlib>    // mkstemp
+#include <cstdio>     // std::rename
+#include <cerrno>     // errno
+#include <fcntl.h>    // open
+#include <unistd.h>   // write, close, unlink
+#include <sys/mman.h> // mmap, madvise
+#include <sys/stat.h> // fstat
+#include <type_traits> // std::is_same
+
+/// Appends the `n_` low bytes of `v_` to `out_` (little endian).
+static void put_bytes( std::string & out_, std::uint64_t v_, int n_ )
+{
+    for ( int i{0} ; i < n_ ; ++i, v_ >>= 8 )
+        out_ += static_cast< char >( v_ & 0xFF );
+}
+
+/// Reads `n_` bytes (little endian) at `p_`.
+static std::uint64_t get_bytes( const std::uint8_t * p_, int n_ )
+{
+    std::uint64_t v = 0;
+    for ( int i = n_ ; i-- > 0 ; )
+        v = v << 8 | p_[i];
+    return v;
+}
+
+/// Writes all of `data_` to `fd_`. Returns false (with errno set) if it cannot.
+static bool write_all( int fd_, std::string_view data_ )
+{
+    while ( not data_.empty() )
+    {
+        auto n = ::write( fd_, data_.data(), data_.size() );
+        if ( n < 0 and errno == EINTR ) continue;
+        if ( n <= 0 ) return false;
+        data_.remove_prefix( n );
+    }
+    return true;
+}
+
+/*!
+ * Parses every line once, as the Evaluator would, and writes the file described in
+ * compiled.h.  The file is written in blocks of BLOCK_SIZE bytes, to a temporary file
+ * next to `path_` that replaces it (rename()) only once it is complete: a failure leaves
+ * no partial file behind, and an existing `path_` untouched.  The input may be mapped,
+ * so `path_` must not be the input itself.
+ *
+ * @param reader_ the source of the expressions.
+ * @param path_ the file to create (or replace); not the file `reader_` reads.
+ * @param width_ width of the constants (see Parser::set_width()).
+ * @param max_depth_ maximum nesting of parentheses (see Parser::set_max_depth()).
+ * @return true if the whole file was written; false otherwise, with errno set.
+ */
+bool CompiledFile::compile( LineReader & reader_, const char * path_, grammar::width_t width_,
+                            Parser::size_type max_depth_ )
+{
+    struct stat input, output;
+    if ( ::fstat( reader_.get_fd(), &input ) == 0 and ::stat( path_, &output ) == 0 and
+         input.st_dev == output.st_dev and input.st_ino == output.st_ino )
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    std::string temp = std::string( path_ ) + ".XXXXXX";
+    int fd = ::mkstemp( temp.data() );
+    if ( fd < 0 ) return false;
+    // mkstemp() creates it 0600; give it the mode open( path_, ..., 0644 ) would have.
+    mode_t mask = ::umask( 0 );
+    ::umask( mask );
+    ::fchmod( fd, 0644 & ~mask );
+
+    Parser parser;
+    parser.set_keep_tokens( false );
+    parser.set_max_depth( max_depth_ );
+    parser.set_width( width_ );
+
+    std::string out( MAGIC );
+    out.reserve( BLOCK_SIZE + 4096 );
+    put_bytes( out, VERSION, 4 );
+    put_bytes( out, static_cast< std::uint8_t >( width_ ), 4 );
+
+    bool ok = true;
+    std::uint64_t n_lines = 0;
+    std::string_view line;
+    while ( ok and reader_.next( line ) )
+    {
+        auto result = parser.parse( line );
+        put_bytes( out, line.size(), 4 );
+        out += line;
+        put_bytes( out, result.type, 1 );
+        if ( result.type == Parser::ResultType::OK ) parser.get_program().save( out );
+        else put_bytes( out, result.at_col, 4 );
+        ++n_lines;
+
+        if ( out.size() >= BLOCK_SIZE )
+        {
+            ok = write_all( fd, out );
+            out.clear();
+        }
+    }
+    put_bytes( out, n_lines, 8 );
+    ok = ok and write_all( fd, out );
+
+    // Preserva o errno do erro de escrita, se houve um.
+    int error = ok ? 0 : errno;
+    ok = ( ::close( fd ) == 0 ) and ok;
+    ok = ok and std::rename( temp.c_str(), path_ ) == 0;
+    if ( not ok )
+    {
+        if ( error == 0 ) error = errno; // close() or rename().
+        ::unlink( temp.c_str() );        // Nada de arquivo pela metade.
+        errno = error;
+    }
+    return ok;
+}
+
+/*!
+ * Maps the file and checks its header and trailer.  A file that does not start with
+ * `MAGIC` is left alone (is_open() is false: it is probably a text file); one that does,
+ * but is too short or of another version, is open and damaged.
+ *
+ * @param path_ the path of the file.
+ */
+CompiledFile::CompiledFile( const char * path_ )
+{
+    int fd = ::open( path_, O_RDONLY );
+    if ( fd < 0 ) return;
+
+    struct stat info;
+    if ( ::fstat( fd, &info ) == 0 and S_ISREG( info.st_mode ) and
+         static_cast< size_type >( info.st_size ) >= MAGIC.size() )
+    {
+        void * addr = ::mmap( nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( addr != MAP_FAILED )
+        {
+            if ( std::memcmp( addr, MAGIC.data(), MAGIC.size() ) == 0 )
+            {
+                map_begin = static_cast< const std::uint8_t * >( addr );
+                map_size = info.st_size;
+                // We go through it only once, from start to end: let the kernel read ahead.
+                ::madvise( addr, map_size, MADV_SEQUENTIAL );
+            }
+            else ::munmap( addr, info.st_size );
+        }
+    }
+    ::close( fd ); // The mapping stays.
+    if ( map_begin == nullptr ) return;
+
+    damaged = map_size < HEADER_SIZE + TRAILER_SIZE or get_bytes( map_begin + 4, 4 ) != VERSION or
+              map_begin[8] > static_cast< std::uint8_t >( grammar::width_t::BIG );
+    if ( damaged ) return;
+    width = static_cast< grammar::width_t >( map_begin[8] );
+    pos = HEADER_SIZE;
+    records_end = map_size - TRAILER_SIZE;
+    n_lines = get_bytes( map_begin + records_end, 8 );
+}
+
+CompiledFile::~CompiledFile()
+{
+    if ( map_begin != nullptr )
+        ::munmap( const_cast< std::uint8_t * >( map_begin ), map_size );
+}
+
+/*!
+ * Gets the next line of the file.  Its program is copied into `program_` (which keeps its
+ * memory from one line to the next), and checked (see Program::load()).
+ *
+ * @param line_ receives the line; it points into the mapping.
+ * @param result_ receives the parsing result of the line.
+ * @param program_ receives the program of the line (when `result_` is OK).
+ * @return true if there was a line; false at the end of the file, or if it is damaged.
+ */
+bool CompiledFile::next( std::string_view & line_, Parser::ResultType & result_, Program & program_ )
+{
+    BARES_STAGE( READ );
+    if ( map_begin == nullptr or damaged ) return false;
+    if ( pos == records_end )
+    {
+        damaged = n_read != n_lines;
+        return false;
+    }
+
+    const std::uint8_t * p = map_begin + pos;
+    const std::uint8_t * const end = map_begin + records_end;
+    damaged = true; // Até que o registro inteiro seja lido.
+    if ( end - p < 4 ) return false;
+    size_type size = get_bytes( p, 4 );
+    p += 4;
+    if ( size_type( end - p ) < size + 1 ) return false;
+    line_ = std::string_view( reinterpret_cast< const char * >( p ), size );
+    p += size;
+
+    auto code = static_cast< Parser::ResultType::code_t >( *p++ );
+    if ( code == Parser::ResultType::OK )
+    {
+        if ( not program_.load( p, end, width ) ) return false;
+        result_ = Parser::ResultType();
+    }
+    else
+    {
+        if ( code > Parser::ResultType::NESTING_TOO_DEEP or end - p < 4 ) return false;
+        result_ = Parser::ResultType( code, get_bytes( p, 4 ) );
+        p += 4;
+    }
+
+    pos = p - map_begin;
+    ++n_read;
+    damaged = false;
+    return true;
+}
+
+/*!
+ * Each line is reported exactly as `bares` reports it from the source: the lines that
+ * did not parse with their error, the others with the outcome of their program.
+ *
+ * @param writer_ where the reports go.
+ * @return false if the file turned out to be damaged (the lines before the damage are reported).
+ */
+bool CompiledFile::run( OutputWriter & writer_ )
+{
+    switch ( width )
+    {
+        case grammar::width_t::W16:
+            run_as< VM::value_type >( writer_, []( const VM::ResultType & exec_, const Program & program_ ) {
+                return make_outcome( exec_, program_ );
+            });
+            break;
+        case grammar::width_t::W32:  run_as< std::int32_t >( writer_, nullptr ); break;
+        case grammar::width_t::W64:  run_as< long >( writer_, nullptr ); break;
+        case grammar::width_t::W128: run_as< __int128 >( writer_, nullptr ); break;
+        case grammar::width_t::BIG:  run_as< BigInt >( writer_, nullptr ); break;
+    }
+    return not damaged;
+}
+
+/*!
+ * @param writer_ where the reports go.
+ * @param finish_ turns the result of the VM into the outcome (make_wide_outcome() if it is nullptr).
+ */
+template < typename T, typename Finish >
+void CompiledFile::run_as( OutputWriter & writer_, Finish finish_ )
+{
+    BasicVM< T > vm;
+    Program program;
+    Parser::ResultType result;
+    std::string_view line;
+    while ( next( line, result, program ) )
+    {
+        BARES_COUNT( LINES, 1 );
+        BARES_COUNT( BYTES, line.size() );
+
+        BasicOutcome< T > outcome( BasicOutcome< T >::PARSE_ERROR, 0, result );
+        if ( result.type == Parser::ResultType::OK )
+        {
+            typename BasicVM< T >::ResultType exec;
+            {
+                BARES_STAGE( EVAL );
+                exec = vm.run( program );
+            }
+            if constexpr ( std::is_same< Finish, std::nullptr_t >::value )
+                outcome = make_wide_outcome< T >( exec );
+            else
+                outcome = finish_( exec, program );
+        }
+        BARES_COUNT_OUTCOME( outcome );
+        writer_.write( line, outcome );
+    }
+}
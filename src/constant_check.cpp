@@ -0,0 +1,31 @@
+#include "../include/constant.h"
+
+/*!
+ * constant.h is only a header: this file makes every build compile it, and checks that
+ * its outcomes and columns are the ones the Evaluator gives at run time.  Nothing here
+ * ends up in the program.
+ */
+namespace {
+
+using constant::evaluate;
+typedef Parser::ResultType ParseResult;
+
+static_assert( BARES_CONSTANT( "2 ^ 15 - 1" ) == 32767 );
+
+constexpr auto missing_closing = evaluate( "(1 + 2" );
+static_assert( missing_closing.status == Outcome::PARSE_ERROR and
+               missing_closing.code == ParseResult::MISSING_CLOSING and missing_closing.column == 6 );
+
+// A coluna -1 do Parser é reportada como 0.
+constexpr auto ill_formed = evaluate( "a+1" );
+static_assert( ill_formed.status == Outcome::PARSE_ERROR and
+               ill_formed.code == ParseResult::ILL_FORMED_INTEGER and ill_formed.column == 0 );
+
+constexpr auto out_of_range = evaluate( "-32769" );
+static_assert( out_of_range.status == Outcome::PARSE_ERROR and
+               out_of_range.code == ParseResult::INTEGER_OUT_OF_RANGE );
+
+constexpr auto overflow = evaluate( "2^31" );
+static_assert( overflow.status == Outcome::NUMERIC_OVERFLOW and overflow.column == 1 );
+
+} // namespace
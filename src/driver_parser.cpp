@@ -1,308 +1,683 @@
 #include <iostream>
-#include <iomanip>
-#include <iterator>
-#include <vector>
-#include <stack>     // stack
 #include <string>    // string
-#include <cassert>   // assert
-#include <cmath>     // pow
-#include <stdexcept> // std::runtime_error
+#include <stdexcept> // std::invalid_argument
+#include <cstring>   // std::strerror
+#include <cerrno>    // errno
+#include <cctype>    // std::isdigit
+#include <limits>    // std::numeric_limits
+#include <unistd.h>  // isatty
+#include <thread>    // std::thread::hardware_concurrency
 
 #include "../include/parser.h"
 
-std::vector<std::string> expressions;
+#include "../include/evaluator.h"
+#include "../include/report.h"
+#include "../include/writer.h"
+#include "../include/batch.h"
+#include "../include/cache.h"
+#include "../include/stats.h"
+#include "../include/formula.h"
+#include "../include/server.h"
+#include "../include/repl.h"
+#include "../include/bigint.h"
+#include "../include/compiled.h"
+#include "../include/split.h"
+#include "../include/aggregate.h"
+#include "../include/follow.h"
+
+/// Prints how the program should be called.
+void usage( const char * name )
+{
+    std::cout << "Usage: " << name << " [options] [<input_file>|-]\n"
+              << "       " << name << " compile [--width W] [--max-depth N] <input_file>|- -o <output_file>\n"
+              << "  Without an input file (or with \"-\") the expressions are read from the standard input;\n"
+              << "  on a terminal, without an input file, an interactive prompt evaluates them as they are typed.\n"
+              << "  \"compile\" parses the input once and writes the programs to the output file; given as the\n"
+              << "  input file, that file is then evaluated (with the width it was compiled with) without parsing.\n"
+              << "Options:\n"
+              << "  --jobs N          evaluate with N worker threads (default: 1).\n"
+              << "  --split           evaluate each line of at least " << SplitEvaluator< long >::MIN_SPLIT_SIZE
+              << " bytes in pieces, on N threads (--jobs;\n"
+              << "                    default: one per core), split at its operators outside of parentheses.\n"
+              << "  --aggregate[=json] instead of a report per line, print the counts of valid and invalid lines,\n"
+              << "                    the sum, smallest and largest of the results and the count of each error.\n"
+              << "  --quantiles Q,... with --aggregate, also the (approximate) quantiles Q of the results (e.g. 0.5,0.99).\n"
+              << "  --format F        either \"human\" (default) or \"compact\" (one result or ERROR,column per line).\n"
+              << "  --flush-size N    write the output in blocks of N bytes (default: "
+              << OutputWriter::FLUSH_SIZE << "; 0 writes every result).\n"
+              << "  --cache N         remember the outcomes of the last N distinct expressions (per thread).\n"
+              << "  --formula E       evaluate the expression E, with variables, once per input line; each line\n"
+              << "                    holds the values of the variables (in order of appearance in E).\n"
+              << "  --jit             with --formula, translate E into native code (x86-64 only).\n"
+              << "  --follow          keep evaluating the lines appended to the input file, as they come (until\n"
+              << "                    SIGINT or SIGTERM); the reports of every batch are written at once.\n"
+              << "  --offset N        with --follow, start at the byte N of the file (e.g. where it stopped before).\n"
+              << "  --serve PATH      answer the expressions sent over the Unix socket PATH, one line per\n"
+              << "                    expression, in the compact format (until SIGINT or SIGTERM).\n"
+              << "  --width W         constants and arithmetic of W bits: 16 (default: 16-bit constants, 64-bit\n"
+              << "                    arithmetic, an int result), 32, 64, 128 or \"big\" (any size); the widths\n"
+              << "                    other than 16 do not go with --jobs (but for --split), --cache, --formula\n"
+              << "                    or --serve.\n"
+              << "  --max-depth N     reject expressions with more than N nested parentheses (default: "
+              << Parser::DEFAULT_MAX_DEPTH << "; 0 for no limit).\n"
+              << "  --cache-stats     print the cache hits and misses to the standard error at the end.\n"
+              << "  --stats[=json]    print the time spent in each stage and the outcome counts to the standard\n"
+              << "                    error at the end (only in builds with statistics, see \"make stats\").\n";
+}
 
-void print_error_msg( const Parser::ResultType & result, std::string str )
+/// Evaluates every line of `reader_` with `evaluator_` and prints the statistics of their outcomes.
+template < typename T, typename E >
+void aggregate( E & evaluator_, const std::vector< double > & quantiles_, bool json_, LineReader & reader_ )
 {
-    std::string error_indicator( str.size()+1, ' ');
+    Aggregate< T > statistics( quantiles_ );
+    std::string_view expr;
+    while ( reader_.next( expr ) )
+        statistics.add( evaluator_.evaluate( expr ) );
+
+    std::string out;
+    statistics.print( out, json_ );
+    std::cout << out;
+}
 
-    // Have we got a parsing error?
-    error_indicator[result.at_col] = '^';
-    switch ( result.type )
+/// Aggregates the lines of `reader_` (see aggregate()), evaluated with the width `width_` and, if `n_jobs_` is not 0, split.
+template < typename T >
+void aggregate_wide( std::size_t n_jobs_, grammar::width_t width_, const EvaluatorConfig & config_,
+                     const std::vector< double > & quantiles_, bool json_, LineReader & reader_ )
+{
+    if ( n_jobs_ != 0 )
     {
-        case Parser::ResultType::UNEXPECTED_END_OF_EXPRESSION:
-            std::cout << ">>> Unexpected end of input at column (" << result.at_col << ")!\n";
-            break;
-        case Parser::ResultType::ILL_FORMED_INTEGER:
-            std::cout << ">>> Ill formed integer at column (" << result.at_col - 1<< ")!\n";
-            break;
-        case Parser::ResultType::MISSING_TERM:
-            std::cout << ">>> Missing <term> at column (" << result.at_col << ")!\n";
-            break;
-        case Parser::ResultType::EXTRANEOUS_SYMBOL:
-            std::cout << ">>> Extraneous symbol after valid expression found at column (" << result.at_col << ")!\n";
-            break;
-        case Parser::ResultType::INTEGER_OUT_OF_RANGE:
-            std::cout << ">>> Integer constant out of range beginning at column (" << result.at_col << ")!\n";
-            break;
-        case Parser::ResultType::MISSING_CLOSING:
-            std::cout << ">>> Missing closing ”)” at column (" << result.at_col << ")!\n";
-            break;
-        default:
-            std::cout << ">>> Unhandled error found!\n";
-            break;
+        SplitEvaluator< T > evaluator( n_jobs_, width_, config_ );
+        aggregate< T >( evaluator, quantiles_, json_, reader_ );
+    }
+    else
+    {
+        WideEvaluator< T > evaluator( width_, config_ );
+        aggregate< T >( evaluator, quantiles_, json_, reader_ );
     }
-
-    std::cout << "\"" << str << "\"\n";
-    std::cout << " " << error_indicator << std::endl;
 }
 
-//=== Aliases
-using value_type = long int; //!< Type we operate on.
-using symbol = char; //!< A symbol in this implementation is just a char.
-using comp = int;
-
-bool control = true;
-
-// Simple helper functions that identify the incoming symbol.
-
-bool is_operator( symbol s )
-{ return (s>='%' and s<='/') or (s=='^');}
-
-bool is_operand( symbol s )
-{ return s>='0' and s<='9'; }
-
-bool is_operator( comp s )
-{ return s == 1;}
-
-bool is_operand( comp s )
-{ return s == 0; }
-
-bool is_opening_scope( comp s )
-{ return s == 2 ; }
-
-bool is_opening_scope( symbol s )
-{ return s == '(' ; }
-
-bool is_closing_scope( comp s )
-{ return s == 3 ; }
+/// Evaluates and reports the lines appended to the file of `follower_`, one batch at a time, until SIGINT or SIGTERM.
+template < typename E >
+void follow( E & evaluator_, Follower & follower_, OutputWriter & writer_ )
+{
+    std::string_view expr;
+    while ( follower_.wait() )
+    {
+        while ( follower_.next( expr ) )
+            writer_.write( expr, evaluator_.evaluate( expr ) );
+        writer_.flush(); // Não esperamos o buffer encher: o resultado sai assim que fica pronto.
+        follower_.batch_done();
+    }
+}
 
-/// Converts a expression in infix notation to a corresponding profix representation.
-std::string infix_to_postfix( std::string );
+/// Follows (see follow()) with the width `width_` and, if `n_jobs_` is not 0, splitting the lines.
+template < typename T >
+void follow_wide( std::size_t n_jobs_, grammar::width_t width_, const EvaluatorConfig & config_,
+                  Follower & follower_, OutputWriter & writer_ )
+{
+    if ( n_jobs_ != 0 )
+    {
+        SplitEvaluator< T > evaluator( n_jobs_, width_, config_ );
+        follow( evaluator, follower_, writer_ );
+    }
+    else
+    {
+        WideEvaluator< T > evaluator( width_, config_ );
+        follow( evaluator, follower_, writer_ );
+    }
+}
 
-/// Converts a char (1-digit operand) into an integer.
-value_type char2integer( std::string c )
-{ return std::stoi(c); }
+/// Evaluates and reports every line of `reader_` with a SplitEvaluator of `n_jobs_` threads.
+template < typename T >
+void evaluate_split( std::size_t n_jobs_, grammar::width_t width_, const EvaluatorConfig & config_,
+                     LineReader & reader_, OutputWriter & writer_ )
+{
+    SplitEvaluator< T > evaluator( n_jobs_, width_, config_ );
+    std::string_view expr;
+    while ( reader_.next( expr ) )
+        writer_.write( expr, evaluator.evaluate( expr ) );
+}
 
-/// Check the operand's type of association.
-bool is_right_association( symbol op )
-{ return op == '^'; }
+/// Evaluates and reports every line of `reader_` with the width `width_`, whose values are `T`.
+template < typename T >
+void evaluate_wide( grammar::width_t width_, const EvaluatorConfig & config_, LineReader & reader_,
+                    OutputWriter & writer_ )
+{
+    WideEvaluator< T > evaluator( width_, config_ );
+    std::string_view expr;
+    while ( reader_.next( expr ) )
+        writer_.write( expr, evaluator.evaluate( expr ) );
+}
 
+/// What --stats asks for.
+enum stats_t { NO_STATS, TEXT_STATS, JSON_STATS };
 
-/// Change an infix expression into its corresponding postfix representation.
-value_type evaluate_postfix( std::string );
+/// Prints the statistics asked for with --stats (if any) to the standard error, at the end of a run.
+void finish_stats( stats_t stats_ )
+{
+    if ( stats_ == NO_STATS ) return;
+#ifdef BARES_STATS
+    Stats::print( std::cerr, stats_ == JSON_STATS );
+#else
+    std::cerr << ">>> Statistics are not available in this build (see \"make stats\").\n";
+#endif
+}
 
-/// Returns the precedence value (number) associated with an operator.
-short get_precedence( symbol op )
+/*!
+ * Matches the option `name_` given either as "name value" or as "name=value".
+ *
+ * @param argc number of arguments.
+ * @param argv the arguments.
+ * @param i index of the current argument; it is moved past the value, if needed.
+ * @param name_ the option name, with the dashes.
+ * @param value_ receives the value of the option.
+ * @return true if argv[i] is the option; false otherwise.
+ */
+bool get_option( int argc, char * argv[], int & i, const std::string & name_, std::string & value_ )
 {
-    switch( op )
+    std::string arg( argv[i] );
+    if ( arg == name_ and i+1 < argc )
     {
-        case '^': return 3;
-
-        case '*':
-        case '/':
-        case '%': return 2;
-
-        case '+':
-        case '-': return 1;
-
-        case '(': return 0;
-
-        default: assert(false);
+        value_ = argv[++i];
+        return true;
+    }
+    if ( arg.compare( 0, name_.size()+1, name_ + "=" ) == 0 )
+    {
+        value_ = arg.substr( name_.size()+1 );
+        return true;
     }
-    return -1;
+    return false;
 }
 
-/// Determines whether the first operator is >= than the second operator.
-bool has_higher_or_eq_precedence( symbol op1 , symbol op2 )
+/// Most worker threads --jobs takes.
+static constexpr std::size_t MAX_JOBS = 1024;
+/// Most outcomes --cache takes (the cache reserves room for all of them, per thread).
+static constexpr std::size_t MAX_CACHE = std::size_t( 1 ) << 24;
+/// Largest block --flush-size takes.
+static constexpr std::size_t MAX_FLUSH_SIZE = std::size_t( 1 ) << 30;
+
+/*!
+ * Reads the number given to an option: digits only (no sign, spaces or suffix), within
+ * [min_, max_].
+ *
+ * @param value_ the value of the option.
+ * @param min_ the smallest value accepted.
+ * @param max_ the largest value accepted.
+ * @return the number.
+ * @throw std::invalid_argument (or std::out_of_range) if `value_` is not such a number.
+ */
+std::size_t get_count( const std::string & value_, std::size_t min_,
+                       std::size_t max_=std::numeric_limits< std::size_t >::max() )
 {
-    return ( get_precedence(op1) >= get_precedence(op2) ) ?
-        is_right_association( op1 ) ? false : true  :
-        false;
+    // std::stoull() aceitaria espaços, um sinal ("-1" vira 2^64-1) e lixo no fim.
+    if ( value_.empty() or not std::isdigit( static_cast< unsigned char >( value_[0] ) ) )
+        throw std::invalid_argument( value_ );
+    std::size_t used;
+    auto n = std::stoull( value_, &used );
+    if ( used != value_.size() or n < min_ or n > max_ ) throw std::invalid_argument( value_ );
+    return n;
 }
 
-/// Execute the binary operator on two operands and return the result.
-value_type execute_operator( value_type v1, value_type v2, symbol op )
+int main(int argc,char *argv[])
 {
-    switch( op )
+    const char * filename = nullptr;
+    std::size_t n_jobs = 1;
+    report_format_t format = report_format_t::HUMAN;
+    // No terminal, mostramos cada resultado assim que fica pronto.
+    std::size_t flush_size = isatty( STDOUT_FILENO ) ? 0 : OutputWriter::FLUSH_SIZE;
+    EvaluatorConfig config;
+    bool cache_stats = false;
+    const char * formula_expr = nullptr;
+    bool jit = false;
+    bool split = false;
+    enum { NO_AGGREGATE, TEXT_AGGREGATE, JSON_AGGREGATE } aggregate_mode = NO_AGGREGATE;
+    std::vector< double > quantiles;
+    std::string serve_path;
+    bool follow_mode = false;
+    std::size_t offset = 0;
+    bool has_offset = false;
+    grammar::width_t width = grammar::width_t::W16;
+    bool width_given = false;
+    bool compile = argc > 1 and std::string( argv[1] ) == "compile";
+    const char * output_path = nullptr;
+    stats_t stats = NO_STATS;
+
+    // Processar os argumentos da linha de comando.
+    for ( int i{ compile ? 2 : 1 } ; i < argc ; ++i )
     {
-        case '^':
-            return pow( v1, v2 );
-        case '*':
-            return v1 * v2;
-        case '/':
-            if(v2 != 0){
-                return v1/v2;
-            }else{
-              control = false;
-              return 0;
+        std::string value;
+        try
+        {
+            if ( compile and std::string( argv[i] ) == "-o" and i+1 < argc )
+            {
+                output_path = argv[++i];
+            }
+            else if ( get_option( argc, argv, i, "--jobs", value ) )
+            {
+                n_jobs = get_count( value, 1, MAX_JOBS );
+            }
+            else if ( get_option( argc, argv, i, "--format", value ) )
+            {
+                if ( value == "human" ) format = report_format_t::HUMAN;
+                else if ( value == "compact" ) format = report_format_t::COMPACT;
+                else throw std::invalid_argument( value );
+            }
+            else if ( get_option( argc, argv, i, "--flush-size", value ) )
+            {
+                flush_size = get_count( value, 0, MAX_FLUSH_SIZE );
+            }
+            else if ( get_option( argc, argv, i, "--cache", value ) )
+            {
+                config.cache_size = get_count( value, 0, MAX_CACHE );
+            }
+            else if ( std::string( argv[i] ) == "--formula" and i+1 < argc )
+            {
+                formula_expr = argv[++i];
+            }
+            else if ( std::string( argv[i] ).compare( 0, 10, "--formula=" ) == 0 )
+            {
+                formula_expr = argv[i] + 10;
+            }
+            else if ( std::string( argv[i] ) == "--jit" )
+            {
+                jit = true;
+            }
+            else if ( std::string( argv[i] ) == "--aggregate" )
+            {
+                aggregate_mode = TEXT_AGGREGATE;
+            }
+            else if ( std::string( argv[i] ).compare( 0, 12, "--aggregate=" ) == 0 )
+            {
+                value = argv[i] + 12;
+                if ( value == "text" ) aggregate_mode = TEXT_AGGREGATE;
+                else if ( value == "json" ) aggregate_mode = JSON_AGGREGATE;
+                else throw std::invalid_argument( value );
             }
-        case '%':
-            //if ( v2 == 0 ) throw std::overflow_error("Division by zero");
-            return v1%v2;
-        case '+':
-            return v1+v2;
-        case '-':
-            return v1-v2;
-        //default:
+            else if ( get_option( argc, argv, i, "--quantiles", value ) )
+            {
+                // Uma lista separada por vírgulas, cada um entre 0 e 1.
+                for ( std::size_t pos{0} ; pos <= value.size() ; )
+                {
+                    auto comma = std::min( value.find( ',', pos ), value.size() );
+                    std::size_t used;
+                    double q = std::stod( value.substr( pos, comma - pos ), &used );
+                    if ( used != comma - pos or not ( q >= 0 and q <= 1 ) ) throw std::invalid_argument( value );
+                    quantiles.push_back( q );
+                    pos = comma + 1;
+                }
+            }
+            else if ( std::string( argv[i] ) == "--split" )
+            {
+                split = true;
+            }
+            else if ( std::string( argv[i] ) == "--follow" )
+            {
+                follow_mode = true;
+            }
+            else if ( get_option( argc, argv, i, "--offset", value ) )
+            {
+                offset = get_count( value, 0 );
+                has_offset = true;
+            }
+            else if ( get_option( argc, argv, i, "--serve", value ) )
+            {
+                serve_path = value;
+            }
+            else if ( get_option( argc, argv, i, "--width", value ) )
+            {
+                if ( value == "16" ) width = grammar::width_t::W16;
+                else if ( value == "32" ) width = grammar::width_t::W32;
+                else if ( value == "64" ) width = grammar::width_t::W64;
+                else if ( value == "128" ) width = grammar::width_t::W128;
+                else if ( value == "big" ) width = grammar::width_t::BIG;
+                else throw std::invalid_argument( value );
+                width_given = true;
+            }
+            else if ( get_option( argc, argv, i, "--max-depth", value ) )
+            {
+                config.max_depth = get_count( value, 0 );
+            }
+            else if ( std::string( argv[i] ) == "--cache-stats" )
+            {
+                cache_stats = true;
+            }
+            else if ( std::string( argv[i] ) == "--stats" )
+            {
+                stats = TEXT_STATS;
+            }
+            else if ( std::string( argv[i] ).compare( 0, 8, "--stats=" ) == 0 )
+            {
+                value = argv[i] + 8;
+                if ( value == "text" ) stats = TEXT_STATS;
+                else if ( value == "json" ) stats = JSON_STATS;
+                else throw std::invalid_argument( value );
+            }
+            else if ( std::string( argv[i] ) == "--help" )
+            {
+                usage( argv[0] );
+                return EXIT_SUCCESS;
+            }
+            else filename = argv[i];
+        }
+        catch ( const std::exception & )
+        {
+            std::cout << "Invalid option value \"" << value << "\"!\n";
+            usage( argv[0] );
+            return EXIT_FAILURE;
+        }
     }
-    throw std::runtime_error("Invalid operator!");
-}
 
-std::vector<std::string> infix_to_postfix( Parser & obj )
-{
-    std::stack< std::string > s; // auxiliary data structure.
-    std::string postfix = "1234"; // stores the postfix expression
-    std::vector < std::string > aux;
-    // Process each incoming symbol
-    auto lista = obj.get_tokens();
-    Token t;
-    for( auto si = lista.begin(); si != lista.end(); si++)
+    if ( compile )
     {
-        t = *si;
-        if ( is_operand( (int) t.type ) )
-             aux.push_back( t.value); // send it straight to the output symbol queue.
-        else if ( is_opening_scope( (int) t.type )){
-            s.push( t.value ); // always goes into the "waiting room"
+        if ( output_path == nullptr or ( filename == nullptr and isatty( STDIN_FILENO ) ) )
+        {
+            std::cout << "Wrong syntaxe, give the input file and the output file (-o)!\n";
+            usage( argv[0] );
+            return EXIT_FAILURE;
         }
-        else if ( is_closing_scope( (int) t.type ))
+        LineReader reader( filename );
+        if ( not reader.is_open() )
         {
-            // Pop out all pending operations.
-            while( not is_opening_scope( s.top()[0] ) )
-            {
-                // remove operator and send it to the postfix expression.
-                aux.push_back( s.top()+"");
-                s.pop();
-            }
-            // Don't forget to get rid of the opening scope.
-            s.pop();
+            std::cout << "Cannot open \"" << filename << "\": " << std::strerror( errno ) << "!\n";
+            return EXIT_FAILURE;
         }
-        else if ( is_operator( (int) t.type ))
+        if ( not CompiledFile::compile( reader, output_path, width, config.max_depth ) )
         {
-            // Send out the "waiting" operator with higher or equal precedence...
-            // unless they have equal precedence AND are right associated.
-            while ( not s.empty() and has_higher_or_eq_precedence( s.top()[0], t.value[0] ) )
-            {
-                aux.push_back (s.top()+""); // send it to the output
-                s.pop(); // get rid of the operator.
-            }
-            // The incoming symbol always goes into the "waiting room".
-            s.push( t.value ) ;
+            if ( errno == EINVAL )
+                std::cerr << "The output file \"" << output_path << "\" is the input file!\n";
+            else
+                std::cerr << "Cannot write \"" << output_path << "\": " << std::strerror( errno ) << "!\n";
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Um arquivo pré-compilado é reconhecido antes de escolher o modo: ele não é texto.
+    bool named = filename != nullptr and std::strcmp( filename, "-" ) != 0;
+    CompiledFile compiled( named and formula_expr == nullptr and serve_path.empty() ? filename : "" );
+    if ( compiled.is_open() )
+    {
+        if ( follow_mode or n_jobs > 1 or config.cache_size > 0 or split or aggregate_mode != NO_AGGREGATE )
+        {
+            std::cerr << "The options --follow, --jobs, --cache, --split and --aggregate do not go with a compiled file!\n";
+            return EXIT_FAILURE;
         }
-        else // white space or whatever
+        if ( width_given and width != compiled.get_width() )
         {
-            // Do nothing. Just ignore this...
+            std::cerr << "The compiled file \"" << filename << "\" was compiled with another --width!\n";
+            return EXIT_FAILURE;
         }
     }
 
-    // Clear out any pending operators stored in the stack.
-    while ( not s.empty() )
+    if ( aggregate_mode != NO_AGGREGATE and
+         ( ( n_jobs > 1 and not split ) or formula_expr != nullptr or not serve_path.empty() ) )
+    {
+        std::cout << "The option --aggregate does not go with --jobs (but for --split), --formula or --serve!\n";
+        usage( argv[0] );
+        return EXIT_FAILURE;
+    }
+    if ( not quantiles.empty() and aggregate_mode == NO_AGGREGATE )
     {
-        aux.push_back( s.top()+"");
-        s.pop();
+        std::cout << "The option --quantiles only goes with --aggregate!\n";
+        usage( argv[0] );
+        return EXIT_FAILURE;
     }
 
+    if ( split and ( config.cache_size > 0 or formula_expr != nullptr or not serve_path.empty() ) )
+    {
+        std::cout << "The option --split does not go with --cache, --formula or --serve!\n";
+        usage( argv[0] );
+        return EXIT_FAILURE;
+    }
 
-    return aux;
-}
+    if ( follow_mode and
+         ( ( n_jobs > 1 and not split ) or formula_expr != nullptr or not serve_path.empty() or
+           aggregate_mode != NO_AGGREGATE or filename == nullptr or std::strcmp( filename, "-" ) == 0 ) )
+    {
+        std::cout << "The option --follow needs an input file, and does not go with --jobs (but for --split),\n"
+                  << "--formula, --serve or --aggregate!\n";
+        usage( argv[0] );
+        return EXIT_FAILURE;
+    }
+    if ( has_offset and not follow_mode )
+    {
+        std::cout << "The option --offset only goes with --follow!\n";
+        usage( argv[0] );
+        return EXIT_FAILURE;
+    }
 
-value_type evaluate_postfix( std::vector<std::string> postfix )
-{
-    std::stack< value_type > s;
-  /*  int c_operator_minus=0, c_operator = 0;
-    for( auto si = postfix.begin(); si != postfix.end(); si++ )
+    if ( width != grammar::width_t::W16 and
+         ( ( n_jobs > 1 and not split ) or config.cache_size > 0 or formula_expr != nullptr or not serve_path.empty() ) )
     {
-      std::string teste = (*si)+"";
-      std::cout << teste <<" "<< teste.size()<< std::endl;
-      if(teste.size() == 1){
-        if ( (*si)[0] = '-' ){
-            c_operator_minus++;
+        std::cout << "The option --width only goes with the plain evaluation of a file!\n";
+        usage( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    if ( not serve_path.empty() )
+    {
+        // Um único avaliador, sempre "aquecido", atende todas as conexões.
+        Server server( config );
+        if ( not server.listen( serve_path ) )
+        {
+            std::cerr << "Cannot listen on \"" << serve_path << "\": " << std::strerror( errno ) << "!\n";
+            return EXIT_FAILURE;
         }
-        else{
-          c_operator++;
+        std::cerr << ">>> Listening on \"" << serve_path << "\"...\n";
+        if ( not server.run() )
+        {
+            std::cerr << "Cannot serve: " << std::strerror( errno ) << "!\n";
+            return EXIT_FAILURE;
         }
-      }
-    }*/
-    // For each operator/operando in the input postfix expression do this...
-    for( auto si = postfix.begin(); si != postfix.end(); si++ )
-    {
-        std::string teste = (*si)+"";
-        std::cout << teste << "\n";
-        if(teste.size() == 1){
-          if(is_operator((*si)[0])){
-            // IMPORTANT: Pop out operandos in reverse order!
-            auto op2 = s.top(); s.pop();
-            auto op1 = s.top(); s.pop();
-            // The result of the operation is pushed back into the stack.
-            s.push( execute_operator( op1, op2, (*si)[0] ) );
-          }else{
-              s.push( char2integer(*si) );
-          }
-        }else{
-          s.push( char2integer(*si) );
+        std::cerr << ">>> " << server.connections_served() << " connections served.\n";
+        if ( cache_stats )
+        {
+            auto cache = server.get_evaluator().get_cache();
+            std::cerr << ">>> Cache: " << ( cache ? cache->hits() : 0 ) << " hits, "
+                      << ( cache ? cache->misses() : 0 ) << " misses.\n";
         }
-        /*if ( is_operand( (*si)[0] ) ){
-
-            s.push( char2integer(*si) ); // Do not forget to convert it into integer.
+        finish_stats( stats );
+        return EXIT_SUCCESS;
+    }
 
+    if ( follow_mode )
+    {
+        // Só as linhas novas são lidas; o deslocamento permite retomar depois de onde parou.
+        Follower follower( filename, offset );
+        if ( not follower.is_open() )
+        {
+            std::cerr << "Cannot follow \"" << filename << "\": " << std::strerror( errno ) << "!\n";
+            return EXIT_FAILURE;
         }
-        else if ( is_operator( (*si)[0] ) )
+        OutputWriter writer( STDOUT_FILENO, format, flush_size );
+        std::size_t hits{0}, misses{0};
+        if ( split and n_jobs < 2 ) n_jobs = std::max( 1u, std::thread::hardware_concurrency() );
+        std::size_t split_jobs = split ? n_jobs : 0;
+        switch ( width )
         {
-            // IMPORTANT: Pop out operandos in reverse order!
-            auto op2 = s.top(); s.pop();
-            auto op1 = s.top(); s.pop();
-            // The result of the operation is pushed back into the stack.
-            s.push( execute_operator( op1, op2, (*si)[0] ) );
-
+            case grammar::width_t::W16:
+                if ( split )
+                {
+                    follow_wide< long >( split_jobs, width, config, follower, writer );
+                    break;
+                }
+                {
+                    Evaluator evaluator( config );
+                    follow( evaluator, follower, writer );
+                    if ( auto cache = evaluator.get_cache() )
+                    {
+                        hits = cache->hits();
+                        misses = cache->misses();
+                    }
+                }
+                break;
+            case grammar::width_t::W32:  follow_wide< std::int32_t >( split_jobs, width, config, follower, writer ); break;
+            case grammar::width_t::W64:  follow_wide< long >( split_jobs, width, config, follower, writer ); break;
+            case grammar::width_t::W128: follow_wide< __int128 >( split_jobs, width, config, follower, writer ); break;
+            default:                     follow_wide< BigInt >( split_jobs, width, config, follower, writer ); break;
         }
-        //else assert( false ); // unexpected symbol...
-    }*/
-  }
-    return s.top();
-}
+        if ( format == report_format_t::HUMAN )
+            writer.write_raw( "\n>>> Normal exiting...\n" );
+        writer.flush();
+
+        std::cerr << ">>> Stopped at byte " << follower.get_offset() << " of \"" << filename
+                  << "\" (resume with --offset " << follower.get_offset() << ").\n"
+                  << ">>> " << follower.batches() << " batches; latency from append to report: mean "
+                  << follower.mean_latency() << " us, max " << follower.max_latency() << " us.\n";
+        if ( cache_stats )
+            std::cerr << ">>> Cache: " << hits << " hits, " << misses << " misses.\n";
+        finish_stats( stats );
+        return EXIT_SUCCESS;
+    }
 
+    // Sem arquivo, num terminal: o prompt interativo.
+    if ( filename == nullptr and formula_expr == nullptr and width == grammar::width_t::W16 and
+         isatty( STDIN_FILENO ) and isatty( STDOUT_FILENO ) )
+    {
+        Repl repl( config );
+        return repl.run( STDIN_FILENO, STDOUT_FILENO ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-int main(int argc,char *argv[])
-{
-    Parser my_parser; // Instancia um parser.
+    // Sem arquivo, lemos da entrada padrão (desde que não seja um terminal).
+    if ( filename == nullptr and isatty( STDIN_FILENO ) )
+    {
+        std::cout<< "Wrong syntaxe, add the path of a file containing the expressions to be analyzed!\n";
+        usage( argv[0] );
+        return EXIT_FAILURE;
+    }
 
-    expressions = reader_file(argv[1]);
+    // Um arquivo pré-compilado é avaliado direto dos programas, sem análise.
+    if ( compiled.is_open() )
+    {
+        OutputWriter writer( STDOUT_FILENO, format, flush_size );
+        bool ok = compiled.run( writer );
+        if ( format == report_format_t::HUMAN and ok )
+            writer.write_raw( "\n>>> Normal exiting...\n" );
+        writer.flush();
+        if ( not ok )
+        {
+            std::cerr << "The compiled file \"" << filename << "\" is damaged or of another version!\n";
+            return EXIT_FAILURE;
+        }
+        finish_stats( stats );
+        return EXIT_SUCCESS;
+    }
 
-    // Tentar analisar cada expressão da lista.
-    for( const auto & expr : expressions )
+    LineReader reader( filename );
+    if ( not reader.is_open() )
     {
-        // Fazer o parsing desta expressão.
-        auto result = my_parser.parse( expr );
-        // Preparar cabeçalho da saida.
-        std::cout << std::setfill('=') << std::setw(80) << "\n";
-        std::cout << std::setfill(' ') << ">>> Parsing \"" << expr << "\"\n";
-        // Se deu pau, imprimir a mensagem adequada.
-        if ( result.type != Parser::ResultType::OK ){
-            print_error_msg( result, expr );
+        std::cout<< "Wrong syntaxe, add the path of a file containing the expressions to be analyzed!\n";
+        return EXIT_FAILURE;
+    }
+
+    if ( aggregate_mode != NO_AGGREGATE )
+    {
+        // Nada é formatado nem escrito por linha: só as estatísticas, no final.
+        bool json = aggregate_mode == JSON_AGGREGATE;
+        if ( split and n_jobs < 2 ) n_jobs = std::max( 1u, std::thread::hardware_concurrency() );
+        std::size_t split_jobs = split ? n_jobs : 0;
+        switch ( width )
+        {
+            case grammar::width_t::W16:
+                if ( split )
+                {
+                    aggregate_wide< long >( split_jobs, width, config, quantiles, json, reader );
+                    break;
+                }
+                {
+                    Evaluator evaluator( config ); // A SplitEvaluator also follows the rules of W16, a WideEvaluator not.
+                    aggregate< long >( evaluator, quantiles, json, reader );
+                    auto cache = evaluator.get_cache();
+                    if ( cache_stats )
+                        std::cerr << ">>> Cache: " << ( cache ? cache->hits() : 0 ) << " hits, "
+                                  << ( cache ? cache->misses() : 0 ) << " misses.\n";
+                }
+                break;
+            case grammar::width_t::W32:  aggregate_wide< std::int32_t >( split_jobs, width, config, quantiles, json, reader ); break;
+            case grammar::width_t::W64:  aggregate_wide< long >( split_jobs, width, config, quantiles, json, reader ); break;
+            case grammar::width_t::W128: aggregate_wide< __int128 >( split_jobs, width, config, quantiles, json, reader ); break;
+            default:                     aggregate_wide< BigInt >( split_jobs, width, config, quantiles, json, reader ); break;
         }
-        else{
-          std::cout << ">>> Expression SUCCESSFULLY parsed!\n";
-
-          auto postfix = infix_to_postfix(my_parser);
-          //std::copy(postfix.begin(), postfix.end(), std::ostream_iterator<std::string>(std::cout, "\n"));
-          auto result = evaluate_postfix( postfix );
-          if(result > std::numeric_limits< int >::min() and result < std::numeric_limits< int >::max()){
-            if(control){
-              std::cout << ">>> Result is: " << result << std::endl;
-            }else{
-              std::cout << "Division by zero!" << std::endl;
-              control = true;
-            }
-          }else{
-            std::cout << "Numeric overflow!" << std::endl;
-            control = true;
-          }
+        finish_stats( stats );
+        return EXIT_SUCCESS;
+    }
 
+    OutputWriter writer( STDOUT_FILENO, format, flush_size );
+    std::string_view expr;
+    std::size_t hits{0}, misses{0};
+    if ( formula_expr != nullptr )
+    {
+        // A única expressão é compilada uma vez; cada linha da entrada traz os valores das variáveis.
+        Formula formula;
+        formula.set_jit( jit );
+        auto result = formula.compile( formula_expr );
+        if ( result.type != Parser::ResultType::OK )
+        {
+            std::string msg;
+            print_error_msg( msg, result, formula_expr );
+            writer.write_raw( msg );
+            return EXIT_FAILURE;
+        }
+        formula.run( reader, writer );
+    }
+    else if ( split )
+    {
+        // Cada linha longa é dividida entre as threads; as curtas são avaliadas inteiras.
+        if ( n_jobs < 2 ) n_jobs = std::max( 1u, std::thread::hardware_concurrency() );
+        switch ( width )
+        {
+            case grammar::width_t::W16:
+            case grammar::width_t::W64:  evaluate_split< long >( n_jobs, width, config, reader, writer ); break;
+            case grammar::width_t::W32:  evaluate_split< std::int32_t >( n_jobs, width, config, reader, writer ); break;
+            case grammar::width_t::W128: evaluate_split< __int128 >( n_jobs, width, config, reader, writer ); break;
+            default:                     evaluate_split< BigInt >( n_jobs, width, config, reader, writer ); break;
         }
+    }
+    else if ( n_jobs > 1 )
+    {
+        // Os workers avaliam os blocos de linhas, e a saída sai na ordem da entrada.
+        BatchRunner runner( n_jobs, writer, config );
+        while ( reader.next( expr ) )
+            runner.add_line( expr );
+        runner.finish();
+        hits = runner.cache_hits();
+        misses = runner.cache_misses();
+    }
+    else if ( width != grammar::width_t::W16 )
+    {
+        // Cada largura tem o seu próprio laço, com a aritmética do seu tipo.
+        switch ( width )
+        {
+            case grammar::width_t::W32:  evaluate_wide< std::int32_t >( width, config, reader, writer ); break;
+            case grammar::width_t::W64:  evaluate_wide< long >( width, config, reader, writer ); break;
+            case grammar::width_t::W128: evaluate_wide< __int128 >( width, config, reader, writer ); break;
+            default:                     evaluate_wide< BigInt >( width, config, reader, writer ); break;
+        }
+    }
+    else
+    {
+        Evaluator evaluator( config ); // Instancia um parser e a máquina virtual que executa o programa gerado.
+
+        // Tentar analisar cada expressão da entrada, uma linha por vez.
+        while ( reader.next( expr ) )
+            writer.write( expr, evaluator.evaluate( expr ) );
 
+        if ( auto cache = evaluator.get_cache() )
+        {
+            hits = cache->hits();
+            misses = cache->misses();
+        }
     }
 
-    std::cout << "\n>>> Normal exiting...\n";
+    if ( format == report_format_t::HUMAN )
+        writer.write_raw( "\n>>> Normal exiting...\n" );
+
+    if ( cache_stats )
+        std::cerr << ">>> Cache: " << hits << " hits, " << misses << " misses.\n";
+
+    if ( stats != NO_STATS )
+        writer.flush(); // Its time goes into the summary too.
+    finish_stats( stats );
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,132 @@
+#include "../include/evaluator.h"
+#include "../include/cache.h"
+#include "../include/stats.h"
+#include "../include/bigint.h"
+
+/// Creates an evaluator whose parser only emits the program (no token list).
+Evaluator::Evaluator( const EvaluatorConfig & config_ )
+{
+    parser.set_keep_tokens( false );
+    parser.set_max_depth( config_.max_depth );
+    set_cache( config_.cache_size );
+}
+
+Evaluator::~Evaluator() = default;
+
+/// @param capacity_ maximum number of outcomes kept; 0 turns the cache off.
+void Evaluator::set_cache( std::size_t capacity_ )
+{
+    if ( capacity_ == 0 ) cache.reset();
+    else cache.reset( new OutcomeCache( capacity_ ) );
+}
+
+/*!
+ * Parses the expression and, if it is valid, runs the resulting program.
+ * If there is a cache, repeated expressions are answered from it.
+ *
+ * @param e_ the expression (it is not copied).
+ * @return the outcome, either a value or the reason there is none.
+ */
+Outcome Evaluator::evaluate( std::string_view e_ )
+{
+    BARES_COUNT( LINES, 1 );
+    BARES_COUNT( BYTES, e_.size() );
+
+    Outcome outcome;
+    if ( not cache ) outcome = run( e_ );
+    else if ( not cache->find( e_, outcome ) )
+    {
+        BARES_COUNT( CACHE_MISSES, 1 );
+        outcome = run( e_ );
+        cache->insert( outcome );
+    }
+    else
+    {
+        BARES_COUNT( CACHE_HITS, 1 );
+    }
+
+    BARES_COUNT_OUTCOME( outcome );
+    return outcome;
+}
+
+/*!
+ * Evaluates a batch of expressions, one after the other, as evaluate() would.
+ *
+ * @param exprs_ the expressions (they are not copied).
+ * @param n_ how many expressions there are.
+ * @param results_ receives the outcome of each expression; room for `n_` of them.
+ */
+void Evaluator::evaluate( const std::string_view * exprs_, std::size_t n_, Outcome * results_ )
+{
+    for ( std::size_t i{0} ; i < n_ ; ++i )
+        results_[i] = evaluate( exprs_[i] );
+}
+
+/// Parses and evaluates the expression, without looking at the cache.
+Outcome Evaluator::run( std::string_view e_ )
+{
+    Parser::ResultType result;
+    {
+        BARES_STAGE( PARSE );
+        result = parser.parse( e_ );
+    }
+    if ( result.type != Parser::ResultType::OK )
+        return Outcome( Outcome::PARSE_ERROR, 0, result );
+
+    VM::ResultType exec;
+    {
+        BARES_STAGE( EVAL );
+        exec = vm.run( parser.get_program() );
+    }
+    return make_outcome( exec, parser.get_program() );
+}
+
+//=== WideEvaluator.
+
+/// Creates an evaluator whose parser only emits the program, with the constants of `width_`.
+template < typename T >
+WideEvaluator< T >::WideEvaluator( grammar::width_t width_, const EvaluatorConfig & config_ )
+{
+    parser.set_keep_tokens( false );
+    parser.set_max_depth( config_.max_depth );
+    parser.set_width( width_ );
+}
+
+/*!
+ * Parses the expression and, if it is valid, runs the resulting program.
+ *
+ * @param e_ the expression (it is not copied).
+ * @return the outcome, either a value or the reason there is none.
+ */
+template < typename T >
+typename WideEvaluator< T >::outcome_type WideEvaluator< T >::evaluate( std::string_view e_ )
+{
+    BARES_COUNT( LINES, 1 );
+    BARES_COUNT( BYTES, e_.size() );
+
+    Parser::ResultType result;
+    {
+        BARES_STAGE( PARSE );
+        result = parser.parse( e_ );
+    }
+    if ( result.type != Parser::ResultType::OK )
+    {
+        outcome_type outcome( outcome_type::PARSE_ERROR, 0, result );
+        BARES_COUNT_OUTCOME( outcome );
+        return outcome;
+    }
+
+    typename BasicVM< T >::ResultType exec;
+    {
+        BARES_STAGE( EVAL );
+        exec = vm.run( parser.get_program() );
+    }
+    auto outcome = make_wide_outcome< T >( exec );
+    BARES_COUNT_OUTCOME( outcome );
+    return outcome;
+}
+
+template class WideEvaluator< std::int32_t >;
+template class WideEvaluator< long >;
+template class WideEvaluator< __int128 >;
+template class WideEvaluator< BigInt >;
@@ -0,0 +1,228 @@
+#include "../include/follow.h"
+#include "../include/stats.h"
+#include <cstring>         // std::memchr, std::memmove
+#include <cerrno>          // errno
+#include <fcntl.h>         // ::open
+#include <unistd.h>        // ::pread, ::read, ::close
+#include <poll.h>          // ::poll
+#include <sys/stat.h>      // ::stat, ::fstat
+#include <sys/inotify.h>   // inotify_*
+#include <sys/signalfd.h>  // ::signalfd
+
+/// The events that make wait() look at the file again.
+static constexpr std::uint32_t WATCHED = IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+
+/*!
+ * Opens the file, watches it and takes SIGINT and SIGTERM as events (they are blocked
+ * until the follower is destroyed, so that they can only arrive between two batches).
+ *
+ * @param filename_ the path of the file.
+ * @param offset_ where to start; if it is not the start of a line, the rest of that line is skipped.
+ */
+Follower::Follower( const char * filename_, size_type offset_ )
+    : path( filename_ )
+    , since( clock::now() )
+{
+    inotify_fd = ::inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if ( inotify_fd == -1 or not open( offset_ ) ) return;
+
+    sigset_t signals;
+    sigemptyset( &signals );
+    sigaddset( &signals, SIGINT );
+    sigaddset( &signals, SIGTERM );
+    if ( sigprocmask( SIG_BLOCK, &signals, &previous ) == -1 ) return;
+    masked = true;
+    signal_fd = ::signalfd( -1, &signals, SFD_NONBLOCK | SFD_CLOEXEC );
+}
+
+Follower::~Follower()
+{
+    if ( fd != -1 ) ::close( fd );
+    if ( inotify_fd != -1 ) ::close( inotify_fd ); // Also removes the watch.
+    if ( signal_fd != -1 ) ::close( signal_fd );
+    if ( masked ) sigprocmask( SIG_SETMASK, &previous, nullptr );
+}
+
+/*!
+ * Opens `path` (replacing the file we had, if any) and watches it instead.
+ *
+ * @param offset_ where to start reading.
+ * @return true if the file is open and watched; false otherwise (errno tells why).
+ */
+bool Follower::open( size_type offset_ )
+{
+    int new_fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+    if ( new_fd == -1 ) return false;
+    if ( watch != -1 ) ::inotify_rm_watch( inotify_fd, watch );
+    if ( fd != -1 ) ::close( fd );
+    fd = new_fd;
+    watch = ::inotify_add_watch( inotify_fd, path.c_str(), WATCHED );
+    if ( watch == -1 )
+    {
+        ::close( fd );
+        fd = -1;
+        return false;
+    }
+
+    buf_pos = buf_end = 0;
+    file_pos = offset_;
+    at_end = false;
+    // Só começamos no meio de uma linha se o byte anterior não for um '\n'.
+    char previous_byte = '\n';
+    skip_line = offset_ > 0 and ::pread( fd, &previous_byte, 1, offset_ - 1 ) == 1 and previous_byte != '\n';
+    return true;
+}
+
+/*!
+ * Reads up to READ_SIZE bytes after what was read before.  The incomplete line at the end
+ * of the buffer (if any) is moved to its start first, and the buffer grows if that line
+ * takes most of it.
+ *
+ * @return true if some data was read.
+ */
+bool Follower::read( void )
+{
+    if ( buf_pos > 0 )
+    {
+        std::memmove( buffer.data(), buffer.data() + buf_pos, buf_end - buf_pos );
+        buf_end -= buf_pos;
+        buf_pos = 0;
+    }
+    if ( buffer.size() < buf_end + READ_SIZE ) buffer.resize( buf_end + READ_SIZE );
+
+    ssize_t n = ::pread( fd, buffer.data() + buf_end, READ_SIZE, file_pos );
+    at_end = n < static_cast< ssize_t >( READ_SIZE );
+    if ( at_end ) caught_up = clock::now();
+    if ( n <= 0 ) return false;
+    buf_end += n;
+    file_pos += n;
+    BARES_HIGH_WATER( n );
+    return true;
+}
+
+/*!
+ * Gets the next complete line of the data read by the last wait().
+ *
+ * @param line_ receives the line, without the '\n'; valid only until the next wait().
+ * @return true if there was a line; false when the batch is over.
+ */
+bool Follower::next( std::string_view & line_ )
+{
+    BARES_STAGE( READ );
+    if ( skip_line )
+    {
+        auto nl = static_cast< const char * >( std::memchr( buffer.data() + buf_pos, '\n', buf_end - buf_pos ) );
+        if ( nl == nullptr )
+        {
+            buf_pos = buf_end; // Still in the line we skip.
+            return false;
+        }
+        buf_pos = nl - buffer.data() + 1;
+        skip_line = false;
+    }
+
+    auto begin = buffer.data() + buf_pos;
+    auto nl = static_cast< const char * >( std::memchr( begin, '\n', buf_end - buf_pos ) );
+    if ( nl == nullptr ) return false; // Not complete yet: it waits for the next batch.
+    line_ = std::string_view( begin, nl - begin );
+    buf_pos += line_.size() + 1;
+    lines_out = true;
+    return true;
+}
+
+/*!
+ * Waits until there is data after what has been read, and reads it.
+ *
+ * Data left from a read that did not reach the end of the file is read at once.
+ * Otherwise the size of the file tells whether something was appended since the last
+ * read; if not, we sleep until inotify reports a change (or, every RECHECK_INTERVAL,
+ * to see whether the file was replaced).
+ *
+ * The latency of a batch starts when its data was surely there: for data found right
+ * after a read that reached the end of the file, at that read (it was appended after,
+ * while the previous batch was being evaluated), and for data that woke us up, at the
+ * wake up.  A backlog read in several batches keeps the start of its first one.
+ *
+ * @return true with a new batch; false when SIGINT or SIGTERM arrived, or on an error.
+ */
+bool Follower::wait( void )
+{
+    lines_out = false;
+    for (;;)
+    {
+        if ( take_signal() ) return false;
+
+        if ( reopen )
+        {
+            reopen = false;
+            if ( not open( 0 ) ) return false;
+            since = clock::now();
+        }
+        if ( not at_end and read() ) return true;
+
+        struct stat info;
+        if ( ::fstat( fd, &info ) == -1 ) return false;
+        auto size = static_cast< size_type >( info.st_size );
+        if ( size < file_pos )
+        {
+            // Truncated: what is there now is new.
+            buf_pos = buf_end = file_pos = 0;
+            skip_line = false;
+            since = clock::now();
+            if ( read() ) return true;
+            continue;
+        }
+        if ( size > file_pos )
+        {
+            since = caught_up;
+            if ( read() ) return true;
+            continue;
+        }
+        if ( replaced() )
+        {
+            // The old file is over: its last line is complete, even without a '\n'.
+            reopen = true;
+            if ( buf_pos == buf_end or skip_line ) continue;
+            if ( buffer.size() == buf_end ) buffer.resize( buf_end + 1 );
+            buffer[ buf_end++ ] = '\n';
+            ++file_pos;
+            since = clock::now();
+            return true;
+        }
+
+        pollfd fds[2] = { { inotify_fd, POLLIN, 0 }, { signal_fd, POLLIN, 0 } };
+        if ( ::poll( fds, 2, RECHECK_INTERVAL ) == -1 and errno != EINTR ) return false;
+        // The events only wake us up: the size of the file says what happened.
+        alignas( inotify_event ) char events[ 4096 ];
+        while ( ::read( inotify_fd, events, sizeof( events ) ) > 0 ) { /* empty */ }
+        caught_up = clock::now();
+    }
+}
+
+/// Ends the latency of the current batch, if it had lines.
+void Follower::batch_done( void )
+{
+    if ( not lines_out ) return;
+    lines_out = false;
+    auto us = static_cast< std::uint64_t >(
+            std::chrono::duration_cast< std::chrono::microseconds >( clock::now() - since ).count() );
+    ++n_batches;
+    latency_sum += us;
+    if ( us > latency_max ) latency_max = us;
+}
+
+/// Whether the name of the file is now another file (or no file).
+bool Follower::replaced( void ) const
+{
+    struct stat ours, named;
+    if ( ::fstat( fd, &ours ) == -1 ) return false;
+    if ( ::stat( path.c_str(), &named ) == -1 ) return false; // Gone, and not back yet: keep the one we have.
+    return ours.st_ino != named.st_ino or ours.st_dev != named.st_dev;
+}
+
+/// Checks (without waiting) whether SIGINT or SIGTERM arrived, and takes it.
+bool Follower::take_signal( void )
+{
+    signalfd_siginfo info;
+    return ::read( signal_fd, &info, sizeof( info ) ) == sizeof( info );
+}
@@ -0,0 +1,137 @@
+#include "../include/formula.h"
+#include <charconv> // std::from_chars
+#include <limits>   // std::numeric_limits
+
+Formula::Formula()
+{
+    parser.set_keep_tokens( false );
+    parser.set_variables( true );
+}
+
+/*!
+ * @param e_ the expression; it may be discarded afterwards.
+ * @return the parsing result (the formula may only be evaluated if it is OK).
+ */
+Parser::ResultType Formula::compile( std::string_view e_ )
+{
+    auto result = parser.parse( e_ );
+    if ( result.type == Parser::ResultType::OK and use_jit ) jit.compile( parser.get_program() );
+    else jit.clear();
+    return result;
+}
+
+/*!
+ * @param columns_ one array of `n_rows_` values per variable (see get_variables()).
+ * @param n_rows_ number of rows.
+ * @param out_ receives the outcome of each row.
+ */
+void Formula::evaluate( const value_type * const * columns_, size_type n_rows_, Outcome * out_ )
+{
+    results.resize( n_rows_ );
+    if ( jit.is_compiled() ) jit.run( parser.get_program(), columns_, n_rows_, results.data() );
+    else vm.run( parser.get_program(), columns_, n_rows_, results.data() );
+    for ( size_type i{0} ; i < n_rows_ ; ++i )
+        out_[i] = make_outcome( results[i], parser.get_program() );
+}
+
+/// Checks whether `c_` separates two values of a row.
+static bool is_separator( char c_ )
+{ return c_ == ' ' or c_ == '\t' or c_ == ','; }
+
+/*!
+ * Errors are reported with the codes (and columns) of the parser: a malformed value is an
+ * ILL_FORMED_INTEGER, a value that does not fit in an `int` is INTEGER_OUT_OF_RANGE, a
+ * missing value is a MISSING_TERM and an extra one is an EXTRANEOUS_SYMBOL.
+ *
+ * @param line_ the row.
+ * @param values_ receives the values.
+ * @param n_ number of values expected.
+ * @return OK, or what is wrong with the row.
+ */
+Parser::ResultType Formula::read_row( std::string_view line_, value_type * values_, size_type n_ )
+{
+    const char * first = line_.data();
+    const char * const last = first + line_.size();
+    auto column = [&]( const char * p_ ) { return Parser::ResultType::size_type( p_ - line_.data() ); };
+
+    for ( size_type v{0} ; v <= n_ ; ++v )
+    {
+        while ( first != last and is_separator( *first ) ) ++first;
+        if ( v == n_ )
+            break;
+        if ( first == last )
+            return Parser::ResultType( Parser::ResultType::MISSING_TERM, column( first ) );
+
+        long long value;
+        auto [ ptr, ec ] = std::from_chars( first, last, value );
+        if ( ec == std::errc::result_out_of_range or
+             ( ec == std::errc() and ( value < std::numeric_limits< int >::min() or
+                                       value > std::numeric_limits< int >::max() ) ) )
+            return Parser::ResultType( Parser::ResultType::INTEGER_OUT_OF_RANGE, column( first ) );
+        // Ill formed integers are reported one column after the offending symbol.
+        if ( ec != std::errc() )
+            return Parser::ResultType( Parser::ResultType::ILL_FORMED_INTEGER, column( first ) + 1 );
+        if ( ptr != last and not is_separator( *ptr ) )
+            return Parser::ResultType( Parser::ResultType::ILL_FORMED_INTEGER, column( ptr ) + 1 );
+
+        values_[v] = value;
+        first = ptr;
+    }
+
+    if ( first != last )
+        return Parser::ResultType( Parser::ResultType::EXTRANEOUS_SYMBOL, column( first ) );
+    return Parser::ResultType( Parser::ResultType::OK );
+}
+
+/*!
+ * Reads the rows in groups of `ROWS`, transposes them into columns, evaluates each group
+ * at once and writes the outcomes in input order (a row that cannot be read gets its error).
+ *
+ * @param reader_ the rows, one per line.
+ * @param writer_ where the outcomes go; in the human format each report shows the row.
+ */
+void Formula::run( LineReader & reader_, OutputWriter & writer_ )
+{
+    const size_type n_vars = get_variables().size();
+    std::vector< value_type > columns( n_vars * ROWS );
+    std::vector< const value_type * > column_ptrs( n_vars );
+    for ( size_type v{0} ; v < n_vars ; ++v ) column_ptrs[v] = columns.data() + v * ROWS;
+
+    std::vector< value_type > row( n_vars );
+    std::vector< Parser::ResultType > errors( ROWS );
+    std::vector< Outcome > outcomes( ROWS );
+    std::string text;                // The rows of the group (the reader's views do not last).
+    std::vector< size_type > ends;   // End of each row in `text`.
+    size_type n{0};
+
+    auto write_group = [&]() {
+        evaluate( column_ptrs.data(), n, outcomes.data() );
+        size_type begin{0};
+        for ( size_type i{0} ; i < n ; ++i )
+        {
+            std::string_view line( text.data() + begin, ends[i] - begin );
+            if ( errors[i].type == Parser::ResultType::OK ) writer_.write( line, outcomes[i] );
+            else writer_.write( line, Outcome( Outcome::PARSE_ERROR, 0, errors[i] ) );
+            begin = ends[i];
+        }
+        text.clear();
+        ends.clear();
+        n = 0;
+    };
+
+    std::string_view line;
+    while ( reader_.next( line ) )
+    {
+        errors[n] = read_row( line, row.data(), n_vars );
+        bool ok = errors[n].type == Parser::ResultType::OK;
+        for ( size_type v{0} ; v < n_vars ; ++v )
+            columns[ v * ROWS + n ] = ok ? row[v] : 0;
+        text += line;
+        ends.push_back( text.size() );
+
+        if ( ++n == ROWS )
+            write_group();
+    }
+    if ( n != 0 )
+        write_group();
+}
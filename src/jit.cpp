@@ -0,0 +1,360 @@
+#include "../include/jit.h"
+#include <cstdint>    // std::uint8_t, std::int32_t
+#include <cstring>    // std::memcpy
+#include <cstddef>    // offsetof
+#include <sys/mman.h> // mmap, mprotect, munmap
+
+namespace {
+
+/// The x86-64 general purpose registers, by encoding.
+enum reg_t : std::uint8_t {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+/// The evaluation stack: slot `i` lives in `STACK[i]` (none of them is used by "idiv" or by the loop).
+constexpr reg_t STACK[ JitProgram::MAX_DEPTH ] = { RBX, RBP, R10, R11, R12, R13, R14, R15 };
+/// The registers of STACK that the caller expects us to preserve.
+constexpr reg_t SAVED[] = { RBX, RBP, R12, R13, R14, R15 };
+
+// The code writes the results itself.
+static_assert( sizeof( VM::ResultType ) == 24 and offsetof( VM::ResultType, value ) == 8 and
+               offsetof( VM::ResultType, at_col ) == 16 and VM::ResultType::OK == 0,
+               "JitProgram expects VM::ResultType to be { code_t type; value_type value; size_type at_col; }" );
+
+/// Condition codes of "jcc".
+enum cond_t : std::uint8_t { CC_O = 0x0, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_S = 0x8 };
+
+/*!
+ * Just enough of an assembler for the code of JitProgram: 64-bit register to register
+ * instructions, the two addressing modes we need, and forward/backward jumps (always
+ * with 32-bit displacements, patched once the target is known).
+ */
+class Assembler
+{
+    public:
+        std::vector< std::uint8_t > code; //!< The machine code.
+
+        /// Current position (a jump target).
+        std::size_t here( void ) const { return code.size(); }
+
+        // "op dst, src" with the "/r" form: src goes in ModRM.reg, dst in ModRM.rm.
+        void add( reg_t dst_, reg_t src_ )  { rr( 0x01, dst_, src_ ); }
+        void sub( reg_t dst_, reg_t src_ )  { rr( 0x29, dst_, src_ ); }
+        void mov( reg_t dst_, reg_t src_ )  { rr( 0x89, dst_, src_ ); }
+        void cmp( reg_t dst_, reg_t src_ )  { rr( 0x39, dst_, src_ ); }
+        void test( reg_t dst_, reg_t src_ ) { rr( 0x85, dst_, src_ ); }
+        void xor_( reg_t dst_, reg_t src_ ) { rr( 0x31, dst_, src_ ); }
+        /// `dst_ *= src_` (signed, OF on overflow).
+        void imul( reg_t dst_, reg_t src_ )
+        {
+            rex( dst_, src_ );
+            byte( 0x0F ); byte( 0xAF );
+            modrm( dst_, src_ );
+        }
+        void neg( reg_t r_ )  { unary( 3, r_ ); }
+        void idiv( reg_t r_ ) { unary( 7, r_ ); }
+        void cqo( void )      { byte( 0x48 ); byte( 0x99 ); }
+        void inc( reg_t r_ )  { rex( RAX, r_ ); byte( 0xFF ); modrm( RAX, r_ ); }
+        /// `shr rcx, 1`.
+        void shr1_rcx( void ) { byte( 0x48 ); byte( 0xD1 ); byte( 0xE9 ); }
+        /// `test cl, 1`.
+        void test1_cl( void ) { byte( 0xF6 ); byte( 0xC1 ); byte( 0x01 ); }
+        /// `mov r_, imm_` (sign extended).
+        void mov_imm( reg_t r_, std::int32_t imm_ )
+        {
+            rex( RAX, r_ );
+            byte( 0xC7 );
+            modrm( RAX, r_ );
+            imm32( imm_ );
+        }
+        /// `cmp r_, imm_` (sign extended).
+        void cmp_imm8( reg_t r_, std::int8_t imm_ )
+        {
+            rex( RAX, r_ );
+            byte( 0x83 );
+            modrm( reg_t( 7 ), r_ );
+            byte( std::uint8_t( imm_ ) );
+        }
+        /// `mov dst_, [base_ + disp_]`.
+        void load( reg_t dst_, reg_t base_, std::int32_t disp_ )
+        {
+            rex( dst_, base_ );
+            byte( 0x8B );
+            byte( 0x80 | ( dst_ & 7 ) << 3 | ( base_ & 7 ) ); // mod = 10: disp32 (base_ is neither RSP nor R12).
+            imm32( disp_ );
+        }
+        /// `mov dst_, [base_ + index_ * 8]`.
+        void load_indexed( reg_t dst_, reg_t base_, reg_t index_ ) { indexed( 0x8B, dst_, base_, index_ ); }
+        /// `mov [base_ + disp_], src_`.
+        void store( reg_t base_, std::int8_t disp_, reg_t src_ )
+        {
+            rex( src_, base_ );
+            byte( 0x89 );
+            byte( 0x40 | ( src_ & 7 ) << 3 | ( base_ & 7 ) ); // mod = 01: disp8 (base_ is neither RSP nor R12).
+            byte( std::uint8_t( disp_ ) );
+        }
+        /// `mov qword [base_ + disp_], imm_` (sign extended).
+        void store_imm( reg_t base_, std::int8_t disp_, std::int32_t imm_ )
+        {
+            rex( RAX, base_ );
+            byte( 0xC7 );
+            byte( 0x40 | ( base_ & 7 ) );
+            byte( std::uint8_t( disp_ ) );
+            imm32( imm_ );
+        }
+        /// `add r_, imm_` (sign extended).
+        void add_imm8( reg_t r_, std::int8_t imm_ )
+        {
+            rex( RAX, r_ );
+            byte( 0x83 );
+            modrm( RAX, r_ );
+            byte( std::uint8_t( imm_ ) );
+        }
+        void push( reg_t r_ ) { if ( r_ >= R8 ) byte( 0x41 ); byte( 0x50 + ( r_ & 7 ) ); }
+        void pop( reg_t r_ )  { if ( r_ >= R8 ) byte( 0x41 ); byte( 0x58 + ( r_ & 7 ) ); }
+        void ret( void )      { byte( 0xC3 ); }
+
+        /// Jumps to `target_` (already emitted).
+        void jmp_back( std::size_t target_ ) { patch( jmp(), target_ ); }
+        /// Emits a jump if `cc_`, to be patched; returns where its displacement is.
+        std::size_t jcc( cond_t cc_ ) { byte( 0x0F ); byte( 0x80 | cc_ ); return disp(); }
+        /// Emits a jump, to be patched; returns where its displacement is.
+        std::size_t jmp( void ) { byte( 0xE9 ); return disp(); }
+        /// Makes the jump whose displacement is at `at_` go to `target_`.
+        void patch( std::size_t at_, std::size_t target_ )
+        {
+            std::int32_t rel = std::int32_t( target_ - ( at_ + 4 ) );
+            std::memcpy( code.data() + at_, &rel, 4 );
+        }
+
+    private:
+        void byte( std::uint8_t b_ ) { code.push_back( b_ ); }
+        void imm32( std::int32_t v_ )
+        {
+            for ( int i{0} ; i < 4 ; ++i ) byte( std::uint8_t( std::uint32_t( v_ ) >> ( 8 * i ) ) );
+        }
+        std::size_t disp( void ) { imm32( 0 ); return code.size() - 4; }
+        /// REX.W prefix, with the high bits of the registers in ModRM.reg and ModRM.rm.
+        void rex( reg_t reg_, reg_t rm_ ) { byte( 0x48 | ( reg_ >= R8 ? 4 : 0 ) | ( rm_ >= R8 ? 1 : 0 ) ); }
+        /// ModRM for two registers.
+        void modrm( reg_t reg_, reg_t rm_ ) { byte( 0xC0 | ( reg_ & 7 ) << 3 | ( rm_ & 7 ) ); }
+        void rr( std::uint8_t op_, reg_t dst_, reg_t src_ ) { rex( src_, dst_ ); byte( op_ ); modrm( src_, dst_ ); }
+        void unary( std::uint8_t ext_, reg_t r_ ) { rex( RAX, r_ ); byte( 0xF7 ); modrm( reg_t( ext_ ), r_ ); }
+        void indexed( std::uint8_t op_, reg_t reg_, reg_t base_, reg_t index_ )
+        {
+            byte( 0x48 | ( reg_ >= R8 ? 4 : 0 ) | ( index_ >= R8 ? 2 : 0 ) | ( base_ >= R8 ? 1 : 0 ) );
+            byte( op_ );
+            byte( ( reg_ & 7 ) << 3 | 4 );                           // mod = 00, rm = 100: a SIB follows.
+            byte( 0xC0 | ( index_ & 7 ) << 3 | ( base_ & 7 ) );      // scale = 8 (base_ is neither RBP nor R13).
+        }
+};
+
+} // namespace
+
+JitProgram::~JitProgram()
+{
+    clear();
+}
+
+/// Unmaps the code, if there is any.
+void JitProgram::clear( void )
+{
+    if ( memory != nullptr ) ::munmap( memory, memory_size );
+    memory = nullptr;
+    memory_size = 0;
+    entry = nullptr;
+}
+
+bool JitProgram::available( void )
+{
+#if defined(__x86_64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*!
+ * Generates the code, which follows the System V calling convention:
+ *
+ *     rdi = columns, rsi = first (the current row), rdx = last, rcx = results (of row `first`)
+ *
+ * `last` and `results` are moved to r8 and r9, so that rax, rcx and rdx are free for
+ * "idiv" and "^"; the stack slots are in the registers of STACK.  Every check that fails
+ * jumps to the exit with the current row in rsi, which is what the function returns.
+ *
+ * @param program_ a program emitted by the Parser (with variables turned on).
+ * @return true if the code is ready; false if this program (or this machine) is not supported.
+ */
+bool JitProgram::compile( const Program & program_ )
+{
+    clear();
+    if ( not available() or program_.empty() or program_.get_max_depth() > MAX_DEPTH )
+        return false;
+
+    const auto & code = program_.get_code();
+    Assembler a;
+    a.code.reserve( 64 + 64 * code.size() ); // "^" is the longest: about 60 bytes for 1 byte of bytecode.
+    std::vector< std::size_t > to_exit;      // Jumps to the exit, to be patched.
+    to_exit.reserve( 1 + 2 * code.size() );
+
+    for ( reg_t r : SAVED ) a.push( r );
+    a.mov( R8, RDX );
+    a.mov( R9, RCX );
+
+    std::size_t top = a.here();
+    a.cmp( RSI, R8 );
+    to_exit.push_back( a.jcc( CC_AE ) );
+
+    std::size_t depth = 0;
+    for ( std::size_t pc{0} ; pc < code.size() ; )
+    {
+        auto op = code[ pc++ ];
+        if ( op == Program::OP_PUSH or op == Program::OP_LOAD )
+        {
+            int arg = code[pc] | ( code[pc+1] << 8 );
+            pc += 2;
+            reg_t r = STACK[ depth++ ];
+            if ( op == Program::OP_PUSH ) a.mov_imm( r, static_cast< Program::immediate_type >( arg ) );
+            else
+            {
+                a.load( RCX, RDI, std::int32_t( arg * sizeof( value_type * ) ) ); // The column...
+                a.load_indexed( r, RCX, RSI );                                     // ... and the row.
+            }
+            continue;
+        }
+
+        reg_t rhs = STACK[ --depth ];
+        reg_t lhs = STACK[ depth - 1 ];
+        switch ( op )
+        {
+            case Program::OP_ADD:
+                a.add( lhs, rhs );
+                to_exit.push_back( a.jcc( CC_O ) );
+                break;
+            case Program::OP_SUB:
+                a.sub( lhs, rhs );
+                to_exit.push_back( a.jcc( CC_O ) );
+                break;
+            case Program::OP_MUL:
+                a.imul( lhs, rhs );
+                to_exit.push_back( a.jcc( CC_O ) );
+                break;
+            case Program::OP_DIV:
+            case Program::OP_MOD:
+            {
+                a.test( rhs, rhs );
+                to_exit.push_back( a.jcc( CC_E ) );
+                // Dividing by -1 is a negation ("idiv" would trap on the smallest value).
+                a.cmp_imm8( rhs, -1 );
+                auto not_minus_one = a.jcc( CC_NE );
+                if ( op == Program::OP_DIV )
+                {
+                    a.neg( lhs );
+                    to_exit.push_back( a.jcc( CC_O ) );
+                }
+                else a.xor_( lhs, lhs );
+                auto done = a.jmp();
+                a.patch( not_minus_one, a.here() );
+                a.mov( RAX, lhs );
+                a.cqo();
+                a.idiv( rhs );
+                a.mov( lhs, op == Program::OP_DIV ? RAX : RDX );
+                a.patch( done, a.here() );
+                break;
+            }
+            case Program::OP_POW:
+            {
+                // Negative exponents are left to the VM; otherwise the same squaring as arithmetic::pow.
+                a.test( rhs, rhs );
+                to_exit.push_back( a.jcc( CC_S ) );
+                a.mov( RCX, rhs );
+                a.mov( RDX, lhs );
+                a.mov_imm( RAX, 1 );
+                std::size_t loop = a.here();
+                a.test1_cl();
+                auto even = a.jcc( CC_E );
+                a.imul( RAX, RDX );
+                to_exit.push_back( a.jcc( CC_O ) );
+                a.patch( even, a.here() );
+                a.shr1_rcx();
+                auto done = a.jcc( CC_E );
+                a.imul( RDX, RDX );
+                to_exit.push_back( a.jcc( CC_O ) );
+                a.jmp_back( loop );
+                a.patch( done, a.here() );
+                a.mov( lhs, RAX );
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // results[row] = VM::ResultType( OK, value ).
+    a.store_imm( R9, offsetof( VM::ResultType, type ), VM::ResultType::OK );
+    a.store( R9, offsetof( VM::ResultType, value ), STACK[0] );
+    a.store_imm( R9, offsetof( VM::ResultType, at_col ), 0 );
+    a.add_imm8( R9, sizeof( VM::ResultType ) );
+    a.inc( RSI );
+    a.jmp_back( top );
+
+    std::size_t exit = a.here();
+    for ( auto at : to_exit ) a.patch( at, exit );
+    a.mov( RAX, RSI );
+    for ( auto r = std::end( SAVED ) ; r != std::begin( SAVED ) ; ) a.pop( *--r );
+    a.ret();
+
+    // Write the code, then make it executable (and read only).
+    std::size_t page = 4096;
+    memory_size = ( a.code.size() + page - 1 ) / page * page;
+    memory = ::mmap( nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( memory == MAP_FAILED )
+    {
+        memory = nullptr;
+        memory_size = 0;
+        return false;
+    }
+    std::memcpy( memory, a.code.data(), a.code.size() );
+    if ( ::mprotect( memory, memory_size, PROT_READ | PROT_EXEC ) != 0 )
+    {
+        clear();
+        return false;
+    }
+    entry = reinterpret_cast< entry_t >( memory );
+    return true;
+}
+
+/*!
+ * Evaluates the program for every row, with the native code if it has been compiled
+ * (otherwise with the VM, one row at a time).
+ *
+ * @param program_ the program given to compile().
+ * @param columns_ one array of `n_rows_` values per variable of the program.
+ * @param n_rows_ number of rows.
+ * @param results_ receives the result of each row, the same VM::run() would give.
+ */
+void JitProgram::run( const Program & program_, const value_type * const * columns_, size_type n_rows_,
+                      VM::ResultType * results_ )
+{
+    row.resize( program_.get_n_variables() );
+    auto run_row = [&]( size_type r_ ) {
+        for ( size_type v{0} ; v < row.size() ; ++v ) row[v] = columns_[v][r_];
+        results_[r_] = vm.run( program_, row.data() );
+    };
+
+    if ( not is_compiled() )
+    {
+        for ( size_type r{0} ; r < n_rows_ ; ++r ) run_row( r );
+        return;
+    }
+
+    for ( size_type first{0} ; first < n_rows_ ; )
+    {
+        size_type stop = entry( columns_, first, n_rows_, results_ + first );
+        if ( stop == n_rows_ ) break;
+        run_row( stop ); // Once more, slowly.
+        first = stop + 1;
+    }
+}
@@ -1,37 +1,28 @@
 #include "../include/parser.h"
+#include "../include/bigint.h"
 #include <iterator>
 #include <algorithm>
+#include <cctype>   // std::isalpha, std::isalnum
 
 /// Converts the input character c_ into its corresponding terminal symbol code.
 Parser::terminal_symbol_t  Parser::lexer( char c_ ) const
 {
-    switch( c_ )
-    {
-        case '-': return terminal_symbol_t::TS_MINUS;
-        case '+':
-        case '^':
-        case '*':
-        case '%':
-        case '/':  return terminal_symbol_t::TS_OPERATOR;
-        case '(':  return terminal_symbol_t::TS_OP_SCOPE;
-        case ')':  return terminal_symbol_t::TS_CL_SCOPE;
-        case ' ':  return terminal_symbol_t::TS_WS;
-        case   9:  return terminal_symbol_t::TS_TAB;
-        case '0':  return terminal_symbol_t::TS_ZERO;
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':  return terminal_symbol_t::TS_NON_ZERO_DIGIT;
-        case '\0': return terminal_symbol_t::TS_EOS; // end of string: the $ terminal symbol
-    }
-    return terminal_symbol_t::TS_INVALID;
+    return static_cast< terminal_symbol_t >( Scanner::classify( c_ ) );
+}
+
+/// Whether the integer of absolute value `magnitude_` (negative if `negative_`) fits in a type whose smallest value is `-limit_`.
+template < typename U >
+static bool in_range( U magnitude_, bool negative_, U limit_ )
+{
+    return magnitude_ < limit_ or ( negative_ and magnitude_ == limit_ );
 }
-Parser::ResultType saida;
+
+/// Creates a view of the source expression delimited by the two iterators.
+static std::string_view make_view( std::string_view::const_iterator first_, std::string_view::const_iterator last_ )
+{
+    return std::string_view( &*first_, std::distance( first_, last_ ) );
+}
+
 /// Consumes a valid character from the input source expression.
 void Parser::next_symbol( void )
 {
@@ -47,12 +38,19 @@ bool Parser::end_input( void ) const
     return it_curr_symb == expr.end();
 }
 
+/// Returns the offset of the current character inside the expression.
+std::size_t Parser::position( void ) const
+{
+    return std::distance( expr.begin(), it_curr_symb );
+}
+
 /// Returns the result of trying to match the current character with c_, **without** consuming the current character from the input expression.
 bool Parser::peek( terminal_symbol_t c_ ) const
 {
     // Checks whether the input symbol is equal to the argument symbol.
-    return ( not end_input() and
-             lexer( *it_curr_symb ) == c_ );
+    // The classes were computed by parse(), with a TS_EOS sentinel at the end, so
+    // there is no need to check for the end of the input.
+    return classes[ position() ] == static_cast< std::uint8_t >( c_ );
 }
 
 /// Returns the result of trying to match (peek()) and consume the current character with c_.
@@ -87,68 +85,169 @@ bool Parser::expect( terminal_symbol_t c_ )
 /// Ignores any white space or tabs in the expression until reach a valid character or end of input.
 void Parser::skip_ws( void )
 {
-    // Skip white spaces, while at the same time, check for end of string.
-    while ( not end_input() and
-            ( lexer( *it_curr_symb ) == Parser::terminal_symbol_t::TS_WS  or
-              lexer( *it_curr_symb ) == Parser::terminal_symbol_t::TS_TAB ) )
-    {
-        next_symbol();
-    }
+    // Skip a whole run of white spaces at once (the scanner stops at the end of string).
+    const char * first = expr.data() + position();
+    const char * next = Scanner::skip_ws( first, expr.data() + expr.size() );
+    std::advance( it_curr_symb, next - first );
+}
+
+
+
+/// Records a token, unless the client asked us not to keep them.
+void Parser::add_token( std::string_view::const_iterator first_, std::string_view::const_iterator last_,
+                        Token::token_t type_, TokenView::number_type number_ )
+{
+    if ( keep_tokens )
+        token_list.emplace_back( TokenView( make_view( first_, last_ ), type_, number_ ) );
+}
+
+/// Takes `e_` as the expression to parse, from its beginning.
+/*!
+ * The classes of the first `classified_` characters must be those already computed (the
+ * characters did not change); the rest are computed here.
+ */
+void Parser::start( std::string_view e_, std::size_t classified_ )
+{
+    expr = e_; //  Guarda (uma janela para) a expressão no membro correspondente.
+    it_curr_symb = expr.begin(); // Define o simbolo inicial a ser processado.
+
+    // Classifica todos os caracteres de uma vez (o vetor só cresce, nunca encolhe).
+    if ( classes.size() < expr.size() + 1 )
+        classes.resize( expr.size() + 1 );
+    Scanner::classify( expr.data() + classified_, expr.data() + expr.size(), classes.data() + classified_ );
+    classes[ expr.size() ] = CC_EOS;
+}
+
+/// Records the state of the parser at the start of a term, unless the last checkpoint is too close.
+/*!
+ * Each checkpoint keeps a copy of the pending operators, so a new one is only taken once
+ * there have been at least as many characters since the last one as operators to copy:
+ * all the copies together are never longer than the expression.
+ */
+void Parser::save_checkpoint( size_type depth_ )
+{
+    auto pos = position();
+    if ( not checkpoints.empty() and
+         pos - checkpoints.back().position < std::max( CHECKPOINT_SPACING, operators.size() ) )
+        return;
+
+    saved_operators.insert( saved_operators.end(), operators.begin(), operators.end() );
+    checkpoints.push_back( Checkpoint{ pos, depth_, token_list.size(), variables.size(), program.mark(),
+                                       saved_operators.size() } );
+}
+
+/// Skips all white spaces and consumes the next character if it is one of the operators in `ops_`.
+/*!
+ * @param ops_ the operators accepted at this point of the grammar.
+ * @param op_ receives the operator consumed, if any.
+ * @return true if an operator has been consumed; false otherwise.
+ */
+bool Parser::accept_operator( std::string_view ops_, char & op_ )
+{
+    skip_ws();
+    if ( end_input() or ops_.find( *it_curr_symb ) == std::string_view::npos )
+        return false;
+
+    op_ = *it_curr_symb;
+    auto begin_token( it_curr_symb );
+    next_symbol();
+    add_token( begin_token, it_curr_symb, Token::token_t::OPERATOR );
+    return true;
 }
 
 
+/// Emits, in postfix order, the pending operators of the innermost open scope that must
+/// be applied before `op_` (all of them when `op_` is zero).
+void Parser::reduce( char op_ )
+{
+    while ( not operators.empty() and operators.back().symbol != '(' )
+    {
+        const auto & top = operators.back();
+        // "^" is right associative: a pending "^" waits for the next one.
+        if ( op_ != 0 and not grammar::applies_before( top.symbol, op_ ) )
+            break;
+        program.emit_operator( top.symbol, top.column );
+        operators.pop_back();
+    }
+}
 
 //=== Non Terminal Symbols (NTS) methods.
 
 /// Validates (i.e. returns true or false) and consumes an expression from the input string.
-/*! This method parses a valid expression from the input and, at the same time, it tokenizes its components.
+/*! This method parses a valid expression from the input and, at the same time, it tokenizes its components
+ *  and emits the corresponding postfix code.
  *
- * Production rule is:
+ * Production rules are:
  * ```
- *  <expr> := <term>,{ ("+"|"-"),<term> };
+ *  <expr>    := <product>,{ ("+"|"-"),<product> };
+ *  <product> := <power>,{ ("*"|"/"|"%"),<power> };
+ *  <power>   := <term>,[ "^",<power> ];
+ *  <term>    := "(",<expr>,")" | <integer>;
  * ```
- * An expression might be just a term or one or more terms with '+'/'-' between them.
+ * There is no recursion: the operators waiting for their right operand, and the "(" of the
+ * scopes still open, are kept in `operators` (operator precedence parsing).  Each operator is
+ * emitted as soon as both of its operands are in the program, which gives the same program,
+ * the same tokens and the same errors (and columns) as a recursive descent over the rules
+ * above, in linear time and constant call stack, however long or deeply nested the input is.
+ * Only the nesting of parentheses is limited, by set_max_depth().
+ *
+ * @param depth_ the number of scopes open (their "(" are in `operators`), when resuming.
  */
-Parser::ResultType Parser::expression()
-{
-    //ResultType result;
-    // TODO: implementar esta função.
-
-    auto result = term();
-    if(result.type == ResultType::OK){
-      skip_ws();
-      auto begin_token(it_curr_symb);
-      if(is_operator() or is_minus()){
-        std::string token_str;
-        std::copy( begin_token, it_curr_symb, std::back_inserter( token_str ) );
-        token_list.emplace_back( Token( token_str, Token::token_t::OPERATOR) );
-        if( end_input()){
-          return ResultType(ResultType::MISSING_TERM, std::distance(expr.begin(), it_curr_symb));
-        }
-        if( is_operator()){
-          return ResultType(ResultType::ILL_FORMED_INTEGER, std::distance(expr.begin(), it_curr_symb));
+Parser::ResultType Parser::expression( size_type depth_ )
+{
+    size_type depth = depth_; // Number of scopes open.
+
+    for (;;)
+    {
+        if ( incremental )
+            save_checkpoint( depth );
+
+        // Expecting a term: any number of "(" and then an integer.
+        skip_ws();
+        auto begin_token( it_curr_symb );
+        if ( not end_input() and is_op_scope() )
+        {
+            if ( max_depth != 0 and depth == max_depth )
+                return ResultType( ResultType::NESTING_TOO_DEEP, std::distance( expr.begin(), begin_token ) );
+            add_token( begin_token, it_curr_symb, Token::token_t::OP_SCOPE );
+            operators.push_back( Pending{ '(', position() - 1 } );
+            ++depth;
+            continue;
         }
-        result = expression();
-      }
-    }
 
-    if(result.type != 0 ){
-      saida = result;
-    }
-    if(saida.type == 0){
-        return saida;
+        auto result = term();
+        if ( result.type != ResultType::OK )
+            return result;
+
+        // After a term: an operator, a ")" or the end of the (sub)expression.
+        for (;;)
+        {
+            char op;
+            if ( accept_operator( grammar::OPERATORS, op ) )
+            {
+                // Both operands of the stronger operators on the left are in the program.
+                reduce( op );
+                operators.push_back( Pending{ op, position() - 1 } );
+                break;
+            }
+
+            reduce( 0 ); // The innermost (sub)expression ends here.
+            if ( operators.empty() )
+                return ResultType( ResultType::OK );
+
+            auto next_token( it_curr_symb );
+            if ( not is_cl_scope() )
+                return ResultType( ResultType::MISSING_CLOSING, std::distance( expr.begin(), it_curr_symb ) );
+            add_token( next_token, it_curr_symb, Token::token_t::CL_SCOPE );
+            operators.pop_back();
+            --depth;
+        }
     }
-    return result;
 }
 
 /// Validates (i.e. returns true or false) and consumes a term from the input string.
-/*! This method parses a valid term from the input.
- *
- * Production rule is:
- * ```
- *  <term> := <integer>;
- * ```
- * A term is made of a single integer.
+/*! The "(" of a term are handled by expression(), so here a term is a single integer
+ *  (or a variable, if they are turned on).
  *
  * @return true if a term has been successfuly parsed from the input; false otherwise.
  */
@@ -158,59 +257,113 @@ Parser::ResultType Parser::term()
     // Guarda o início do termo no input, para possíveis mensagens de erro.
     auto begin_token( it_curr_symb );
     ResultType result;
-    if(is_op_scope()){
-      std::string token_str;
-      std::copy( begin_token, it_curr_symb, std::back_inserter( token_str ) );
-      token_list.emplace_back( Token( token_str, Token::token_t::OP_SCOPE) );
-      result = expression();
-      auto next_token (it_curr_symb);
-      if(is_cl_scope()){
-        std::string token_str_scope;
-        std::copy( next_token, it_curr_symb, std::back_inserter( token_str_scope ) );
-        token_list.emplace_back( Token( token_str_scope, Token::token_t::CL_SCOPE) );
-      }else{
-        return ResultType(ResultType::MISSING_CLOSING, std::distance(expr.begin(), it_curr_symb));
-      }
+    if ( end_input() ){
+      return ResultType(ResultType::MISSING_TERM, std::distance(expr.begin(), it_curr_symb));
     }else if(is_operator()){
       return ResultType(ResultType::ILL_FORMED_INTEGER, std::distance(expr.begin(), it_curr_symb));
+    }else if( allow_variables and ( std::isalpha( static_cast< unsigned char >( *it_curr_symb ) ) or *it_curr_symb == '_' ) ){
+      return variable();
+    }
+    else if ( width != grammar::width_t::W16 ){
+      return wide_integer( begin_token );
     }
     else{
-      auto begin_token( it_curr_symb );
-      auto result =  integer();
+      // O valor é acumulado enquanto os dígitos são lidos (uma única passada).
+      constexpr unsigned long long limit = -static_cast< long long >( std::numeric_limits< required_int_type >::min() );
+      unsigned long long magnitude = 0;
+      bool negative = false;
+      result =  integer( magnitude, negative, limit );
       // Vamos tokenizar o inteiro, se ele for bem formado.
       if ( result.type == ResultType::OK )
       {
-          // Copiar a substring correspondente para uma variável string.
-          std::string token_str;
-          std::copy( begin_token, it_curr_symb, std::back_inserter( token_str ) );
-          // Tentar realizar a conversão de string para inteiro (usar stoll()).
-          input_int_type token_int;
-          // std::cout << token_str << " parser"<< std::endl;
-          try { token_int = stoll( token_str ); }
-          catch( const std::invalid_argument & e )
-          {
-              return ResultType( ResultType::ILL_FORMED_INTEGER,
-                                 std::distance( expr.begin(), begin_token ) );
-          }
-
           // Recebemos um inteiro válido, resta saber se está dentro da faixa.
-          if ( token_int < std::numeric_limits< required_int_type >::min() or
-                  token_int > std::numeric_limits< required_int_type >::max() )
+          if ( not in_range( magnitude, negative, limit ) )
           {
               // Fora da faixa, reportar erro.
               return ResultType( ResultType::INTEGER_OUT_OF_RANGE,
                                  std::distance( expr.begin(), begin_token ) );
           }
-          // Coloca o novo token na nossa lista de tokens.
-          token_list.emplace_back( Token( token_str, Token::token_t::OPERAND ) );
+          input_int_type token_int = negative ? -input_int_type( magnitude ) : input_int_type( magnitude );
+          // Coloca o novo token na nossa lista de tokens e o operando no programa.
+          add_token( begin_token, it_curr_symb, Token::token_t::OPERAND, token_int );
+          program.emit_push( static_cast< Program::immediate_type >( token_int ) );
       }
     }
 
     return result;
 }
 
+/*!
+ * Consumes an integer of one of the widths other than W16 (see set_width()), and emits the
+ * narrowest instruction that pushes it: `OP_PUSH`, `OP_PUSH64` or, for the constants that
+ * do not fit in 64 bits, `OP_LITERAL` with its digits.
+ *
+ * @param begin_token_ where the integer starts.
+ * @return OK, or the error of integer(), or INTEGER_OUT_OF_RANGE if it does not fit in the width.
+ */
+Parser::ResultType Parser::wide_integer( std::string_view::const_iterator begin_token_ )
+{
+    typedef unsigned __int128 magnitude_type;
+    // The magnitude of the smallest value of the width (BIG keeps the larger ones as digits).
+    const magnitude_type limit = magnitude_type( 1 ) << ( width == grammar::width_t::W32 ? 31 :
+                                                          width == grammar::width_t::W64 ? 63 : 127 );
+    magnitude_type magnitude = 0;
+    bool negative = false;
+    auto result = integer( magnitude, negative, limit );
+    if ( result.type != ResultType::OK )
+        return result;
+
+    auto digits = make_view( begin_token_, it_curr_symb );
+    bool fits = in_range( magnitude, negative, limit );
+    if ( not fits and ( width != grammar::width_t::BIG or digits.size() - negative > BIG_MAX_DIGITS ) )
+        return ResultType( ResultType::INTEGER_OUT_OF_RANGE, std::distance( expr.begin(), begin_token_ ) );
+
+    // The low 64 bits, with the sign.
+    auto bits = static_cast< std::uint64_t >( magnitude );
+    auto value = static_cast< std::int64_t >( negative ? -bits : bits );
+    add_token( begin_token_, it_curr_symb, Token::token_t::OPERAND, value );
+    if ( fits and in_range( magnitude, negative, magnitude_type( 1 ) << 15 ) )
+        program.emit_push( static_cast< Program::immediate_type >( value ) );
+    else if ( fits and in_range( magnitude, negative, magnitude_type( 1 ) << 63 ) )
+        program.emit_push64( value );
+    else
+        program.emit_literal( digits );
+    return result;
+}
+
+/// Validates (i.e. returns true or false) and consumes a variable from the input string.
+/*! Production rule is:
+ * ```
+ * <variable> := <letter>,{ <letter> | <digit> };
+ * ```
+ * The first time a name shows up it gets the next index; the program loads it by index.
+ *
+ * @return OK, or INTEGER_OUT_OF_RANGE if there are more variables than a program can index.
+ */
+Parser::ResultType Parser::variable()
+{
+    auto begin_token( it_curr_symb );
+    while ( not end_input() and
+            ( std::isalnum( static_cast< unsigned char >( *it_curr_symb ) ) or *it_curr_symb == '_' ) )
+        next_symbol();
+
+    auto name = make_view( begin_token, it_curr_symb );
+    auto it = std::find( variables.begin(), variables.end(), name );
+    auto index = std::distance( variables.begin(), it );
+    if ( it == variables.end() )
+    {
+        if ( variables.size() > std::numeric_limits< std::uint16_t >::max() )
+            return ResultType( ResultType::INTEGER_OUT_OF_RANGE, std::distance( expr.begin(), begin_token ) );
+        variables.emplace_back( name );
+    }
+
+    add_token( begin_token, it_curr_symb, Token::token_t::VARIABLE );
+    program.emit_load( static_cast< std::uint16_t >( index ) );
+    return ResultType( ResultType::OK );
+}
+
 /// Validates (i.e. returns true or false) and consumes an integer from the input string.
-/*! This method parses a valid integer from the input and, at the same time, add the integer to the token list.
+/*! This method parses a valid integer from the input and, at the same time, computes its value.
  *
  * Production rule is:
  * ```
@@ -218,37 +371,62 @@ Parser::ResultType Parser::term()
  * ```
  * A integer might be a zero or a natural number, which, in turn, might begin with an unary minus.
  *
+ * @param magnitude_ receives the absolute value (see natural_number() for values out of range).
+ * @param negative_ receives whether there is a minus.
+ * @param limit_ the largest magnitude of interest (see natural_number()).
  * @return true if an integer has been successfuly parsed from the input; false otherwise.
  */
-Parser::ResultType Parser::integer()
+template < typename U >
+Parser::ResultType Parser::integer( U & magnitude_, bool & negative_, U limit_ )
 {
     // Se aceitarmos um zero, então o inteiro acabou aqui.
+    magnitude_ = 0;
+    negative_ = false;
     if ( accept( terminal_symbol_t::TS_ZERO ) )
         return ResultType( ResultType::OK );
 
     // Vamos tentar aceitar o '-'.
-    accept( terminal_symbol_t::TS_MINUS );
-    return  natural_number();
+    negative_ = accept( terminal_symbol_t::TS_MINUS );
+    return natural_number( magnitude_, limit_ );
 }
 
 /// Validates (i.e. returns true or false) and consumes a natural number from the input string.
-/*! This method parses a valid natural number from the input.
+/*! This method parses a valid natural number from the input, accumulating its value as the
+ *  digits are consumed.  As soon as the next digit would take the value above `limit_` we
+ *  stop counting (so that arbitrarily long digit runs cannot overflow `U`) and the remaining
+ *  digits are skipped at once: the caller only needs to know that it is out of range.
  *
  * Production rule is:
  * ```
  * <natural_number> := <digit_excl_zero>,{<digit>};
  * ```
  *
+ * @param value_ receives the value, or `limit_ + 1` if it is larger than `limit_`.
+ * @param limit_ the largest value of interest (`limit_ + 1` must fit in `U`).
  * @return true if a natural number has been successfuly parsed from the input; false otherwise.
  */
-Parser::ResultType Parser::natural_number()
+template < typename U >
+Parser::ResultType Parser::natural_number( U & value_, U limit_ )
 {
     // Tem que vir um número que não seja zero! (de acordo com a definição).
     if ( not digit_excl_zero() )
         return ResultType( ResultType::ILL_FORMED_INTEGER, std::distance( expr.begin(), it_curr_symb ) ) ;
 
-    // Cosumir os demais dígitos, se existirem...
-    while( digit() ) /* empty */ ;
+    // Acumula os demais dígitos, enquanto o valor estiver na faixa.
+    value_ = *std::prev( it_curr_symb ) - '0';
+    while ( value_ <= limit_ / 10 and digit() )
+        value_ = value_ * 10 + ( *std::prev( it_curr_symb ) - '0' );
+
+    if ( peek( terminal_symbol_t::TS_ZERO ) or peek( terminal_symbol_t::TS_NON_ZERO_DIGIT ) )
+    {
+        // Fora da faixa (mais um dígito passaria do limite): consumir os dígitos restantes de uma vez só.
+        const char * first = expr.data() + position();
+        const char * next = Scanner::skip_digits( first, expr.data() + expr.size() );
+        std::advance( it_curr_symb, next - first );
+        value_ = limit_ + 1;
+    }
+    else if ( value_ > limit_ )
+        value_ = limit_ + 1;
 
     return ResultType( ResultType::OK );
 }
@@ -296,11 +474,6 @@ bool Parser::is_operator(){
   return( accept(terminal_symbol_t::TS_OPERATOR)) ? true : false;
 }
 
-bool Parser::is_minus(){
-
-  return( accept(terminal_symbol_t::TS_MINUS)) ? true : false;
-}
-
 bool Parser::is_op_scope(){
 
   return ( accept(terminal_symbol_t::TS_OP_SCOPE)) ? true : false;
@@ -313,59 +486,182 @@ bool Parser::is_cl_scope(){
 
 /*!
  * This is the parser's entry point.
- * This method tries to (recursivelly) validate an expression.
- * During this process, we also store the tokens into a container.
+ * This method tries to validate an expression.
+ * During this process, we also emit the postfix program (see get_program()) and,
+ * unless turned off with set_keep_tokens(), store the tokens into a container.
+ *
+ * The expression is not copied: it must outlive any use of the tokens returned by
+ * get_token_views().
  *
  * \param e_ The string with the expression to parse.
  * \return The parsing result.
  *
  * @see ResultType
  */
-Parser::ResultType  Parser::parse( std::string e_ )
+Parser::ResultType  Parser::parse( std::string_view e_ )
 {
-    expr = e_; //  Guarda a expressão no membro correspondente.
-    it_curr_symb = expr.begin(); // Define o simbolo inicial a ser processado.
-    ResultType result; // By default it's OK.
+    start( e_, 0 );
 
-    // Sempre limpamos a lista de tokens da rodada anterior.
+    // Sempre limpamos a lista de tokens e o programa da rodada anterior.
     token_list.clear();
+    program.clear();
+    variables.clear();
+    operators.clear();
+    checkpoints.clear();
+    saved_operators.clear();
 
     // Vamos verificar se recebemos uma  Let us ignore any leading white spaces.
     skip_ws();
     if ( end_input() ) // Premature end?
     {
-        result =  ResultType( ResultType::UNEXPECTED_END_OF_EXPRESSION,
+        return ResultType( ResultType::UNEXPECTED_END_OF_EXPRESSION,
                 std::distance( expr.begin(), it_curr_symb ) );
     }
-    else
+
+    // chamada regular para expressão.
+    return finish( expression( 0 ) );
+}
+
+/// After a valid expression, only white spaces may be left in the input.
+Parser::ResultType Parser::finish( ResultType result_ )
+{
+    // Verificar se ainda sobrou algo na expressão.
+    if ( result_.type == ResultType::OK )
     {
-        // chamada regular para expressão.
-        result = expression();
-        // Verificar se ainda sobrou algo na expressão.
-        if ( result.type == ResultType::OK )
+        // Neste momento não deveria ter nada sobrando na string, a não ser
+        // espaços em branco.
+        skip_ws(); // Vamos "consumir" os espaços em branco, se existirem....
+        if ( not end_input() ) // Se estiver tudo ok, deveríamos estar no final da string.
         {
-            // Neste momento não deveria ter nada sobrando na string, a não ser
-            // espaços em branco.
-            skip_ws(); // Vamos "consumir" os espaços em branco, se existirem....
-            if ( not end_input() ) // Se estiver tudo ok, deveríamos estar no final da string.
-            {
-                return ResultType( ResultType::EXTRANEOUS_SYMBOL, std::distance( expr.begin(), it_curr_symb) );
-            }
+            return ResultType( ResultType::EXTRANEOUS_SYMBOL, std::distance( expr.begin(), it_curr_symb) );
         }
     }
 
-    return result;
+    return result_;
+}
 
+/*!
+ * Parses an edited version of the expression parsed last, giving the same result, tokens
+ * and program as parse() would, but starting from the last checkpoint before the first
+ * change instead of from the beginning: the tokens, the program and the classes of the
+ * characters before it are kept.  Checkpoints are only recorded after set_incremental(),
+ * so, without them, this is just parse().
+ *
+ * The state at a checkpoint depends on the characters before it (and, for the first
+ * term, on the character at it), so only checkpoints before `unchanged_` are used.
+ *
+ * \param e_ the edited expression (it need not be at the same address as the last one).
+ * \param unchanged_ how many characters at the beginning of `e_` are the same as in the expression parsed last.
+ * \return The parsing result.
+ */
+Parser::ResultType Parser::reparse( std::string_view e_, std::size_t unchanged_ )
+{
+    unchanged_ = std::min( { unchanged_, e_.size(), expr.size() } );
+    auto it = std::lower_bound( checkpoints.begin(), checkpoints.end(), unchanged_,
+                                []( const Checkpoint & c_, std::size_t u_ ) { return c_.position < u_; } );
+    if ( it == checkpoints.begin() )
+        return parse( e_ );
+
+    // Volta ao estado do último checkpoint antes da mudança, e descarta os seguintes.
+    std::size_t k = std::distance( checkpoints.begin(), it ) - 1;
+    const Checkpoint cp = checkpoints[k];
+    operators.assign( saved_operators.begin() + ( k == 0 ? 0 : checkpoints[k-1].operators_end ),
+                      saved_operators.begin() + cp.operators_end );
+    checkpoints.resize( k + 1 );
+    saved_operators.resize( cp.operators_end );
+    program.rewind( cp.program );
+    variables.resize( cp.n_variables );
+    token_list.erase( token_list.begin() + cp.n_tokens, token_list.end() );
+
+    // The tokens kept are views into the expression: they follow it, if it moved.
+    if ( e_.data() != expr.data() )
+        for ( auto & t : token_list )
+            t.value = std::string_view( e_.data() + ( t.value.data() - expr.data() ), t.value.size() );
+
+    start( e_, cp.position );
+    std::advance( it_curr_symb, cp.position );
+    return finish( expression( cp.depth ) );
 }
 
 
-/// Return the list of tokens, which is the by-product created during the syntax analysis.
+/// Return a copy of the list of tokens, which is the by-product created during the syntax analysis.
 std::vector< Token >
 Parser::get_tokens( void ) const
+{
+    std::vector< Token > tokens;
+    tokens.reserve( token_list.size() );
+    for ( const auto & t : token_list )
+        tokens.push_back( t.to_token() );
+    return tokens;
+}
+
+/// Return the list of tokens (as views into the source expression) without copying it.
+const std::vector< TokenView > &
+Parser::get_token_views( void ) const
 {
     return token_list;
 }
 
+/// Return the postfix program emitted during the syntax analysis.
+const Program &
+Parser::get_program( void ) const
+{
+    return program;
+}
+
+/// Limits the nesting of parentheses to `max_depth_` levels (0 means no limit).
+void
+Parser::set_max_depth( size_type max_depth_ )
+{
+    max_depth = max_depth_;
+    checkpoints.clear();
+}
+
+static_assert( Parser::BIG_MAX_DIGITS * 3321929ull / 1000000 < BigInt::MAX_BITS, "log2(10) < 3.321929" );
+
+/*!
+ * With W16 (the default), constants must fit in 16 bits; with the other widths, in the
+ * type of the width (BIG takes any constant up to BIG_MAX_DIGITS digits).  The next parse
+ * starts from scratch.
+ */
+void
+Parser::set_width( grammar::width_t width_ )
+{
+    width = width_;
+    checkpoints.clear();
+}
+
+/// Turns variables on or off.
+void
+Parser::set_variables( bool allow_ )
+{
+    allow_variables = allow_;
+    checkpoints.clear();
+}
+
+/// Turns the checkpoints of reparse() on or off (the next parse starts from scratch).
+void
+Parser::set_incremental( bool on_ )
+{
+    incremental = on_;
+    checkpoints.clear();
+}
+
+/// Return the names of the variables of the last expression parsed.
+const std::vector< std::string > &
+Parser::get_variables( void ) const
+{
+    return variables;
+}
+
+/// Turns the recording of tokens on or off (the program is always emitted).
+void
+Parser::set_keep_tokens( bool keep_ )
+{
+    keep_tokens = keep_;
+    checkpoints.clear();
+}
+
 
 
 //==========================[ End of parse.cpp ]==========================//
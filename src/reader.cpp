@@ -1,21 +1,148 @@
 #include "../include/parser.h"
+#include "../include/stats.h"
+#include <cstring>    // std::memchr, std::memmove
+#include <cerrno>     // errno
+#include <fcntl.h>    // open
+#include <unistd.h>   // read, close
+#include <sys/mman.h> // mmap, madvise
+#include <sys/stat.h> // fstat
 
-std::vector<std::string> reader_file(char* filename){
+/// How much of an already read mapping we keep around before handing the pages back.
+static constexpr LineReader::size_type RELEASE_STEP = 64 << 20;
 
-  std::vector<std::string> expressions;
+/*!
+ * Opens the input and decides how to read it: regular (non empty) files are mapped,
+ * anything else is read in blocks.
+ *
+ * @param filename_ the path of the file, or `nullptr`/"-" for the standard input.
+ */
+LineReader::LineReader( const char * filename_ )
+{
+    if ( filename_ == nullptr or std::strcmp( filename_, "-" ) == 0 )
+    {
+        fd = STDIN_FILENO;
+    }
+    else
+    {
+        fd = ::open( filename_, O_RDONLY );
+        owns_fd = true;
+    }
+    if ( fd < 0 ) return;
+
+    struct stat info;
+    if ( ::fstat( fd, &info ) == 0 and S_ISREG( info.st_mode ) and info.st_size > 0 )
+    {
+        void * addr = ::mmap( nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( addr != MAP_FAILED )
+        {
+            map_begin = static_cast< const char * >( addr );
+            map_size = info.st_size;
+            // We go through it only once, from start to end: let the kernel read ahead.
+            ::madvise( addr, map_size, MADV_SEQUENTIAL );
+            return;
+        }
+    }
 
-  std::ifstream file (filename);
-  if(file.is_open()){
+    // Not mappable (pipe, terminal, empty file, ...): read it in blocks.
+    buffer.resize( BLOCK_SIZE );
+}
+
+LineReader::~LineReader()
+{
+    if ( map_begin != nullptr )
+        ::munmap( const_cast< char * >( map_begin ), map_size );
+    if ( owns_fd and fd >= 0 )
+        ::close( fd );
+}
 
-    std::string str;
-    while (std::getline(file, str))
+/*!
+ * Gets the next line of the input.
+ *
+ * @param line_ receives the line, without the '\n'; valid only until the next call.
+ * @return true if there was a line; false at the end of the input.
+ */
+bool LineReader::next( std::string_view & line_ )
+{
+    BARES_STAGE( READ );
+    if ( fd < 0 ) return false;
+    return map_begin != nullptr ? next_mapped( line_ ) : next_block( line_ );
+}
+
+/// Finds the next line inside the mapping.
+bool LineReader::next_mapped( std::string_view & line_ )
+{
+    if ( map_pos >= map_size ) return false;
+
+    // Give back the pages we are done with, so that memory use stays constant.
+    // They are read again from the file if someone still looks at them.
+    if ( map_pos - map_released >= RELEASE_STEP )
     {
-        expressions.push_back(str);
+        auto page = static_cast< size_type >( ::sysconf( _SC_PAGESIZE ) );
+        auto upto = ( map_pos / page ) * page;
+        ::madvise( const_cast< char * >( map_begin ) + map_released, upto - map_released, MADV_DONTNEED );
+        map_released = upto;
     }
-  }else{
-    std::cout<< "Wrong syntaxe, add the path of a file containing the expressions to be analyzed!\n";
-    std::exit(0);
-  }
 
-  return expressions;
+    const char * first = map_begin + map_pos;
+    auto left = map_size - map_pos;
+    auto eol = static_cast< const char * >( std::memchr( first, '\n', left ) );
+    size_type len = eol != nullptr ? eol - first : left;
+
+    line_ = std::string_view( first, len );
+    map_pos += len + 1;
+    return true;
+}
+
+/// Finds the next line inside the current block, reading more data as needed.
+bool LineReader::next_block( std::string_view & line_ )
+{
+    size_type scanned = 0; // Bytes after `buf_pos` already known not to hold a '\n'.
+    for (;;)
+    {
+        const char * first = buffer.data() + buf_pos;
+        auto eol = static_cast< const char * >(
+                std::memchr( first + scanned, '\n', buf_end - buf_pos - scanned ) );
+        if ( eol != nullptr )
+        {
+            line_ = std::string_view( first, eol - first );
+            buf_pos = eol - buffer.data() + 1;
+            return true;
+        }
+        scanned = buf_end - buf_pos;
+
+        if ( eof or not fill() )
+        {
+            // Last line, without the '\n' at the end.
+            if ( buf_pos == buf_end ) return false;
+            line_ = std::string_view( buffer.data() + buf_pos, buf_end - buf_pos );
+            buf_pos = buf_end;
+            return true;
+        }
+    }
+}
+
+/// Moves the incomplete line to the front of the buffer and reads the next block after it.
+bool LineReader::fill( void )
+{
+    if ( buf_pos != 0 )
+    {
+        std::memmove( buffer.data(), buffer.data() + buf_pos, buf_end - buf_pos );
+        buf_end -= buf_pos;
+        buf_pos = 0;
+    }
+    // A line longer than the buffer: make room for it.
+    if ( buf_end == buffer.size() )
+        buffer.resize( buffer.size() * 2 );
+
+    ssize_t n;
+    do n = ::read( fd, buffer.data() + buf_end, buffer.size() - buf_end );
+    while ( n < 0 and errno == EINTR );
+
+    if ( n <= 0 )
+    {
+        eof = true;
+        return false;
+    }
+    buf_end += n;
+    return true;
 }
@@ -0,0 +1,288 @@
+#include "../include/repl.h"
+#include "../include/report.h"
+#include <algorithm>   // std::min
+#include <cerrno>      // errno
+#include <termios.h>   // tcgetattr, tcsetattr
+#include <sys/ioctl.h> // ioctl, TIOCGWINSZ
+#include <unistd.h>    // read, write, isatty
+
+/// What is shown before the line.
+static constexpr std::string_view PROMPT = "bares> ";
+
+/// The parser keeps checkpoints, so that each edit only parses from the change on.
+Repl::Repl( const EvaluatorConfig & config_ )
+{
+    parser.set_keep_tokens( false );
+    parser.set_max_depth( config_.max_depth );
+    parser.set_incremental( true );
+}
+
+/*!
+ * Puts the terminal in raw mode (every key is read as soon as it is pressed, without
+ * echo) and edits lines until the user leaves; the terminal is then restored.
+ *
+ * Everything read at once (e.g. a paste) is applied before the line is checked and drawn
+ * again, so a long paste costs a single parse.
+ *
+ * @param in_fd_ the terminal the keys come from.
+ * @param out_fd_ where the prompt is drawn.
+ * @return false if `in_fd_` is not a terminal (nothing is done); true otherwise.
+ */
+bool Repl::run( int in_fd_, int out_fd_ )
+{
+    termios saved;
+    if ( not isatty( in_fd_ ) or tcgetattr( in_fd_, &saved ) != 0 )
+        return false;
+    termios raw = saved;
+    raw.c_iflag &= ~( ICRNL | IXON | BRKINT | INPCK | ISTRIP );
+    raw.c_lflag &= ~( ECHO | ICANON | ISIG | IEXTEN );
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if ( tcsetattr( in_fd_, TCSAFLUSH, &raw ) != 0 )
+        return false;
+
+    out_fd = out_fd_;
+    draw();
+    char buffer[ READ_SIZE ];
+    std::string typed; // Printable characters not inserted yet.
+    for ( bool more = true ; more ; )
+    {
+        auto n = ::read( in_fd_, buffer, sizeof( buffer ) );
+        if ( n < 0 and errno == EINTR ) continue;
+        if ( n <= 0 ) break;
+
+        for ( decltype( n ) i{0} ; more and i < n ; ++i )
+            more = key( buffer[i], typed );
+        insert( typed );
+        draw();
+    }
+
+    // Deixa o cursor abaixo do resultado da última linha.
+    screen.assign( line.empty() ? "\n" : "\n\n\n" );
+    send();
+    tcsetattr( in_fd_, TCSAFLUSH, &saved );
+    return true;
+}
+
+/*!
+ * The cursor goes after the text inserted.  Only what follows `first_` has to be parsed
+ * again; nothing is parsed until check().
+ *
+ * @param first_ offset of the first character replaced (at most the size of the line).
+ * @param count_ how many characters are replaced (0 only inserts).
+ * @param text_ what goes in their place (empty only erases).
+ */
+void Repl::edit( size_type first_, size_type count_, std::string_view text_ )
+{
+    first_ = std::min( first_, line.size() );
+    count_ = std::min( count_, line.size() - first_ );
+    if ( count_ == 0 and text_.empty() )
+        return;
+
+    line.replace( first_, count_, text_ );
+    unchanged = std::min( unchanged, first_ );
+    cursor = first_ + text_.size();
+    dirty = true;
+}
+
+/// @return the outcome of the line (a PARSE_ERROR with UNEXPECTED_END_OF_EXPRESSION if it is blank).
+const Outcome & Repl::check( void )
+{
+    if ( not dirty )
+        return outcome;
+
+    auto result = parser.reparse( line, unchanged );
+    if ( result.type == Parser::ResultType::OK )
+        outcome = make_outcome( vm.run( parser.get_program() ), parser.get_program() );
+    else
+        outcome = Outcome( Outcome::PARSE_ERROR, 0, result );
+    unchanged = line.size();
+    dirty = false;
+    return outcome;
+}
+
+/*!
+ * Printable characters (and tabs) are collected in `typed_` and inserted together, by
+ * the next key that is not one of them, or at the end of what was read.
+ *
+ * @param c_ the byte read.
+ * @param typed_ the printable characters not inserted yet.
+ * @return false if the user wants to leave.
+ */
+bool Repl::key( char c_, std::string & typed_ )
+{
+    switch ( escape )
+    {
+        case escape_t::ESC:
+            // "ESC [" e "ESC O" começam as sequências das setas, Home, End e Delete.
+            escape = ( c_ == '[' or c_ == 'O' ) ? escape_t::CSI : escape_t::NONE;
+            escape_args.clear();
+            return true;
+        case escape_t::CSI:
+            if ( ( c_ >= '0' and c_ <= '9' ) or c_ == ';' )
+                escape_args += c_;
+            else
+            {
+                escape = escape_t::NONE;
+                insert( typed_ );
+                control( c_ );
+            }
+            return true;
+        case escape_t::NONE:
+            break;
+    }
+
+    if ( static_cast< unsigned char >( c_ ) >= ' ' and c_ != 127 )
+    {
+        typed_ += c_;
+        return true;
+    }
+    if ( c_ == '\t' )
+    {
+        typed_ += c_;
+        return true;
+    }
+
+    insert( typed_ );
+    switch ( c_ )
+    {
+        case 27: escape = escape_t::ESC; break;           // Escape sequence.
+        case '\r':
+        case '\n': enter(); break;
+        case 127:
+        case 8:  if ( cursor > 0 ) edit( cursor - 1, 1, "" ); break; // Backspace.
+        case 1:  cursor = 0; break;                        // Ctrl-A
+        case 5:  cursor = line.size(); break;              // Ctrl-E
+        case 2:  if ( cursor > 0 ) --cursor; break;        // Ctrl-B
+        case 6:  if ( cursor < line.size() ) ++cursor; break; // Ctrl-F
+        case 21: edit( 0, cursor, "" ); break;             // Ctrl-U
+        case 11: edit( cursor, line.size() - cursor, "" ); break; // Ctrl-K
+        case 4:                                            // Ctrl-D
+            if ( line.empty() ) return false;
+            edit( cursor, 1, "" );
+            break;
+        case 3:  return false;                             // Ctrl-C
+        default: break;
+    }
+    return true;
+}
+
+/// @param c_ the final byte of the sequence (its parameters are in `escape_args`).
+void Repl::control( char c_ )
+{
+    switch ( c_ )
+    {
+        case 'A': if ( history_pos > 0 ) recall( history_pos - 1 ); break;
+        case 'B': if ( history_pos < history.size() ) recall( history_pos + 1 ); break;
+        case 'C': if ( cursor < line.size() ) ++cursor; break;
+        case 'D': if ( cursor > 0 ) --cursor; break;
+        case 'H': cursor = 0; break;
+        case 'F': cursor = line.size(); break;
+        case '~':
+            if ( escape_args == "3" ) edit( cursor, 1, "" );
+            else if ( escape_args == "1" or escape_args == "7" ) cursor = 0;
+            else if ( escape_args == "4" or escape_args == "8" ) cursor = line.size();
+            break;
+        default: break;
+    }
+}
+
+/// Inserts `typed_` at the cursor and empties it.
+void Repl::insert( std::string & typed_ )
+{
+    if ( typed_.empty() )
+        return;
+    edit( cursor, 0, typed_ );
+    typed_.clear();
+}
+
+/// The line stays on the screen, with its outcome, and a new prompt starts below it.
+void Repl::enter( void )
+{
+    if ( line.empty() )
+        return;
+
+    draw();
+    screen.assign( "\n\n\n" );
+    send();
+
+    history.push_back( line );
+    history_pos = history.size();
+    edit( 0, line.size(), "" );
+    scroll = 0;
+}
+
+/// @param pos_ the line of the history (history.size() for an empty one).
+void Repl::recall( size_type pos_ )
+{
+    history_pos = pos_;
+    edit( 0, line.size(), pos_ < history.size() ? std::string_view( history[ pos_ ] ) : std::string_view() );
+}
+
+/*!
+ * Draws three rows: the prompt with (the visible part of) the line, a caret under the
+ * column of the error, if there is one, and the outcome.  The cursor is left on the line.
+ */
+void Repl::draw( void )
+{
+    winsize ws;
+    size_type columns = ( ioctl( out_fd, TIOCGWINSZ, &ws ) == 0 and ws.ws_col > 0 ) ? ws.ws_col : 80;
+    size_type width = columns > PROMPT.size() + 10 ? columns - PROMPT.size() - 1 : 10;
+    if ( cursor < scroll ) scroll = cursor;
+    else if ( cursor > scroll + width ) scroll = cursor - width;
+
+    const Outcome & o = check();
+    std::string message;
+    size_type caret = std::string::npos; // No caret.
+    if ( not line.empty() )
+    {
+        switch ( o.status )
+        {
+            case Outcome::OK:
+                message = ">>> Result is: " + std::to_string( o.value );
+                break;
+            case Outcome::PARSE_ERROR:
+                print_error_line( message, o.parse_result );
+                message.pop_back(); // '\n'
+                caret = o.parse_result.at_col;
+                break;
+            case Outcome::DIVISION_BY_ZERO: message = BARES_MSG_DIVISION_BY_ZERO "!"; caret = o.at_col; break;
+            case Outcome::MODULO_BY_ZERO:   message = BARES_MSG_MODULO_BY_ZERO "!";   caret = o.at_col; break;
+            case Outcome::NUMERIC_OVERFLOW: message = BARES_MSG_NUMERIC_OVERFLOW "!"; caret = o.at_col; break;
+        }
+    }
+    if ( message.size() >= columns )
+        message.resize( columns - 1 );
+
+    screen.assign( "\r" );
+    screen += PROMPT;
+    if ( scroll < line.size() )
+        screen.append( line, scroll, width );
+    screen += "\x1b[K\n";
+    if ( caret >= scroll and caret <= scroll + width )
+    {
+        screen.append( PROMPT.size() + caret - scroll, ' ' );
+        screen += '^';
+    }
+    screen += "\x1b[K\n";
+    screen += message;
+    screen += "\x1b[K\x1b[2A\r";
+    // Volta o cursor para a posição de edição.
+    screen += "\x1b[" + std::to_string( PROMPT.size() + cursor - scroll ) + "C";
+    send();
+}
+
+/// Writes everything, even if the terminal takes it in pieces.
+void Repl::send( void )
+{
+    const char * data = screen.data();
+    size_type left = screen.size();
+    while ( left > 0 )
+    {
+        auto n = ::write( out_fd, data, left );
+        if ( n < 0 and errno == EINTR ) continue;
+        if ( n <= 0 ) return;
+        data += n;
+        left -= n;
+    }
+}
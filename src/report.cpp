@@ -0,0 +1,200 @@
+#include "../include/report.h"
+#include "../include/bigint.h"
+#include <charconv> // std::to_chars
+#include <type_traits> // std::is_same
+
+/// Appends the decimal representation of `v_` without any temporary string.
+template < typename T >
+void append_number( std::string & out_, const T & v_ )
+{
+    if constexpr ( std::is_same< T, BigInt >::value )
+    {
+        v_.append_to( out_ );
+    }
+    else if constexpr ( sizeof( T ) > sizeof( long long int ) )
+    {
+        // std::to_chars does not take __int128: the digits come out backwards.
+        char digits[40];
+        char * first = digits + sizeof( digits );
+        unsigned __int128 magnitude = v_ < 0 ? -static_cast< unsigned __int128 >( v_ ) : v_;
+        do *--first = char( '0' + magnitude % 10 ); while ( ( magnitude /= 10 ) != 0 );
+        if ( v_ < 0 ) *--first = '-';
+        out_.append( first, digits + sizeof( digits ) - first );
+    }
+    else
+    {
+        char digits[24];
+        auto end = std::to_chars( digits, digits + sizeof( digits ), static_cast< long long int >( v_ ) ).ptr;
+        out_.append( digits, end - digits );
+    }
+}
+
+/// The column printed for a parsing error (see grammar::reported_column()).
+Parser::ResultType::size_type reported_column( const Parser::ResultType & result_ )
+{
+    return grammar::reported_column( result_.type == Parser::ResultType::ILL_FORMED_INTEGER, result_.at_col );
+}
+
+/// Name of the error, as printed by the compact format.
+const char * error_name( const OutcomeBase & outcome_ )
+{
+    switch ( outcome_.status )
+    {
+        case Outcome::OK:               return "OK";
+        case Outcome::DIVISION_BY_ZERO: return "DIVISION_BY_ZERO";
+        case Outcome::MODULO_BY_ZERO:   return "MODULO_BY_ZERO";
+        case Outcome::NUMERIC_OVERFLOW: return "NUMERIC_OVERFLOW";
+        case Outcome::PARSE_ERROR:      break;
+    }
+
+    switch ( outcome_.parse_result.type )
+    {
+        case Parser::ResultType::OK:                           return "OK";
+        case Parser::ResultType::UNEXPECTED_END_OF_EXPRESSION: return "UNEXPECTED_END_OF_EXPRESSION";
+        case Parser::ResultType::ILL_FORMED_INTEGER:           return "ILL_FORMED_INTEGER";
+        case Parser::ResultType::MISSING_TERM:                 return "MISSING_TERM";
+        case Parser::ResultType::EXTRANEOUS_SYMBOL:            return "EXTRANEOUS_SYMBOL";
+        case Parser::ResultType::INTEGER_OUT_OF_RANGE:         return "INTEGER_OUT_OF_RANGE";
+        case Parser::ResultType::MISSING_CLOSING:              return "MISSING_CLOSING";
+        case Parser::ResultType::NESTING_TOO_DEEP:             return "NESTING_TOO_DEEP";
+    }
+    return "UNKNOWN_ERROR";
+}
+
+/*!
+ * Describes a parsing error, in a line of its own (with the column where it happened).
+ *
+ * @param out_ the buffer that receives the text.
+ * @param result_ the (failed) parsing result.
+ */
+void print_error_line( std::string & out_, const Parser::ResultType & result_ )
+{
+    switch ( result_.type )
+    {
+        case Parser::ResultType::UNEXPECTED_END_OF_EXPRESSION:
+            out_ += ">>> " BARES_MSG_UNEXPECTED_END_OF_EXPRESSION " (";
+            break;
+        case Parser::ResultType::ILL_FORMED_INTEGER:
+            out_ += ">>> " BARES_MSG_ILL_FORMED_INTEGER " (";
+            break;
+        case Parser::ResultType::MISSING_TERM:
+            out_ += ">>> " BARES_MSG_MISSING_TERM " (";
+            break;
+        case Parser::ResultType::EXTRANEOUS_SYMBOL:
+            out_ += ">>> " BARES_MSG_EXTRANEOUS_SYMBOL " (";
+            break;
+        case Parser::ResultType::INTEGER_OUT_OF_RANGE:
+            out_ += ">>> " BARES_MSG_INTEGER_OUT_OF_RANGE " (";
+            break;
+        case Parser::ResultType::MISSING_CLOSING:
+            out_ += ">>> " BARES_MSG_MISSING_CLOSING " (";
+            break;
+        case Parser::ResultType::NESTING_TOO_DEEP:
+            out_ += ">>> " BARES_MSG_NESTING_TOO_DEEP " (";
+            break;
+        default:
+            out_ += ">>> Unhandled error found!\n";
+            break;
+    }
+    if ( result_.type != Parser::ResultType::OK )
+    {
+        append_number( out_, reported_column( result_ ) );
+        out_ += ")!\n";
+    }
+}
+
+/*!
+ * Describes a parsing error and points, with a caret, to the column where it happened.
+ *
+ * @param out_ the buffer that receives the text.
+ * @param result_ the (failed) parsing result.
+ * @param expr_ the expression that has been parsed.
+ */
+void print_error_msg( std::string & out_, const Parser::ResultType & result_, std::string_view expr_ )
+{
+    print_error_line( out_, result_ );
+
+    out_ += "\"";
+    out_ += expr_;
+    out_ += "\"\n ";
+    // The caret goes under the column of the error.
+    out_.append( result_.at_col, ' ' );
+    out_ += '^';
+    out_.append( expr_.size() - result_.at_col, ' ' );
+    out_ += '\n';
+}
+
+/*!
+ * Writes the banner for an expression followed by either its value or the reason there is none.
+ *
+ * @param out_ the buffer that receives the text.
+ * @param expr_ the expression.
+ * @param outcome_ what happened when we processed the expression.
+ */
+template < typename T >
+void print_report( std::string & out_, std::string_view expr_, const BasicOutcome< T > & outcome_ )
+{
+    // Preparar cabeçalho da saida.
+    out_.append( 79, '=' );
+    out_ += "\n>>> Parsing \"";
+    out_ += expr_;
+    out_ += "\"\n";
+
+    switch ( outcome_.status )
+    {
+        case Outcome::PARSE_ERROR:
+            print_error_msg( out_, outcome_.parse_result, expr_ );
+            return;
+        case Outcome::OK:
+            out_ += ">>> Expression SUCCESSFULLY parsed!\n>>> Result is: ";
+            append_number( out_, outcome_.value );
+            out_ += '\n';
+            break;
+        case Outcome::DIVISION_BY_ZERO:
+            out_ += ">>> Expression SUCCESSFULLY parsed!\n" BARES_MSG_DIVISION_BY_ZERO "!\n";
+            break;
+        case Outcome::MODULO_BY_ZERO:
+            out_ += ">>> Expression SUCCESSFULLY parsed!\n" BARES_MSG_MODULO_BY_ZERO "!\n";
+            break;
+        case Outcome::NUMERIC_OVERFLOW:
+            out_ += ">>> Expression SUCCESSFULLY parsed!\n" BARES_MSG_NUMERIC_OVERFLOW "!\n";
+            break;
+    }
+}
+
+/*!
+ * Writes a single line: the value of the expression or, if there is none, the name
+ * of the error followed by a comma and its column (for a run time error, the column of
+ * the operator that failed).
+ *
+ * @param out_ the buffer that receives the text.
+ * @param outcome_ what happened when we processed the expression.
+ */
+template < typename T >
+void print_compact( std::string & out_, const BasicOutcome< T > & outcome_ )
+{
+    if ( outcome_.status == Outcome::OK )
+    {
+        append_number( out_, outcome_.value );
+    }
+    else
+    {
+        out_ += error_name( outcome_ );
+        out_ += ',';
+        append_number( out_, outcome_.status == Outcome::PARSE_ERROR ? reported_column( outcome_.parse_result ) : outcome_.at_col );
+    }
+    out_ += '\n';
+}
+
+template void print_report( std::string &, std::string_view, const BasicOutcome< long > & );
+template void print_report( std::string &, std::string_view, const BasicOutcome< std::int32_t > & );
+template void print_report( std::string &, std::string_view, const BasicOutcome< __int128 > & );
+template void print_report( std::string &, std::string_view, const BasicOutcome< BigInt > & );
+template void print_compact( std::string &, const BasicOutcome< long > & );
+template void print_compact( std::string &, const BasicOutcome< std::int32_t > & );
+template void print_compact( std::string &, const BasicOutcome< __int128 > & );
+template void print_compact( std::string &, const BasicOutcome< BigInt > & );
+template void append_number( std::string &, const long & );
+template void append_number( std::string &, const std::int32_t & );
+template void append_number( std::string &, const __int128 & );
+template void append_number( std::string &, const BigInt & );
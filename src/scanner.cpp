@@ -0,0 +1,201 @@
+#include "../include/scanner.h"
+#include <cstdlib>  // std::getenv
+#include <cstring>  // std::strcmp
+
+#include "../include/simd.h" // BARES_X86_64
+
+/// Builds the classification table at compile time.
+static constexpr std::array< char_class_t, 256 > make_table( void )
+{
+    std::array< char_class_t, 256 > t{};
+    for ( int c{0} ; c < 256 ; ++c )
+        t[c] = grammar::classify( static_cast< unsigned char >( c ) );
+    return t;
+}
+
+const std::array< char_class_t, 256 > Scanner::table = make_table();
+
+//=== Scalar kernels (the reference, and the tails of the vector ones).
+
+static void classify_scalar( const char * first_, const char * last_, std::uint8_t * out_ )
+{
+    while ( first_ != last_ )
+        *out_++ = Scanner::classify( *first_++ );
+}
+
+static const char * skip_ws_scalar( const char * first_, const char * last_ )
+{
+    while ( first_ != last_ and ( *first_ == ' ' or *first_ == '\t' ) ) ++first_;
+    return first_;
+}
+
+static const char * skip_digits_scalar( const char * first_, const char * last_ )
+{
+    while ( first_ != last_ and static_cast< unsigned char >( *first_ - '0' ) <= 9 ) ++first_;
+    return first_;
+}
+
+#ifdef BARES_X86_64
+
+//=== SSE2 kernels (always available on x86-64).
+
+/*!
+ * Classifies 16 characters at once.
+ *
+ * Each class has its own comparison mask. The masks do not overlap, so adding up
+ * `mask & (class - CC_INVALID)` on top of CC_INVALID gives the class of each byte.
+ */
+static inline __m128i classify16( __m128i c_ )
+{
+    auto eq = [&]( char v_ ) { return _mm_cmpeq_epi8( c_, _mm_set1_epi8( v_ ) ); };
+    auto code = [&]( __m128i mask_, char_class_t cc_ ) {
+        return _mm_and_si128( mask_, _mm_set1_epi8( static_cast< char >( cc_ - CC_INVALID ) ) );
+    };
+
+    // '1'..'9': (c - '1') as unsigned is at most 8.
+    __m128i d = _mm_sub_epi8( c_, _mm_set1_epi8( '1' ) );
+    __m128i non_zero_digit = _mm_cmpeq_epi8( _mm_min_epu8( d, _mm_set1_epi8( 8 ) ), d );
+    __m128i op = _mm_or_si128( _mm_or_si128( eq( '+' ), eq( '^' ) ),
+                               _mm_or_si128( _mm_or_si128( eq( '*' ), eq( '%' ) ), eq( '/' ) ) );
+
+    __m128i r = _mm_set1_epi8( static_cast< char >( CC_INVALID ) );
+    r = _mm_add_epi8( r, code( eq( '-' ), CC_MINUS ) );
+    r = _mm_add_epi8( r, code( eq( '(' ), CC_OP_SCOPE ) );
+    r = _mm_add_epi8( r, code( eq( ')' ), CC_CL_SCOPE ) );
+    r = _mm_add_epi8( r, code( op, CC_OPERATOR ) );
+    r = _mm_add_epi8( r, code( eq( '0' ), CC_ZERO ) );
+    r = _mm_add_epi8( r, code( non_zero_digit, CC_NON_ZERO_DIGIT ) );
+    r = _mm_add_epi8( r, code( eq( ' ' ), CC_WS ) );
+    r = _mm_add_epi8( r, code( eq( '\t' ), CC_TAB ) );
+    r = _mm_add_epi8( r, code( eq( '\0' ), CC_EOS ) );
+    return r;
+}
+
+static void classify_sse2( const char * first_, const char * last_, std::uint8_t * out_ )
+{
+    for ( ; last_ - first_ >= 16 ; first_ += 16, out_ += 16 )
+    {
+        __m128i c = _mm_loadu_si128( reinterpret_cast< const __m128i * >( first_ ) );
+        _mm_storeu_si128( reinterpret_cast< __m128i * >( out_ ), classify16( c ) );
+    }
+    classify_scalar( first_, last_, out_ );
+}
+
+static const char * skip_ws_sse2( const char * first_, const char * last_ )
+{
+    for ( ; last_ - first_ >= 16 ; first_ += 16 )
+    {
+        __m128i c = _mm_loadu_si128( reinterpret_cast< const __m128i * >( first_ ) );
+        __m128i ws = _mm_or_si128( _mm_cmpeq_epi8( c, _mm_set1_epi8( ' ' ) ),
+                                   _mm_cmpeq_epi8( c, _mm_set1_epi8( '\t' ) ) );
+        unsigned other = ~static_cast< unsigned >( _mm_movemask_epi8( ws ) ) & 0xFFFFu;
+        if ( other != 0 ) return first_ + __builtin_ctz( other );
+    }
+    return skip_ws_scalar( first_, last_ );
+}
+
+static const char * skip_digits_sse2( const char * first_, const char * last_ )
+{
+    for ( ; last_ - first_ >= 16 ; first_ += 16 )
+    {
+        __m128i c = _mm_loadu_si128( reinterpret_cast< const __m128i * >( first_ ) );
+        __m128i d = _mm_sub_epi8( c, _mm_set1_epi8( '0' ) );
+        __m128i digit = _mm_cmpeq_epi8( _mm_min_epu8( d, _mm_set1_epi8( 9 ) ), d );
+        unsigned other = ~static_cast< unsigned >( _mm_movemask_epi8( digit ) ) & 0xFFFFu;
+        if ( other != 0 ) return first_ + __builtin_ctz( other );
+    }
+    return skip_digits_scalar( first_, last_ );
+}
+
+//=== AVX2 kernels (only called after checking the processor supports them).
+
+__attribute__(( target( "avx2" ) ))
+static inline __m256i classify32( __m256i c_ )
+{
+    auto eq = [&]( char v_ ) __attribute__(( target( "avx2" ) )) { return _mm256_cmpeq_epi8( c_, _mm256_set1_epi8( v_ ) ); };
+    auto code = [&]( __m256i mask_, char_class_t cc_ ) __attribute__(( target( "avx2" ) )) {
+        return _mm256_and_si256( mask_, _mm256_set1_epi8( static_cast< char >( cc_ - CC_INVALID ) ) );
+    };
+
+    __m256i d = _mm256_sub_epi8( c_, _mm256_set1_epi8( '1' ) );
+    __m256i non_zero_digit = _mm256_cmpeq_epi8( _mm256_min_epu8( d, _mm256_set1_epi8( 8 ) ), d );
+    __m256i op = _mm256_or_si256( _mm256_or_si256( eq( '+' ), eq( '^' ) ),
+                                  _mm256_or_si256( _mm256_or_si256( eq( '*' ), eq( '%' ) ), eq( '/' ) ) );
+
+    __m256i r = _mm256_set1_epi8( static_cast< char >( CC_INVALID ) );
+    r = _mm256_add_epi8( r, code( eq( '-' ), CC_MINUS ) );
+    r = _mm256_add_epi8( r, code( eq( '(' ), CC_OP_SCOPE ) );
+    r = _mm256_add_epi8( r, code( eq( ')' ), CC_CL_SCOPE ) );
+    r = _mm256_add_epi8( r, code( op, CC_OPERATOR ) );
+    r = _mm256_add_epi8( r, code( eq( '0' ), CC_ZERO ) );
+    r = _mm256_add_epi8( r, code( non_zero_digit, CC_NON_ZERO_DIGIT ) );
+    r = _mm256_add_epi8( r, code( eq( ' ' ), CC_WS ) );
+    r = _mm256_add_epi8( r, code( eq( '\t' ), CC_TAB ) );
+    r = _mm256_add_epi8( r, code( eq( '\0' ), CC_EOS ) );
+    return r;
+}
+
+__attribute__(( target( "avx2" ) ))
+static void classify_avx2( const char * first_, const char * last_, std::uint8_t * out_ )
+{
+    for ( ; last_ - first_ >= 32 ; first_ += 32, out_ += 32 )
+    {
+        __m256i c = _mm256_loadu_si256( reinterpret_cast< const __m256i * >( first_ ) );
+        _mm256_storeu_si256( reinterpret_cast< __m256i * >( out_ ), classify32( c ) );
+    }
+    classify_sse2( first_, last_, out_ );
+}
+
+__attribute__(( target( "avx2" ) ))
+static const char * skip_ws_avx2( const char * first_, const char * last_ )
+{
+    for ( ; last_ - first_ >= 32 ; first_ += 32 )
+    {
+        __m256i c = _mm256_loadu_si256( reinterpret_cast< const __m256i * >( first_ ) );
+        __m256i ws = _mm256_or_si256( _mm256_cmpeq_epi8( c, _mm256_set1_epi8( ' ' ) ),
+                                      _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '\t' ) ) );
+        unsigned other = ~static_cast< unsigned >( _mm256_movemask_epi8( ws ) );
+        if ( other != 0 ) return first_ + __builtin_ctz( other );
+    }
+    return skip_ws_sse2( first_, last_ );
+}
+
+__attribute__(( target( "avx2" ) ))
+static const char * skip_digits_avx2( const char * first_, const char * last_ )
+{
+    for ( ; last_ - first_ >= 32 ; first_ += 32 )
+    {
+        __m256i c = _mm256_loadu_si256( reinterpret_cast< const __m256i * >( first_ ) );
+        __m256i d = _mm256_sub_epi8( c, _mm256_set1_epi8( '0' ) );
+        __m256i digit = _mm256_cmpeq_epi8( _mm256_min_epu8( d, _mm256_set1_epi8( 9 ) ), d );
+        unsigned other = ~static_cast< unsigned >( _mm256_movemask_epi8( digit ) );
+        if ( other != 0 ) return first_ + __builtin_ctz( other );
+    }
+    return skip_digits_sse2( first_, last_ );
+}
+
+#endif // BARES_X86_64
+
+/// Picks the best implementation the processor supports (or the one requested in BARES_SIMD).
+static Scanner::Kernels select_kernels( void )
+{
+    const Scanner::Kernels scalar{ classify_scalar, skip_ws_scalar, skip_digits_scalar, "scalar" };
+    const char * wanted = std::getenv( "BARES_SIMD" );
+    if ( wanted != nullptr and std::strcmp( wanted, "scalar" ) == 0 )
+        return scalar;
+
+#ifdef BARES_X86_64
+    const Scanner::Kernels sse2{ classify_sse2, skip_ws_sse2, skip_digits_sse2, "sse2" };
+    const Scanner::Kernels avx2{ classify_avx2, skip_ws_avx2, skip_digits_avx2, "avx2" };
+
+    __builtin_cpu_init();
+    bool has_avx2 = __builtin_cpu_supports( "avx2" );
+    if ( wanted != nullptr and std::strcmp( wanted, "sse2" ) == 0 )
+        return sse2;
+    return has_avx2 ? avx2 : sse2;
+#else
+    return scalar;
+#endif
+}
+
+const Scanner::Kernels Scanner::kernels = select_kernels();
@@ -0,0 +1,334 @@
+#include "../include/server.h"
+#include "../include/report.h" // print_compact()
+#include "../include/stats.h"
+#include <cstring>       // std::memchr, std::memmove, std::strncpy
+#include <cerrno>        // errno
+#include <csignal>       // SIGINT, SIGTERM
+#include <unistd.h>      // ::read, ::close, ::unlink
+#include <sys/socket.h>  // ::socket, ::bind, ::listen, ::accept4, ::send
+#include <sys/un.h>      // sockaddr_un
+#include <sys/epoll.h>   // epoll_*
+#include <sys/signalfd.h> // ::signalfd
+
+/// Fills in the address of the socket `path_`. Returns false if the path is too long.
+static bool make_address( const std::string & path_, sockaddr_un & addr_ )
+{
+    std::memset( &addr_, 0, sizeof( addr_ ) );
+    addr_.sun_family = AF_UNIX;
+    if ( path_.size() >= sizeof( addr_.sun_path ) )
+    {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    std::strncpy( addr_.sun_path, path_.c_str(), sizeof( addr_.sun_path ) - 1 );
+    return true;
+}
+
+Server::Server( const EvaluatorConfig & config_ )
+    : evaluator( config_ )
+{ /* empty */ }
+
+Server::~Server()
+{
+    for ( auto & c : connections ) ::close( c.second->fd );
+    if ( signal_fd != -1 ) ::close( signal_fd );
+    if ( epoll_fd != -1 ) ::close( epoll_fd );
+    if ( listen_fd != -1 )
+    {
+        ::close( listen_fd );
+        ::unlink( path.c_str() );
+    }
+}
+
+/*!
+ * @param path_ the file name of the socket; if there is already a socket there that no
+ *        server is listening on (left by a server that crashed), it is replaced.
+ * @return true if the server is listening; false otherwise (errno tells why).
+ */
+bool Server::listen( const std::string & path_ )
+{
+    sockaddr_un addr;
+    if ( not make_address( path_, addr ) ) return false;
+
+    // A stale socket is one nobody accepts connections on.
+    int probe = connect( path_ );
+    if ( probe != -1 )
+    {
+        ::close( probe );
+        errno = EADDRINUSE;
+        return false;
+    }
+    if ( errno == ECONNREFUSED ) ::unlink( path_.c_str() );
+
+    listen_fd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+    if ( listen_fd == -1 ) return false;
+    if ( ::bind( listen_fd, reinterpret_cast< sockaddr * >( &addr ), sizeof( addr ) ) == -1 or
+         ::listen( listen_fd, SOMAXCONN ) == -1 )
+    {
+        ::close( listen_fd );
+        listen_fd = -1;
+        return false;
+    }
+    path = path_;
+    return true;
+}
+
+/// @return the connected socket (blocking), or -1 (errno tells why).
+int Server::connect( const std::string & path_ )
+{
+    sockaddr_un addr;
+    if ( not make_address( path_, addr ) ) return -1;
+
+    int fd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+    if ( fd == -1 ) return -1;
+    if ( ::connect( fd, reinterpret_cast< sockaddr * >( &addr ), sizeof( addr ) ) == -1 )
+    {
+        int saved = errno;
+        ::close( fd );
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/*!
+ * The event loop. The listening socket, the signals and every connection are watched by
+ * the same epoll instance (level triggered); a connection is identified by its socket.
+ *
+ * @return true when stopped by a signal; false if the loop could not be set up.
+ */
+bool Server::run( void )
+{
+    // The signals are taken as events, so that they can only arrive between two batches.
+    sigset_t signals, previous;
+    sigemptyset( &signals );
+    sigaddset( &signals, SIGINT );
+    sigaddset( &signals, SIGTERM );
+    if ( sigprocmask( SIG_BLOCK, &signals, &previous ) == -1 ) return false;
+    // Every way out gives the caller back its signal mask.
+    auto restore = [&]( bool result_ ) {
+        int saved = errno;
+        sigprocmask( SIG_SETMASK, &previous, nullptr );
+        errno = saved;
+        return result_;
+    };
+    signal_fd = ::signalfd( -1, &signals, SFD_NONBLOCK | SFD_CLOEXEC );
+    epoll_fd = ::epoll_create1( EPOLL_CLOEXEC );
+    if ( signal_fd == -1 or epoll_fd == -1 ) return restore( false );
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd;
+    if ( ::epoll_ctl( epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev ) == -1 ) return restore( false );
+    ev.data.fd = signal_fd;
+    if ( ::epoll_ctl( epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev ) == -1 ) return restore( false );
+
+    epoll_event events[64];
+    for ( bool stop = false ; not stop ; )
+    {
+        int n = ::epoll_wait( epoll_fd, events, 64, accepting ? -1 : ACCEPT_RETRY );
+        if ( n == -1 )
+        {
+            if ( errno == EINTR ) continue;
+            break;
+        }
+        if ( not accepting ) watch_listener( true ); // A connection may have been closed, or time passed.
+        for ( int i{0} ; i < n ; ++i )
+        {
+            int fd = events[i].data.fd;
+            if ( fd == signal_fd )
+            {
+                // Take the signal, or it would be delivered once the mask is restored.
+                signalfd_siginfo info;
+                stop = ::read( signal_fd, &info, sizeof( info ) ) == sizeof( info );
+            }
+            else if ( fd == listen_fd ) accept_all();
+            else
+            {
+                // It may have been closed by an earlier event of this batch.
+                auto it = connections.find( fd );
+                if ( it == connections.end() ) continue;
+                Connection & c = *it->second;
+                if ( events[i].events & EPOLLOUT ) send( c );
+                else on_readable( c ); // Also errors and hang ups: read() tells what happened.
+            }
+        }
+    }
+
+    return restore( true );
+}
+
+/// Accepts the pending connections, recycling the buffers of closed ones.
+void Server::accept_all( void )
+{
+    for (;;)
+    {
+        int fd = ::accept4( listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC );
+        if ( fd == -1 )
+        {
+            // Sem descritores livres, a conexão continua pendente: o socket (level triggered)
+            // acordaria o laço sem parar, então deixamos de observá-lo por um tempo.
+            if ( errno == EMFILE or errno == ENFILE or errno == ENOBUFS or errno == ENOMEM )
+                watch_listener( false );
+            if ( errno == EINTR or errno == ECONNABORTED ) continue;
+            return; // EAGAIN: no more for now.
+        }
+
+        std::unique_ptr< Connection > c;
+        if ( spare.empty() ) c.reset( new Connection );
+        else
+        {
+            c = std::move( spare.back() );
+            spare.pop_back();
+        }
+        c->fd = fd;
+        c->events = EPOLLIN;
+
+        epoll_event ev{};
+        ev.events = c->events;
+        ev.data.fd = fd;
+        if ( ::epoll_ctl( epoll_fd, EPOLL_CTL_ADD, fd, &ev ) == -1 )
+        {
+            ::close( fd );
+            continue;
+        }
+        connections.emplace( fd, std::move( c ) );
+        ++n_connections;
+    }
+}
+
+/// Starts (`on_` true) or stops watching the listening socket for new connections.
+void Server::watch_listener( bool on_ )
+{
+    if ( on_ == accepting ) return;
+    epoll_event ev{};
+    ev.events = on_ ? EPOLLIN : 0u;
+    ev.data.fd = listen_fd;
+    if ( ::epoll_ctl( epoll_fd, EPOLL_CTL_MOD, listen_fd, &ev ) == 0 ) accepting = on_;
+}
+
+/// Reads what the client sent (one block, to be fair to the other clients) and answers it.
+void Server::on_readable( Connection & c_ )
+{
+    // Move the partial line left over to the front, and make room for a block.
+    if ( c_.in.size() - c_.in_end < READ_SIZE )
+    {
+        std::memmove( c_.in.data(), c_.in.data() + c_.in_begin, c_.in_end - c_.in_begin );
+        c_.in_end -= c_.in_begin;
+        c_.in_begin = 0;
+        if ( c_.in.size() - c_.in_end < READ_SIZE ) c_.in.resize( c_.in_end + READ_SIZE );
+    }
+
+    ssize_t n;
+    {
+        BARES_STAGE( READ );
+        n = ::read( c_.fd, c_.in.data() + c_.in_end, READ_SIZE );
+    }
+    if ( n > 0 ) c_.in_end += n;
+    else if ( n == 0 ) c_.eof = true;
+    else if ( n == -1 )
+    {
+        if ( errno == EAGAIN or errno == EINTR ) return;
+        close( c_ ); // Nobody to answer to.
+        return;
+    }
+
+    evaluate_lines( c_ );
+    if ( c_.in_end - c_.in_begin > MAX_LINE )
+    {
+        // A line this long would take any amount of memory: answer it with an error, and hang up.
+        c_.out += "LINE_TOO_LONG,";
+        append_number( c_.out, static_cast< long >( MAX_LINE ) );
+        c_.out += '\n';
+        c_.in_begin = c_.in_end = 0;
+        c_.eof = true;
+    }
+    send( c_ );
+}
+
+/// Evaluates every complete line (and, at the end of the input, the last one) into `out`.
+void Server::evaluate_lines( Connection & c_ )
+{
+    const char * const data = c_.in.data();
+    const char * const end = data + c_.in_end;
+    const char * first = data + c_.in_begin;
+    while ( first != end )
+    {
+        auto nl = static_cast< const char * >( std::memchr( first, '\n', end - first ) );
+        if ( nl == nullptr and not c_.eof ) break; // Wait for the rest of the line.
+        const char * last = nl == nullptr ? end : nl;
+
+        std::string_view line( first, last - first );
+        Outcome outcome = evaluator.evaluate( line );
+        {
+            BARES_STAGE( OUTPUT );
+            print_compact( c_.out, outcome );
+        }
+        first = nl == nullptr ? end : nl + 1;
+    }
+    c_.in_begin = first - data;
+    if ( c_.in_begin == c_.in_end ) c_.in_begin = c_.in_end = 0;
+}
+
+/// Sends the answers pending, then decides what to wait for next (or closes the connection).
+void Server::send( Connection & c_ )
+{
+    while ( c_.out_pos < c_.out.size() )
+    {
+        ssize_t n;
+        {
+            BARES_STAGE( OUTPUT );
+            n = ::send( c_.fd, c_.out.data() + c_.out_pos, c_.out.size() - c_.out_pos, MSG_NOSIGNAL );
+        }
+        if ( n == -1 )
+        {
+            if ( errno == EINTR ) continue;
+            if ( errno == EAGAIN ) break;
+            close( c_ ); // The client went away.
+            return;
+        }
+        c_.out_pos += n;
+    }
+    size_type pending = c_.out.size() - c_.out_pos;
+    if ( pending == 0 )
+    {
+        c_.out.clear();
+        c_.out_pos = 0;
+        if ( c_.eof )
+        {
+            close( c_ ); // Everything has been answered.
+            return;
+        }
+    }
+
+    // Stop reading a client that does not read its answers.
+    unsigned events = ( c_.eof or pending >= HIGH_WATER ) ? 0u : unsigned( EPOLLIN );
+    if ( pending != 0 ) events |= EPOLLOUT;
+    if ( events != c_.events )
+    {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = c_.fd;
+        ::epoll_ctl( epoll_fd, EPOLL_CTL_MOD, c_.fd, &ev );
+        c_.events = events;
+    }
+}
+
+/// Closes the connection; its buffers are kept (empty) for the next one.
+void Server::close( Connection & c_ )
+{
+    int fd = c_.fd;
+    ::epoll_ctl( epoll_fd, EPOLL_CTL_DEL, fd, nullptr );
+    ::close( fd );
+
+    auto it = connections.find( fd );
+    std::unique_ptr< Connection > c = std::move( it->second );
+    connections.erase( it );
+    c->fd = -1;
+    if ( c->in.size() > HIGH_WATER ) std::vector< char >().swap( c->in ); // Grown by a very long line.
+    c->in_begin = c->in_end = 0;
+    c->out.clear();
+    c->out_pos = 0;
+    c->eof = false;
+    spare.push_back( std::move( c ) );
+}
@@ -0,0 +1,389 @@
+#include "../include/split.h"
+#include "../include/stats.h"
+#include "../include/bigint.h"
+#include <thread>      // std::thread
+#include <type_traits> // std::is_same
+
+/// A thread's parser and VM, and what it found in its block of the line.
+template < typename T >
+struct SplitEvaluator< T >::Worker
+{
+    Parser parser;                     //!< Parses the operands...
+    BasicVM< T > vm;                   //!< ... and runs them.
+    size_type begin = 0;               //!< Start of the block.
+    size_type end = 0;                 //!< End of the block.
+    std::ptrdiff_t delta = 0;          //!< Depth at the end of the block, relative to its start.
+    std::ptrdiff_t low = 0;            //!< Lowest depth inside the block, relative to its start.
+    std::ptrdiff_t depth = 0;          //!< Depth at the start of the block.
+    bool invalid = false;              //!< Whether the block has a character that is not part of the grammar.
+    unsigned levels = 0;               //!< Bit `p` is set if an operator of precedence `p` is at the top.
+    std::vector< Operand > operands;   //!< The operands that start in the block, in order.
+    bool failed = false;               //!< Whether the operand after the last of `operands` failed.
+    typename BasicVM< T >::ResultType failure; //!< How it failed (its column is in the line).
+};
+
+/// Whether the "-" at `pos_` is an operator (and not the sign of a constant): it follows a term.
+static bool binary_minus( std::string_view e_, std::size_t pos_ )
+{
+    while ( pos_ > 0 and ( e_[ pos_ - 1 ] == ' ' or e_[ pos_ - 1 ] == '\t' ) ) --pos_;
+    return pos_ > 0 and ( e_[ pos_ - 1 ] == ')' or ( e_[ pos_ - 1 ] >= '0' and e_[ pos_ - 1 ] <= '9' ) );
+}
+
+/*!
+ * @param n_jobs_ number of threads (at least one); the line is cut in as many blocks.
+ * @param width_ width of the constants (of type `T`, see Parser::set_width()).
+ * @param config_ set up of the parsers (the cache is not used).
+ */
+template < typename T >
+SplitEvaluator< T >::SplitEvaluator( size_type n_jobs_, grammar::width_t width_, const EvaluatorConfig & config_ )
+    : width{ width_ }
+{
+    if ( n_jobs_ == 0 ) n_jobs_ = 1;
+    for ( size_type i{0} ; i < n_jobs_ ; ++i )
+    {
+        workers.emplace_back( new Worker );
+        workers.back()->parser.set_keep_tokens( false );
+        workers.back()->parser.set_max_depth( config_.max_depth );
+        workers.back()->parser.set_width( width_ );
+    }
+}
+
+template < typename T >
+SplitEvaluator< T >::~SplitEvaluator() = default;
+
+/*!
+ * Evaluates a long line in pieces, on all the workers, or a short one as a whole.
+ *
+ * @param e_ the expression (it is not copied).
+ * @return the outcome, the same as a single Parser and VM would give.
+ */
+template < typename T >
+typename SplitEvaluator< T >::outcome_type SplitEvaluator< T >::evaluate( std::string_view e_ )
+{
+    BARES_COUNT( LINES, 1 );
+    BARES_COUNT( BYTES, e_.size() );
+
+    outcome_type outcome;
+    if ( e_.size() < MIN_SPLIT_SIZE or workers.size() < 2 )
+        outcome = whole( e_ );
+    else
+    {
+        expr = e_;
+        for ( size_type i{0} ; i < workers.size() ; ++i )
+        {
+            workers[i]->begin = e_.size() * i / workers.size();
+            workers[i]->end = e_.size() * ( i + 1 ) / workers.size();
+        }
+
+        if ( not scan_depths() ) outcome = whole( e_ );
+        else
+        {
+            find_level();
+            if ( level == 0 ) outcome = whole( e_ );
+            else
+            {
+                parse_failed = false;
+                in_parallel( [this]( Worker & w_ ) { evaluate_operands( w_ ); } );
+                // The first error of the line is a parsing error; the whole parser finds which one.
+                if ( parse_failed ) outcome = whole( e_ );
+                else
+                {
+                    outcome = combine();
+                    ++n_split;
+                }
+            }
+        }
+        for ( auto & w : workers )
+        {
+            w->operands.clear();
+            w->failed = false;
+        }
+    }
+
+    BARES_COUNT_OUTCOME( outcome );
+    return outcome;
+}
+
+/// Runs `f_` on every worker, each one on a thread of its own (the first one on the calling thread).
+template < typename T >
+template < typename F >
+void SplitEvaluator< T >::in_parallel( F f_ )
+{
+    std::vector< std::thread > threads;
+    threads.reserve( workers.size() - 1 );
+    for ( size_type i{1} ; i < workers.size() ; ++i )
+        threads.emplace_back( f_, std::ref( *workers[i] ) );
+    f_( *workers[0] );
+    for ( auto & t : threads )
+        t.join();
+}
+
+/*!
+ * Counts the parentheses of each block (in parallel), and then adds up the counts of the
+ * blocks before each one to get its starting depth.
+ *
+ * @return false if the parentheses do not match, or there is a character that is not part
+ * of the grammar: the line has a parsing error.
+ */
+template < typename T >
+bool SplitEvaluator< T >::scan_depths( void )
+{
+    in_parallel( [this]( Worker & w_ ) {
+        std::ptrdiff_t depth = 0, low = 0;
+        bool invalid = false;
+        for ( size_type i = w_.begin ; i < w_.end ; ++i )
+        {
+            switch ( grammar::classify( expr[i] ) )
+            {
+                case CC_OP_SCOPE: ++depth; break;
+                case CC_CL_SCOPE: if ( --depth < low ) low = depth; break;
+                case CC_EOS:
+                case CC_INVALID:  invalid = true; break;
+                default:          break;
+            }
+        }
+        w_.delta = depth;
+        w_.low = low;
+        w_.invalid = invalid;
+    });
+
+    std::ptrdiff_t depth = 0;
+    for ( auto & w : workers )
+    {
+        if ( w->invalid or depth + w->low < 0 ) return false;
+        w->depth = depth;
+        depth += w->delta;
+    }
+    return depth == 0;
+}
+
+/// Chooses the operators to split at: those of the lowest precedence at the top (`level` is 0 if there are none).
+template < typename T >
+void SplitEvaluator< T >::find_level( void )
+{
+    in_parallel( [this]( Worker & w_ ) {
+        std::ptrdiff_t depth = w_.depth;
+        unsigned levels = 0;
+        for ( size_type i = w_.begin ; i < w_.end ; ++i )
+        {
+            char c = expr[i];
+            if ( c == '(' ) ++depth;
+            else if ( c == ')' ) --depth;
+            else if ( depth == 0 and grammar::is_operator( c ) and ( c != '-' or binary_minus( expr, i ) ) )
+            {
+                levels |= 1u << grammar::precedence( c );
+                if ( grammar::precedence( c ) == 1 ) break; // Nothing binds more loosely.
+            }
+        }
+        w_.levels = levels;
+    });
+
+    unsigned levels = 0;
+    for ( auto & w : workers )
+        levels |= w->levels;
+    level = 0;
+    for ( int p{1} ; p <= grammar::precedence( '^' ) ; ++p )
+        if ( levels & ( 1u << p ) ) { level = p; break; }
+}
+
+/*!
+ * Finds the next operator the line is split at.
+ *
+ * @param from_ where to start looking.
+ * @param depth_ the depth at `from_`; it is moved to the depth at the operator.
+ * @param end_ where to stop looking.
+ * @return the position of the operator, or `end_` if there is none before it.
+ */
+template < typename T >
+typename SplitEvaluator< T >::size_type
+SplitEvaluator< T >::next_split( size_type from_, std::ptrdiff_t & depth_, size_type end_ ) const
+{
+    for ( size_type i = from_ ; i < end_ ; ++i )
+    {
+        char c = expr[i];
+        if ( c == '(' ) ++depth_;
+        else if ( c == ')' ) --depth_;
+        else if ( depth_ == 0 and grammar::is_operator( c ) and grammar::precedence( c ) == level and
+                  ( c != '-' or binary_minus( expr, i ) ) )
+            return i;
+    }
+    return end_;
+}
+
+/*!
+ * Parses and evaluates the operands that start in the block of `w_` (the last one may end
+ * in a later block).  After an operand fails, the rest are only parsed: a parsing error
+ * further on is still the first error of the line.
+ */
+template < typename T >
+void SplitEvaluator< T >::evaluate_operands( Worker & w_ )
+{
+    std::ptrdiff_t depth = w_.depth;
+    size_type start = w_.begin;
+    char op = 0;
+    if ( &w_ != workers[0].get() )
+    {
+        // Our first operand is the one after the first operator of the block.
+        auto at = next_split( w_.begin, depth, w_.end );
+        if ( at == w_.end ) return;
+        op = expr[ at ];
+        start = at + 1;
+    }
+
+    for (;;)
+    {
+        auto at = next_split( start, depth, expr.size() );
+        auto piece = expr.substr( start, at - start );
+        if ( parse_failed ) return;
+
+        Parser::ResultType result;
+        {
+            BARES_STAGE( PARSE );
+            result = w_.parser.parse( piece );
+        }
+        if ( result.type != Parser::ResultType::OK )
+        {
+            parse_failed = true;
+            return;
+        }
+
+        if ( not w_.failed )
+        {
+            typename BasicVM< T >::ResultType exec;
+            {
+                BARES_STAGE( EVAL );
+                exec = w_.vm.run( w_.parser.get_program() );
+            }
+            if ( exec.type == BasicVM< T >::ResultType::OK )
+                w_.operands.push_back( Operand{ exec.value, op, op != 0 ? start - 1 : 0 } );
+            else
+            {
+                w_.failed = true;
+                w_.failure = exec;
+                w_.failure.at_col += start;
+            }
+        }
+
+        if ( at >= w_.end or at == expr.size() ) return;
+        op = expr[ at ];
+        start = at + 1;
+    }
+}
+
+/*!
+ * Applies the operators at the top to the values of the operands, in the order of the
+ * program of the whole line: the operands from left to right, and each operator as soon as
+ * both of its operands are there (so, for "^", only after the last operand, from the right).
+ */
+template < typename T >
+typename SplitEvaluator< T >::outcome_type SplitEvaluator< T >::combine( void )
+{
+    BARES_STAGE( EVAL );
+    typedef typename BasicVM< T >::ResultType result_type;
+
+    T acc = 0;
+    bool first = true;
+    size_type root_col = 0;
+    if ( level != grammar::precedence( '^' ) )
+    {
+        for ( size_type i{0} ; i < workers.size() ; ++i )
+        {
+            for ( const auto & o : workers[i]->operands )
+            {
+                if ( first ) { acc = o.value; first = false; continue; }
+                arithmetic::error_t error;
+                switch ( o.op )
+                {
+                    case '+': error = arithmetic::add( acc, o.value, acc ); break;
+                    case '-': error = arithmetic::sub( acc, o.value, acc ); break;
+                    case '*': error = arithmetic::mul( acc, o.value, acc ); break;
+                    case '/': error = arithmetic::div( acc, o.value, acc ); break;
+                    default:  error = arithmetic::mod( acc, o.value, acc ); break;
+                }
+                if ( error != arithmetic::NO_ERROR )
+                    return finish( result_type( static_cast< typename result_type::code_t >( error ), 0, o.column ), 0 );
+                root_col = o.column;
+            }
+            if ( workers[i]->failed )
+                return finish( workers[i]->failure, 0 );
+        }
+    }
+    else
+    {
+        for ( auto & w : workers )
+            if ( w->failed )
+                return finish( w->failure, 0 );
+
+        // "^" groups from the right: the last operator is applied first.
+        size_type right_col = 0; // Column of the operator on the left of the operand seen last.
+        for ( size_type i = workers.size() ; i-- > 0 ; )
+        {
+            const auto & operands = workers[i]->operands;
+            for ( size_type k = operands.size() ; k-- > 0 ; )
+            {
+                const auto & o = operands[k];
+                if ( first ) { acc = o.value; first = false; }
+                else
+                {
+                    auto error = arithmetic::pow( o.value, acc, acc );
+                    if ( error != arithmetic::NO_ERROR )
+                        return finish( result_type( static_cast< typename result_type::code_t >( error ), 0,
+                                                    right_col ), 0 );
+                    root_col = right_col;
+                }
+                right_col = o.column;
+            }
+        }
+    }
+    return finish( result_type( result_type::OK, acc ), root_col );
+}
+
+/*!
+ * Turns the result of the line into its outcome, as make_outcome() (W16) or
+ * make_wide_outcome() (the other widths) would.
+ *
+ * @param exec_ the result of the line.
+ * @param result_col_ the column of the operator that computed the final value.
+ */
+template < typename T >
+typename SplitEvaluator< T >::outcome_type
+SplitEvaluator< T >::finish( const typename BasicVM< T >::ResultType & exec_, size_type result_col_ ) const
+{
+    if constexpr ( std::is_same< T, VM::value_type >::value )
+    {
+        if ( width == grammar::width_t::W16 and exec_.type == VM::ResultType::OK and
+             not result_in_range( exec_.value ) )
+        {
+            outcome_type outcome( outcome_type::NUMERIC_OVERFLOW );
+            outcome.at_col = result_col_;
+            return outcome;
+        }
+    }
+    return make_wide_outcome< T >( exec_ );
+}
+
+/// Parses and evaluates the line as a whole, on the calling thread.
+template < typename T >
+typename SplitEvaluator< T >::outcome_type SplitEvaluator< T >::whole( std::string_view e_ )
+{
+    auto & w = *workers[0];
+    Parser::ResultType result;
+    {
+        BARES_STAGE( PARSE );
+        result = w.parser.parse( e_ );
+    }
+    if ( result.type != Parser::ResultType::OK )
+        return outcome_type( outcome_type::PARSE_ERROR, 0, result );
+
+    typename BasicVM< T >::ResultType exec;
+    {
+        BARES_STAGE( EVAL );
+        exec = w.vm.run( w.parser.get_program() );
+    }
+    return finish( exec, w.parser.get_program().get_result_column() );
+}
+
+template class SplitEvaluator< std::int32_t >;
+template class SplitEvaluator< long >;
+template class SplitEvaluator< __int128 >;
+template class SplitEvaluator< BigInt >;
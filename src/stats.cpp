@@ -0,0 +1,132 @@
+#include "../include/stats.h"
+
+#ifdef BARES_STATS
+
+#include <chrono>  // std::chrono::steady_clock
+#include <memory>  // std::unique_ptr
+#include <mutex>   // std::mutex
+#include <vector>  // std::vector
+#include <iomanip> // std::setw
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h> // __rdtsc
+#endif
+
+#include "../include/report.h" // error_name
+
+namespace {
+    std::mutex registry_mtx;                                     // Guards `registry`.
+    std::vector< std::unique_ptr< Stats::Counters > > registry;  // Counters of every thread (they outlive the threads).
+    thread_local Stats::Counters * counters = nullptr;           // Counters of this thread.
+
+    // Both clocks at start up, to convert ticks into nanoseconds later on.
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto start_ticks = Stats::now();
+
+    const char * stage_names[ Stats::N_STAGES ] = { "read", "parse", "eval", "output" };
+    const char * counter_names[ Stats::N_COUNTERS ] = { "lines", "bytes", "cache_hits", "cache_misses" };
+}
+
+Stats::Counters & Stats::local( void )
+{
+    if ( counters == nullptr )
+    {
+        std::lock_guard< std::mutex > lock( registry_mtx );
+        registry.emplace_back( new Counters );
+        counters = registry.back().get();
+    }
+    return *counters;
+}
+
+/// A few nanoseconds with the TSC; steady_clock elsewhere.
+std::uint64_t Stats::now( void )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+}
+
+void Stats::count_outcome( const OutcomeBase & outcome_ )
+{
+    auto & c = local();
+    ++c.outcomes[ outcome_.status ];
+    if ( outcome_.status == Outcome::PARSE_ERROR )
+        ++c.parse_errors[ outcome_.parse_result.type ];
+}
+
+/*!
+ * Adds up the counters of all threads and prints them.
+ *
+ * @param os_ where the summary goes.
+ * @param json_ true for a single JSON object; false for a table.
+ */
+void Stats::print( std::ostream & os_, bool json_ )
+{
+    Counters total;
+    {
+        std::lock_guard< std::mutex > lock( registry_mtx );
+        for ( const auto & c : registry )
+        {
+            for ( int s{0} ; s < N_STAGES ; ++s ) { total.ticks[s] += c->ticks[s]; total.calls[s] += c->calls[s]; }
+            for ( int i{0} ; i < N_COUNTERS ; ++i ) total.counts[i] += c->counts[i];
+            for ( std::size_t i{0} ; i < std::size( total.outcomes ) ; ++i ) total.outcomes[i] += c->outcomes[i];
+            for ( std::size_t i{0} ; i < std::size( total.parse_errors ) ; ++i ) total.parse_errors[i] += c->parse_errors[i];
+            total.high_water = std::max( total.high_water, c->high_water );
+        }
+    }
+
+    // Calibrates the ticks against the wall clock over the whole run.
+    double elapsed_ns = std::chrono::duration< double, std::nano >( std::chrono::steady_clock::now() - start_time ).count();
+    double elapsed_ticks = double( now() - start_ticks );
+    double ns_per_tick = elapsed_ticks > 0 ? elapsed_ns / elapsed_ticks : 1.0;
+
+    auto outcome_name = [] ( std::size_t i ) {
+        return i == Outcome::PARSE_ERROR ? "PARSE_ERROR" : error_name( Outcome( Outcome::status_t( i ) ) );
+    };
+    auto parse_name = [] ( std::size_t i ) {
+        return error_name( Outcome( Outcome::PARSE_ERROR, 0, Parser::ResultType( Parser::ResultType::code_t( i ) ) ) );
+    };
+
+    if ( json_ )
+    {
+        os_ << "{\"elapsed_ns\":" << std::uint64_t( elapsed_ns ) << ",\"stages\":{";
+        for ( int s{0} ; s < N_STAGES ; ++s )
+            os_ << ( s ? "," : "" ) << '"' << stage_names[s] << "\":{\"calls\":" << total.calls[s]
+                << ",\"ns\":" << std::uint64_t( total.ticks[s] * ns_per_tick ) << '}';
+        os_ << '}';
+        for ( int i{0} ; i < N_COUNTERS ; ++i )
+            os_ << ",\"" << counter_names[i] << "\":" << total.counts[i];
+        os_ << ",\"chunk_high_water\":" << total.high_water;
+        os_ << ",\"outcomes\":{";
+        for ( std::size_t i{0} ; i < std::size( total.outcomes ) ; ++i )
+            os_ << ( i ? "," : "" ) << '"' << outcome_name( i ) << "\":" << total.outcomes[i];
+        os_ << "},\"parse_errors\":{";
+        for ( std::size_t i{1} ; i < std::size( total.parse_errors ) ; ++i )
+            os_ << ( i > 1 ? "," : "" ) << '"' << parse_name( i ) << "\":" << total.parse_errors[i];
+        os_ << "}}\n";
+        return;
+    }
+
+    os_ << ">>> Statistics (" << std::fixed << std::setprecision( 3 ) << elapsed_ns / 1e6 << " ms):\n";
+    for ( int s{0} ; s < N_STAGES ; ++s )
+    {
+        double ns = total.ticks[s] * ns_per_tick;
+        os_ << "    " << std::left << std::setw( 30 ) << stage_names[s] << std::right
+            << std::setw( 12 ) << total.calls[s] << " calls" << std::setw( 14 ) << ns / 1e6 << " ms"
+            << std::setw( 10 ) << std::setprecision( 1 ) << ( total.calls[s] ? ns / total.calls[s] : 0.0 )
+            << " ns/call\n" << std::setprecision( 3 );
+    }
+    for ( int i{0} ; i < N_COUNTERS ; ++i )
+        os_ << "    " << std::left << std::setw( 30 ) << counter_names[i] << std::right << std::setw( 12 ) << total.counts[i] << "\n";
+    if ( total.high_water != 0 )
+        os_ << "    " << std::left << std::setw( 30 ) << "chunk_high_water (bytes)" << std::right << std::setw( 12 ) << total.high_water << "\n";
+    for ( std::size_t i{0} ; i < std::size( total.outcomes ) ; ++i )
+        os_ << "    " << std::left << std::setw( 30 ) << outcome_name( i ) << std::right << std::setw( 12 ) << total.outcomes[i] << "\n";
+    for ( std::size_t i{1} ; i < std::size( total.parse_errors ) ; ++i )
+        os_ << "      " << std::left << std::setw( 28 ) << parse_name( i ) << std::right << std::setw( 12 ) << total.parse_errors[i] << "\n";
+}
+
+#endif
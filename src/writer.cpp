@@ -0,0 +1,78 @@
+#include "../include/writer.h"
+#include "../include/stats.h"
+#include "../include/bigint.h"
+#include <cerrno>   // errno
+#include <unistd.h> // write
+
+/*!
+ * @param fd_ the file descriptor that receives the data (it is not closed).
+ * @param format_ the format of the reports.
+ * @param flush_size_ how much data we collect before writing it out.
+ */
+OutputWriter::OutputWriter( int fd_, report_format_t format_, size_type flush_size_ )
+    : fd{ fd_ }
+    , format{ format_ }
+    , flush_size{ flush_size_ }
+{
+    // A little extra room, so that the last report before a flush does not reallocate.
+    buffer.reserve( flush_size + 4096 );
+}
+
+OutputWriter::~OutputWriter()
+{
+    flush();
+}
+
+/// Formats the report straight into the buffer.
+template < typename T >
+void OutputWriter::write( std::string_view expr_, const BasicOutcome< T > & outcome_ )
+{
+    BARES_STAGE( OUTPUT );
+    print_outcome( buffer, expr_, outcome_, format );
+    maybe_flush();
+}
+
+template void OutputWriter::write( std::string_view, const BasicOutcome< long > & );
+template void OutputWriter::write( std::string_view, const BasicOutcome< std::int32_t > & );
+template void OutputWriter::write( std::string_view, const BasicOutcome< __int128 > & );
+template void OutputWriter::write( std::string_view, const BasicOutcome< BigInt > & );
+
+/// Appends preformatted text to the buffer.
+void OutputWriter::write_raw( std::string_view text_ )
+{
+    BARES_STAGE( OUTPUT );
+    // Big blocks do not need to be copied first.
+    if ( text_.size() >= flush_size and not text_.empty() )
+    {
+        flush();
+        write_all( text_ );
+        return;
+    }
+    buffer += text_;
+    maybe_flush();
+}
+
+/// Writes the whole buffer to the file descriptor and empties it (keeping its capacity).
+void OutputWriter::flush( void )
+{
+    write_all( buffer );
+    buffer.clear();
+}
+
+/// Writes `data_` to the file descriptor, dealing with partial writes.
+void OutputWriter::write_all( std::string_view data_ )
+{
+    const char * data = data_.data();
+    size_type left = data_.size();
+    while ( left != 0 )
+    {
+        auto n = ::write( fd, data, left );
+        if ( n < 0 )
+        {
+            if ( errno == EINTR ) continue;
+            break; // Nowhere to report it: the output is gone (e.g. closed pipe).
+        }
+        data += n;
+        left -= n;
+    }
+}